@@ -0,0 +1,416 @@
+#include "gpu_driven_render_system.hpp"
+
+#include "ld_frustum.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <tuple>
+
+namespace ld {
+	namespace {
+		constexpr uint32_t CULL_GROUP_SIZE = 64;
+	}
+
+	GpuDrivenRenderSystem::GpuDrivenRenderSystem(LdDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
+		: ldDevice{ device }
+	{
+		if (!ldDevice.supportsMultiDrawIndirect())
+		{
+			throw std::runtime_error("gpu driven rendering needs multiDrawIndirect and drawIndirectFirstInstance!");
+		}
+		depthPyramid = std::make_unique<LdDepthPyramid>(ldDevice);
+		createObjectSetLayout();
+		createPipelineLayouts(globalSetLayout);
+		createPipelines(renderPass);
+	}
+
+	GpuDrivenRenderSystem::~GpuDrivenRenderSystem()
+	{
+		vkDestroyPipelineLayout(ldDevice.device(), pipelineLayout, nullptr);
+		vkDestroyPipelineLayout(ldDevice.device(), cullPipelineLayout, nullptr);
+	}
+
+	void GpuDrivenRenderSystem::createObjectSetLayout()
+	{
+		objectSetLayout = LdDescriptorSetLayout::Builder(ldDevice)
+			.addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+			.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+			.addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+			.addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+			.addBinding(4, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+			.addBinding(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+			.build();
+		objectPool = LdDescriptorPool::Builder(ldDevice)
+			.setMaxSets(LdSwapChain::MAX_FRAMES_IN_FLIGHT)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5 * LdSwapChain::MAX_FRAMES_IN_FLIGHT)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, LdSwapChain::MAX_FRAMES_IN_FLIGHT)
+			.build();
+	}
+
+	void GpuDrivenRenderSystem::createPipelineLayouts(VkDescriptorSetLayout globalSetLayout)
+	{
+		// the vertex shaders are SimpleRenderSystem's, they find the instances at set 1
+		std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ globalSetLayout, objectSetLayout->getDescriptorSetLayout() };
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+		pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
+		pipelineLayoutInfo.pushConstantRangeCount = 0;
+		pipelineLayoutInfo.pPushConstantRanges = nullptr;
+
+		if (vkCreatePipelineLayout(ldDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create pipeline layout!");
+		}
+
+		std::vector<VkDescriptorSetLayout> cullSetLayouts{ objectSetLayout->getDescriptorSetLayout(), depthPyramid->getReadSetLayout() };
+		VkPushConstantRange pushConstantRange{};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(CullPush);
+
+		VkPipelineLayoutCreateInfo cullLayoutInfo{};
+		cullLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		cullLayoutInfo.setLayoutCount = static_cast<uint32_t>(cullSetLayouts.size());
+		cullLayoutInfo.pSetLayouts = cullSetLayouts.data();
+		cullLayoutInfo.pushConstantRangeCount = 1;
+		cullLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+		if (vkCreatePipelineLayout(ldDevice.device(), &cullLayoutInfo, nullptr, &cullPipelineLayout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create cull pipeline layout!");
+		}
+	}
+
+	void GpuDrivenRenderSystem::createPipelines(VkRenderPass renderPass)
+	{
+		assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+
+		for (uint32_t i = 0; i < static_cast<uint32_t>(LdModel::VertexFormat::Count); i++)
+		{
+			auto format = static_cast<LdModel::VertexFormat>(i);
+			PipelineConfigInfo pipelineConfig{};
+			LdPipeline::defaultPipelineConfigInfo(pipelineConfig);
+			pipelineConfig.renderPass = renderPass;
+			pipelineConfig.pipelineLayout = pipelineLayout;
+
+			std::string vertFilepath = "shaders/simple_shader.vert.spv";
+			if (format != LdModel::VertexFormat::Float32)
+			{
+				pipelineConfig.bindingDescriptions = LdModel::PackedVertex::getBindingDescriptions();
+				pipelineConfig.attributeDescriptions = LdModel::PackedVertex::getAttributeDescriptions(format);
+				vertFilepath = "shaders/simple_shader_packed.vert.spv";
+			}
+			ldPipelines[i] = std::make_unique<LdPipeline>(
+				ldDevice,
+				vertFilepath,
+				"shaders/simple_shader.frag.spv",
+				pipelineConfig
+			);
+		}
+
+		cullPipeline = std::make_unique<LdComputePipeline>(ldDevice, "shaders/cull.comp.spv", cullPipelineLayout);
+	}
+
+	void GpuDrivenRenderSystem::buildScene(LdGameObject::Map& gameObjects)
+	{
+		std::vector<std::pair<LdModel*, LdGameObject*>> entries{};
+		for (auto& kv : gameObjects)
+		{
+			auto& obj = kv.second;
+			if (obj.model == nullptr || !obj.model->isResident() || !obj.model->hasIndices()) continue;
+			entries.emplace_back(obj.model.get(), &obj);
+		}
+		// one draw per run of objects that can share a pipeline and buffer binds
+		auto key = [](const LdModel* model) {
+			return std::make_tuple(model->getVertexFormat(), model->getVertexBuffer(), model->getIndexBuffer(), model->getIndexType());
+		};
+		std::stable_sort(entries.begin(), entries.end(), [&key](const auto& a, const auto& b) {
+			return key(a.first) < key(b.first);
+		});
+
+		groups.clear();
+		instances.resize(entries.size());
+		objects.resize(entries.size());
+		uint32_t maxDrawCount = ldDevice.properties.limits.maxDrawIndirectCount;
+		for (uint32_t i = 0; i < entries.size(); i++)
+		{
+			LdModel& model = *entries[i].first;
+			LdGameObject& obj = *entries[i].second;
+			if (groups.empty() || key(groups.back().model) != key(&model) || groups.back().objectCount == maxDrawCount)
+			{
+				groups.push_back({ &model, i, 0 });
+			}
+			groups.back().objectCount++;
+
+			glm::mat4 modelMatrix = obj.transform.mat4();
+			// packed models store positions relative to their bounds
+			instances[i].modelMatrix = modelMatrix * model.getPositionTransform();
+			instances[i].normalMatrix = obj.transform.normalMatrix();
+
+			float scale = std::max({ glm::length(glm::vec3{ modelMatrix[0] }), glm::length(glm::vec3{ modelMatrix[1] }),
+				glm::length(glm::vec3{ modelMatrix[2] }) });
+			VkDrawIndexedIndirectCommand command = model.getIndirectCommand(0);
+			CullObject& object = objects[i];
+			object.sphere = glm::vec4{ glm::vec3{ modelMatrix * glm::vec4{ model.getBoundsCenter(), 1.f } }, model.getBoundsRadius() * scale };
+			object.indexCount = command.indexCount;
+			object.firstIndex = command.firstIndex;
+			object.vertexOffset = command.vertexOffset;
+			object.group = static_cast<uint32_t>(groups.size() - 1);
+			object.groupFirst = groups.back().firstObject;
+		}
+	}
+
+	void GpuDrivenRenderSystem::reserveFrame(FrameResources& frame)
+	{
+		uint32_t objectCount = std::max(static_cast<uint32_t>(objects.size()), 1u);
+		uint32_t groupCount = std::max(static_cast<uint32_t>(groups.size()), 1u);
+		if (frame.descriptorSet != VK_NULL_HANDLE && frame.capacity >= objectCount && frame.groupCapacity >= groupCount)
+		{
+			return;
+		}
+		// grows by half again so a scene streaming in does not reallocate every few frames
+		frame.capacity = std::max(objectCount, frame.capacity + frame.capacity / 2);
+		frame.groupCapacity = std::max(groupCount, frame.groupCapacity + frame.groupCapacity / 2);
+
+		frame.instanceBuffer = std::make_unique<LdBuffer>(ldDevice, sizeof(LdInstanceBatcher::Instance), frame.capacity,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		frame.instanceBuffer->map();
+		frame.objectBuffer = std::make_unique<LdBuffer>(ldDevice, sizeof(CullObject), frame.capacity,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		frame.objectBuffer->map();
+		frame.commandBuffer = std::make_unique<LdBuffer>(ldDevice, sizeof(VkDrawIndexedIndirectCommand), 2 * frame.capacity,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		frame.countBuffer = std::make_unique<LdBuffer>(ldDevice, sizeof(uint32_t), STAT_COUNTS + 2 * frame.groupCapacity,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		frame.countBuffer->map();
+		frame.occludedBuffer = std::make_unique<LdBuffer>(ldDevice, sizeof(uint32_t), frame.capacity,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		if (!frame.viewBuffer)
+		{
+			frame.viewBuffer = std::make_unique<LdBuffer>(ldDevice, sizeof(CullView), 2,
+				VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			frame.viewBuffer->map();
+		}
+
+		auto instanceInfo = frame.instanceBuffer->descriptorInfo();
+		auto objectInfo = frame.objectBuffer->descriptorInfo();
+		auto commandInfo = frame.commandBuffer->descriptorInfo();
+		auto countInfo = frame.countBuffer->descriptorInfo();
+		auto viewInfo = frame.viewBuffer->descriptorInfo();
+		auto occludedInfo = frame.occludedBuffer->descriptorInfo();
+		LdDescriptorWriter writer{ *objectSetLayout, *objectPool };
+		writer.writeBuffer(0, &instanceInfo)
+			.writeBuffer(1, &objectInfo)
+			.writeBuffer(2, &commandInfo)
+			.writeBuffer(3, &countInfo)
+			.writeBuffer(4, &viewInfo)
+			.writeBuffer(5, &occludedInfo);
+		if (frame.descriptorSet == VK_NULL_HANDLE)
+		{
+			if (!writer.build(frame.descriptorSet))
+			{
+				throw std::runtime_error("failed to allocate object descriptor set!");
+			}
+		}
+		else
+		{
+			writer.overwrite(frame.descriptorSet);
+		}
+	}
+
+	void GpuDrivenRenderSystem::uploadScene(FrameResources& frame)
+	{
+		reserveFrame(frame);
+		std::memcpy(frame.instanceBuffer->getMappedMemory(), instances.data(), instances.size() * sizeof(LdInstanceBatcher::Instance));
+		std::memcpy(frame.objectBuffer->getMappedMemory(), objects.data(), objects.size() * sizeof(CullObject));
+		frame.sceneVersion = sceneVersion;
+	}
+
+	void GpuDrivenRenderSystem::prepare(FrameInfo& frameInfo, VkExtent2D depthExtent, bool occlusionCulling)
+	{
+		FrameResources& frame = frames[frameInfo.frameIndex];
+		// beginFrame() waited for this frame's fence, the counts it wrote are final
+		if (frame.submitted)
+		{
+			const uint32_t* counts = static_cast<const uint32_t*>(frame.countBuffer->getMappedMemory());
+			stats.visibleObjects = 0;
+			for (uint32_t phase = 0; phase < 2; phase++)
+			{
+				for (uint32_t i = 0; i < frame.groupCount; i++)
+				{
+					stats.visibleObjects += counts[STAT_COUNTS + phase * frame.groupCapacity + i];
+				}
+			}
+			stats.occludedObjects = counts[1];
+			stats.disoccludedObjects = counts[0] - counts[1];
+			frame.submitted = false;
+		}
+
+		// every frame, the cull shader always has the pyramid bound
+		depthPyramid->resize(depthExtent);
+		occlusion = occlusionCulling;
+
+		if (builtSceneVersion != sceneVersion)
+		{
+			buildScene(frameInfo.gameObjects);
+			builtSceneVersion = sceneVersion;
+			stats.sceneUploads++;
+			stats.sceneBytes = static_cast<uint32_t>(objects.size() * (sizeof(LdInstanceBatcher::Instance) + sizeof(CullObject)));
+		}
+		stats.objects = static_cast<uint32_t>(objects.size());
+		stats.groups = static_cast<uint32_t>(groups.size());
+		stats.drawCalls = 0;
+		if (objects.empty())
+		{
+			return;
+		}
+		if (frame.sceneVersion != sceneVersion)
+		{
+			uploadScene(frame);
+		}
+		// host writes before the submit are visible to the dispatch, no fill and barrier needed
+		std::memset(frame.countBuffer->getMappedMemory(), 0, frame.countBuffer->getBufferSize());
+		frame.groupCount = static_cast<uint32_t>(groups.size());
+		frame.submitted = true;
+
+		viewProjection = frameInfo.camera.getProjection() * frameInfo.camera.getView();
+		LdFrustum frustum{ viewProjection };
+		std::array<CullView, 2> views{};
+		for (uint32_t phase = 0; phase < 2; phase++)
+		{
+			CullView& view = views[phase];
+			for (int i = 0; i < LdFrustum::PLANE_COUNT; i++)
+			{
+				view.planes[i] = frustum.getPlane(i);
+			}
+			view.pyramidSize = glm::vec2{ static_cast<float>(depthPyramid->getExtent().width), static_cast<float>(depthPyramid->getExtent().height) };
+			view.pyramidLevels = depthPyramid->getLevelCount();
+		}
+		// the early phase looks at the last frame's depth from the last frame's camera
+		views[0].occlusionViewProjection = depthPyramid->getViewProjection();
+		views[0].occlusion = occlusion && depthPyramid->isBuilt() ? 1 : 0;
+		views[1].occlusionViewProjection = viewProjection;
+		views[1].occlusion = 1;
+		std::memcpy(frame.viewBuffer->getMappedMemory(), views.data(), sizeof(views));
+
+		dispatchCull(frameInfo, 0);
+	}
+
+	void GpuDrivenRenderSystem::prepareLate(FrameInfo& frameInfo, VkImageView depthView)
+	{
+		assert(occlusion && "Late phase needs prepare() with occlusion culling");
+		FrameResources& frame = frames[frameInfo.frameIndex];
+		// the pyramid also serves the next frame's early phase, so it is built even without objects
+		depthPyramid->build(frameInfo.commandBuffer, frameInfo.frameIndex, depthView, viewProjection);
+		if (!objects.empty() && frame.submitted)
+		{
+			dispatchCull(frameInfo, 1);
+		}
+	}
+
+	void GpuDrivenRenderSystem::dispatchCull(FrameInfo& frameInfo, uint32_t phase)
+	{
+		FrameResources& frame = frames[frameInfo.frameIndex];
+		CullPush push{};
+		push.objectCount = static_cast<uint32_t>(objects.size());
+		push.compact = ldDevice.cmdDrawIndexedIndirectCount() != nullptr ? 1 : 0;
+		push.phase = phase;
+		push.countOffset = STAT_COUNTS + phase * frame.groupCapacity;
+		push.commandOffset = phase * frame.capacity;
+
+		if (phase == 1)
+		{
+			// the late phase reads the early phase's occludedEarly flags and adds to its counters
+			VkMemoryBarrier earlyBarrier{};
+			earlyBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			earlyBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			earlyBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			vkCmdPipelineBarrier(frameInfo.commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0, 1, &earlyBarrier, 0, nullptr, 0, nullptr);
+		}
+
+		VkDescriptorSet descriptorSets[] = { frame.descriptorSet, depthPyramid->getReadSet() };
+		cullPipeline->bind(frameInfo.commandBuffer);
+		vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 2, descriptorSets, 0, nullptr);
+		vkCmdPushConstants(frameInfo.commandBuffer, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPush), &push);
+		vkCmdDispatch(frameInfo.commandBuffer, (push.objectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+		// the draws read the commands and counts, prepare() reads the counts back on the host once the
+		// frame's fence has signaled
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(frameInfo.commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+			0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	void GpuDrivenRenderSystem::render(FrameInfo& frameInfo)
+	{
+		drawPhase(frameInfo, 0);
+	}
+
+	void GpuDrivenRenderSystem::renderLate(FrameInfo& frameInfo)
+	{
+		assert(occlusion && "Late phase needs prepare() with occlusion culling");
+		drawPhase(frameInfo, 1);
+	}
+
+	void GpuDrivenRenderSystem::drawPhase(FrameInfo& frameInfo, uint32_t phase)
+	{
+		FrameResources& frame = frames[frameInfo.frameIndex];
+		if (objects.empty() || !frame.submitted)
+		{
+			return;
+		}
+
+		vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &frameInfo.globalDescriptorSet, 1, &frameInfo.globalUboOffset);
+		vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &frame.descriptorSet, 0, nullptr);
+
+		PFN_vkCmdDrawIndexedIndirectCountKHR drawIndexedIndirectCount = ldDevice.cmdDrawIndexedIndirectCount();
+		constexpr uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+		LdPipeline* boundPipeline = nullptr;
+		VkBuffer boundVertexBuffer = VK_NULL_HANDLE;
+		VkBuffer boundIndexBuffer = VK_NULL_HANDLE;
+		for (uint32_t i = 0; i < groups.size(); i++)
+		{
+			const Group& group = groups[i];
+			LdModel& model = *group.model;
+			LdPipeline* pipeline = ldPipelines[static_cast<size_t>(model.getVertexFormat())].get();
+			if (pipeline != boundPipeline)
+			{
+				pipeline->bind(frameInfo.commandBuffer);
+				boundPipeline = pipeline;
+			}
+			if (model.getVertexBuffer() != boundVertexBuffer || model.getIndexBuffer() != boundIndexBuffer)
+			{
+				model.bind(frameInfo.commandBuffer);
+				boundVertexBuffer = model.getVertexBuffer();
+				boundIndexBuffer = model.getIndexBuffer();
+			}
+
+			VkDeviceSize commandOffset = static_cast<VkDeviceSize>(phase * frame.capacity + group.firstObject) * stride;
+			if (drawIndexedIndirectCount != nullptr)
+			{
+				VkDeviceSize countOffset = (STAT_COUNTS + phase * frame.groupCapacity + i) * sizeof(uint32_t);
+				drawIndexedIndirectCount(frameInfo.commandBuffer, frame.commandBuffer->getBuffer(), commandOffset,
+					frame.countBuffer->getBuffer(), countOffset, group.objectCount, stride);
+			}
+			else
+			{
+				// every slot is written, the culled ones with no instances
+				vkCmdDrawIndexedIndirect(frameInfo.commandBuffer, frame.commandBuffer->getBuffer(), commandOffset, group.objectCount, stride);
+			}
+			stats.drawCalls++;
+		}
+	}
+}
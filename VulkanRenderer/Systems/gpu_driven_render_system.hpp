@@ -0,0 +1,167 @@
+#pragma once
+
+#include "ld_camera.hpp"
+#include "ld_compute_pipeline.hpp"
+#include "ld_depth_pyramid.hpp"
+#include "ld_pipeline.hpp"
+#include "ld_device.hpp"
+#include "ld_buffer.hpp"
+#include "ld_descriptors.hpp"
+#include "ld_game_object.hpp"
+#include "ld_instance_batcher.hpp"
+#include "ld_frame_info.hpp"
+#include "ld_swapchain.hpp"
+
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace ld {
+	// Draws every resident game object with a model from buffers the gpu fills itself. The scene is
+	// uploaded once per change into per frame storage buffers, every frame a compute shader frustum culls
+	// each object and appends a VkDrawIndexedIndirectCommand for the visible ones, and the pass issues one
+	// indirect count draw per group of objects sharing a vertex format and buffers. The cpu cost of a frame
+	// does not grow with the object count. Draws full detail only, lod selection and meshlet culling
+	// stay with SimpleRenderSystem. Needs LdDevice::supportsMultiDrawIndirect().
+	//
+	// With occlusion culling the frame's render pass is split in two, see LdSwapChain::RenderPassPart.
+	// The early phase also tests every object against the depth pyramid of the last frame and draws what
+	// it cannot prove hidden. Between the parts the pyramid is rebuilt from the early depth, and the late
+	// phase gives the objects the early phase rejected a second test against it, drawing the ones that
+	// became visible this frame.
+	class GpuDrivenRenderSystem {
+	public:
+		struct RenderStats {
+			uint32_t objects = 0;
+			// indirect draw calls recorded, one per group
+			uint32_t drawCalls = 0;
+			uint32_t groups = 0;
+			// read back once the frame finished, so MAX_FRAMES_IN_FLIGHT frames behind
+			uint32_t visibleObjects = 0;
+			// inside the frustum but behind this frame's early depth
+			uint32_t occludedObjects = 0;
+			// hidden in last frame's depth pyramid but not in this frame's, drawn by the late phase
+			uint32_t disoccludedObjects = 0;
+			// last scene upload
+			uint32_t sceneUploads = 0;
+			uint32_t sceneBytes = 0;
+		};
+
+		// std430 layout of the CullObject struct in cull.comp
+		struct CullObject {
+			// world space bounding sphere
+			glm::vec4 sphere{};
+			uint32_t indexCount = 0;
+			uint32_t firstIndex = 0;
+			int32_t vertexOffset = 0;
+			uint32_t group = 0;
+			// first command slot of the group
+			uint32_t groupFirst = 0;
+			uint32_t padding[3]{};
+		};
+
+		GpuDrivenRenderSystem(LdDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+		~GpuDrivenRenderSystem();
+		GpuDrivenRenderSystem(const GpuDrivenRenderSystem&) = delete;
+		GpuDrivenRenderSystem& operator=(const GpuDrivenRenderSystem&) = delete;
+
+	private:
+		// objects of one group are contiguous and draw with one call
+		struct Group {
+			LdModel* model;
+			uint32_t firstObject;
+			uint32_t objectCount;
+		};
+
+		// everything the gpu reads or writes for one frame in flight, rewritten only when the scene changed
+		struct FrameResources {
+			// LdInstanceBatcher::Instance per object, read by the vertex shaders at gl_InstanceIndex
+			std::unique_ptr<LdBuffer> instanceBuffer;
+			std::unique_ptr<LdBuffer> objectBuffer;
+			// capacity commands for the early phase, then as many for the late one
+			std::unique_ptr<LdBuffer> commandBuffer;
+			// STAT_COUNTS occlusion counts, then one visible count per group and phase, host visible to read them back
+			std::unique_ptr<LdBuffer> countBuffer;
+			// set by the early phase for objects it rejected as occluded
+			std::unique_ptr<LdBuffer> occludedBuffer;
+			// one CullView per phase
+			std::unique_ptr<LdBuffer> viewBuffer;
+			VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+			uint64_t sceneVersion = 0;
+			uint32_t capacity = 0;
+			uint32_t groupCapacity = 0;
+			// groups the last dispatch counted into countBuffer
+			uint32_t groupCount = 0;
+			bool submitted = false;
+		};
+
+		// std140 layout of the CullView struct in cull.comp
+		struct CullView {
+			glm::vec4 planes[6];
+			// projects into the depth pyramid
+			glm::mat4 occlusionViewProjection;
+			glm::vec2 pyramidSize;
+			uint32_t pyramidLevels;
+			uint32_t occlusion;
+		};
+
+		struct CullPush {
+			uint32_t objectCount;
+			// 1 appends visible commands, 0 writes every slot and zeroes the culled instance counts
+			uint32_t compact;
+			uint32_t phase;
+			// where this phase's group counts and commands start
+			uint32_t countOffset;
+			uint32_t commandOffset;
+		};
+
+		static constexpr uint32_t STAT_COUNTS = 2;
+
+		LdDevice& ldDevice;
+		std::array<std::unique_ptr<LdPipeline>, static_cast<size_t>(LdModel::VertexFormat::Count)> ldPipelines;
+		std::unique_ptr<LdComputePipeline> cullPipeline;
+		VkPipelineLayout pipelineLayout;
+		VkPipelineLayout cullPipelineLayout;
+		std::unique_ptr<LdDescriptorSetLayout> objectSetLayout;
+		std::unique_ptr<LdDescriptorPool> objectPool;
+		std::unique_ptr<LdDepthPyramid> depthPyramid;
+		std::array<FrameResources, LdSwapChain::MAX_FRAMES_IN_FLIGHT> frames{};
+
+		uint64_t sceneVersion = 1;
+		uint64_t builtSceneVersion = 0;
+		glm::mat4 viewProjection{ 1.f };
+		bool occlusion = false;
+		std::vector<Group> groups{};
+		std::vector<LdInstanceBatcher::Instance> instances{};
+		std::vector<CullObject> objects{};
+		RenderStats stats{};
+
+	public:
+		// test objects against the depth pyramid, needs a swapchain whose render pass can be split
+		bool occlusionCulling = true;
+
+		// call whenever objects, their transforms or their models' residency or placement changed
+		void invalidateScene() { sceneVersion++; }
+		// Records the early culling dispatch, outside of the render pass. depthExtent is the swapchain's,
+		// with occlusionCulling the frame has to go through prepareLate() and renderLate() as well.
+		void prepare(FrameInfo& frameInfo, VkExtent2D depthExtent, bool occlusionCulling);
+		// records the early indirect draws, inside the render pass after prepare() on the same frame
+		void render(FrameInfo& frameInfo);
+		// builds the depth pyramid from depthView and records the late culling dispatch, between the
+		// early and late part of the render pass
+		void prepareLate(FrameInfo& frameInfo, VkImageView depthView);
+		// records the draws of the disoccluded objects, inside the late part of the render pass
+		void renderLate(FrameInfo& frameInfo);
+		const RenderStats& getStats() const { return stats; }
+
+	private:
+		void createObjectSetLayout();
+		void createPipelineLayouts(VkDescriptorSetLayout globalSetLayout);
+		void createPipelines(VkRenderPass renderPass);
+		void buildScene(LdGameObject::Map& gameObjects);
+		void uploadScene(FrameResources& frame);
+		void reserveFrame(FrameResources& frame);
+		void dispatchCull(FrameInfo& frameInfo, uint32_t phase);
+		void drawPhase(FrameInfo& frameInfo, uint32_t phase);
+	};
+}
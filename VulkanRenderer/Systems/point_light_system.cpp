@@ -88,7 +88,7 @@ namespace ld {
 
 		ldPipeline->bind(frameInfo.commandBuffer);
 
-		vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &frameInfo.globalDescriptorSet, 0, nullptr);
+		vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &frameInfo.globalDescriptorSet, 1, &frameInfo.globalUboOffset);
 
 		// iterate through sorted elements in reverse order
 		for (auto it = sorted.rbegin(); it != sorted.rend(); ++it)
@@ -6,84 +6,467 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
+#include <algorithm>
 #include <stdexcept>
 #include <array>
+#include <chrono>
 
 namespace ld {
-	struct SimplePushConstantData {
-		glm::mat4 modelMatrix{ 1.f };
-		glm::mat4 normalMatrix{ 1.f };
-	};
+	namespace {
+		using Clock = std::chrono::high_resolution_clock;
+	}
 
-	SimpleRenderSystem::SimpleRenderSystem(LdDevice &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
+	SimpleRenderSystem::SimpleRenderSystem(LdDevice &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout,
+		LdFrameAllocator& frameAllocator)
 		: ldDevice{device}
 	{
+		createInstanceDescriptorSet(frameAllocator);
 		createPipelineLayout(globalSetLayout);
 		createPipeline(renderPass);
+		createStaticCommandPool();
 	}
 
 	SimpleRenderSystem::~SimpleRenderSystem()
 	{
+		// destroying the pool frees the cached command buffers
+		vkDestroyCommandPool(ldDevice.device(), staticCommandPool, nullptr);
 		vkDestroyPipelineLayout(ldDevice.device(), pipelineLayout, nullptr);
 	}
 
+	void SimpleRenderSystem::createInstanceDescriptorSet(LdFrameAllocator& frameAllocator)
+	{
+		instanceSetLayout = LdDescriptorSetLayout::Builder(ldDevice)
+			.addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT)
+			.build();
+		// one more set per static cache, each binds its own instance buffer
+		instancePool = LdDescriptorPool::Builder(ldDevice)
+			.setMaxSets(1 + LdSwapChain::MAX_FRAMES_IN_FLIGHT)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1 + LdSwapChain::MAX_FRAMES_IN_FLIGHT)
+			.build();
+
+		auto bufferInfo = frameAllocator.descriptorInfo(frameAllocator.getStats().frameSize);
+		if (!LdDescriptorWriter(*instanceSetLayout, *instancePool)
+			.writeBuffer(0, &bufferInfo)
+			.build(instanceDescriptorSet))
+		{
+			throw std::runtime_error("failed to allocate instance descriptor set!");
+		}
+		frameDraws.instanceSet = instanceDescriptorSet;
+	}
 
 	void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout)
 	{
-		VkPushConstantRange pushConstantRange{};
-		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-		pushConstantRange.offset = 0;
-		pushConstantRange.size = sizeof(SimplePushConstantData);
-
-		std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ globalSetLayout };
+		std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ globalSetLayout, instanceSetLayout->getDescriptorSetLayout() };
 
 		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
 		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 		pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
 		pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-		pipelineLayoutInfo.pushConstantRangeCount = 1;
-		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+		pipelineLayoutInfo.pushConstantRangeCount = 0;
+		pipelineLayoutInfo.pPushConstantRanges = nullptr;
 
 		if (vkCreatePipelineLayout(ldDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
 		{
 			throw std::runtime_error("failed to create pipeline layout!");
 		}
 	}
-
 	void SimpleRenderSystem::createPipeline(VkRenderPass renderPass)
 	{
 		assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
-		PipelineConfigInfo pipelineConfig{};
-		LdPipeline::defaultPipelineConfigInfo(pipelineConfig);
-		pipelineConfig.renderPass = renderPass;
-		pipelineConfig.pipelineLayout = pipelineLayout;
-		ldPipeline = std::make_unique<LdPipeline>(
-			ldDevice,
-			"shaders/simple_shader.vert.spv",
-			"shaders/simple_shader.frag.spv",
-			pipelineConfig
-		);
+		for (uint32_t i = 0; i < static_cast<uint32_t>(LdModel::VertexFormat::Count); i++)
+		{
+			auto format = static_cast<LdModel::VertexFormat>(i);
+			PipelineConfigInfo pipelineConfig{};
+			LdPipeline::defaultPipelineConfigInfo(pipelineConfig);
+			pipelineConfig.renderPass = renderPass;
+			pipelineConfig.pipelineLayout = pipelineLayout;
+			backFaceCulling = (pipelineConfig.rasterizationInfo.cullMode & VK_CULL_MODE_BACK_BIT) != 0;
+
+			std::string vertFilepath = "shaders/simple_shader.vert.spv";
+			if (format != LdModel::VertexFormat::Float32)
+			{
+				pipelineConfig.bindingDescriptions = LdModel::PackedVertex::getBindingDescriptions();
+				pipelineConfig.attributeDescriptions = LdModel::PackedVertex::getAttributeDescriptions(format);
+				vertFilepath = "shaders/simple_shader_packed.vert.spv";
+			}
+			ldPipelines[i] = std::make_unique<LdPipeline>(
+				ldDevice,
+				vertFilepath,
+				"shaders/simple_shader.frag.spv",
+				pipelineConfig
+			);
+		}
+	}
+
+	void SimpleRenderSystem::createStaticCommandPool()
+	{
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = ldDevice.findPhysicalQueueFamilies().graphicsFamily;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		if (vkCreateCommandPool(ldDevice.device(), &poolInfo, nullptr, &staticCommandPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create static command pool!");
+		}
 	}
 
 	void SimpleRenderSystem::renderGameObjects(FrameInfo &frameInfo)
 	{
-		ldPipeline->bind(frameInfo.commandBuffer);
+		if (!buildDraws(frameInfo, false))
+		{
+			return;
+		}
+		auto start = Clock::now();
+		stats.bufferBinds = recordDraws(frameInfo.commandBuffer, frameInfo, frameDraws, 0, static_cast<uint32_t>(frameDraws.draws.size()));
+		stats.recordMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
 
-		vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &frameInfo.globalDescriptorSet, 0, nullptr);
+	void SimpleRenderSystem::renderGameObjects(FrameInfo& frameInfo, LdParallelRecorder& recorder, const LdParallelRecorder::Target& target)
+	{
+		bool hasDraws = buildDraws(frameInfo, staticCaching);
+		auto start = Clock::now();
+		VkCommandBuffer staticCommandBuffer = staticCaching ? getStaticCommandBuffer(frameInfo, target) : VK_NULL_HANDLE;
+		if (staticCommandBuffer != VK_NULL_HANDLE)
+		{
+			vkCmdExecuteCommands(frameInfo.commandBuffer, 1, &staticCommandBuffer);
+		}
+		if (hasDraws)
+		{
+			// every slice starts without bound state, so each one binds at least once
+			sliceBufferBinds.assign(recorder.getMaxSlices(), 0);
+			const auto& commandBuffers = recorder.record(target, static_cast<uint32_t>(frameDraws.draws.size()),
+				[this, &frameInfo](VkCommandBuffer commandBuffer, uint32_t slice, uint32_t first, uint32_t count) {
+					sliceBufferBinds[slice] = recordDraws(commandBuffer, frameInfo, frameDraws, first, count);
+				});
+			vkCmdExecuteCommands(frameInfo.commandBuffer, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+			for (uint32_t binds : sliceBufferBinds)
+			{
+				stats.bufferBinds += binds;
+			}
+			stats.recordSlices = static_cast<uint32_t>(commandBuffers.size());
+		}
+		stats.recordMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
 
+	bool SimpleRenderSystem::buildDraws(FrameInfo& frameInfo, bool skipStatic)
+	{
+		meshletCuller.begin(frameInfo.camera, backFaceCulling);
+		lodSelector.begin(frameInfo.camera);
+		cameraPosition = glm::vec3{ frameInfo.camera.getInverseView()[3] };
+		frustumCuller.begin(frameInfo.camera);
+		occlusionCuller.begin(frameInfo.camera);
+		frameDraws.batcher.begin();
+		frameDraws.draws.clear();
+		stats = RenderStats{};
+		staticObjectCount = 0;
+
+		if (occlusionCulling)
+		{
+			for (auto& kv : frameInfo.gameObjects)
+			{
+				auto& obj = kv.second;
+				// models over LdModel::MAX_OCCLUDER_TRIANGLES have no occluder mesh
+				if (obj.occluder && obj.model != nullptr && obj.model->isResident() && !obj.model->getOccluderMesh().indices.empty())
+				{
+					occlusionCuller.addOccluder(obj.model->getOccluderMesh(), obj.transform.mat4());
+				}
+			}
+			// the worker rasterizes while the candidates below are gathered and frustum culled, frames
+			// without occluders skip both rasterizing and testing
+			occlusionCuller.rasterize();
+		}
+
+		candidates.clear();
 		for (auto& kv : frameInfo.gameObjects)
 		{
 			auto& obj = kv.second;
 			if (obj.model == nullptr) continue; // skip rendering anything without models. additional systems can filter for their own render passes.
-			SimplePushConstantData push{};
-			auto modelMatrix = obj.transform.mat4();
-			push.modelMatrix = obj.transform.mat4();
-			push.normalMatrix = obj.transform.normalMatrix();
-			vkCmdPushConstants(frameInfo.commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(SimplePushConstantData), &push);
-
-			obj.model->bind(frameInfo.commandBuffer);
-			obj.model->draw(frameInfo.commandBuffer);
+			if (!obj.model->isResident()) continue; // still streaming in
+			if (skipStatic && obj.isStatic)
+			{
+				// counted so objects appearing or leaving record the cache again
+				staticObjectCount++;
+				continue;
+			}
+
+			candidates.push_back({ &obj, obj.transform.mat4() });
+			stats.trianglesFull += obj.model->getTriangleCount();
+			frustumCuller.add(obj.model->getBounds(), candidates.back().modelMatrix);
+		}
+		stats.objects = static_cast<uint32_t>(candidates.size());
+
+		if (frustumCulling)
+		{
+			for (uint32_t index : frustumCuller.cull())
+			{
+				addObject(candidates[index]);
+			}
+			stats.culledObjects = frustumCuller.getStats().culled;
+		}
+		else
+		{
+			for (const auto& candidate : candidates)
+			{
+				addObject(candidate);
+			}
+		}
+
+		uint32_t instanceCount = frameDraws.batcher.getInstanceCount();
+		if (instanceCount == 0)
+		{
+			return false;
+		}
+		auto instances = frameInfo.frameAllocator.allocate(instanceCount * sizeof(LdInstanceBatcher::Instance), sizeof(LdInstanceBatcher::Instance));
+		frameDraws.batcher.finish(static_cast<LdInstanceBatcher::Instance*>(instances.mapped));
+		// gl_InstanceIndex counts from the start of the slice the descriptor is bound at
+		frameDraws.baseInstance = static_cast<uint32_t>((instances.offset - frameInfo.frameAllocator.getFrameOffset()) / sizeof(LdInstanceBatcher::Instance));
+		frameDraws.instanceSetOffset = static_cast<uint32_t>(frameInfo.frameAllocator.getFrameOffset());
+
+		listDraws(frameDraws, stats.trianglesDrawn, stats.batches);
+		stats.drawCalls = static_cast<uint32_t>(frameDraws.draws.size());
+		stats.renderQueue = renderQueue.getStats();
+		return true;
+	}
+
+	void SimpleRenderSystem::listDraws(DrawList& drawList, uint64_t& triangles, uint32_t& batchCount)
+	{
+		// one entry per draw call, so recording can be split anywhere
+		unsortedDraws.clear();
+		renderQueue.begin();
+		bufferSlots.clear();
+		modelSlots.clear();
+		const auto& batches = drawList.batcher.getBatches();
+		const auto& ranges = drawList.batcher.getRanges();
+		for (uint32_t i = 0; i < batches.size(); i++)
+		{
+			const auto& batch = batches[i];
+			// the ranges of a batch only differ in where they start, their order within it is kept
+			uint64_t key = makeSortKey(batch);
+			if (batch.rangeCount > 0)
+			{
+				for (uint32_t range = batch.firstRange; range < batch.firstRange + batch.rangeCount; range++)
+				{
+					renderQueue.submit(key, static_cast<uint32_t>(unsortedDraws.size()));
+					unsortedDraws.push_back({ i, range });
+					triangles += ranges[range].indexCount / 3;
+				}
+			}
+			else
+			{
+				renderQueue.submit(key, static_cast<uint32_t>(unsortedDraws.size()));
+				unsortedDraws.push_back({ i, WHOLE_LEVEL });
+				triangles += static_cast<uint64_t>(batch.model->getTriangleCount(batch.lod)) * batch.instanceCount;
+				batchCount++;
+			}
+		}
+
+		renderQueue.sort();
+		drawList.draws.clear();
+		for (const auto& packet : renderQueue.getPackets())
+		{
+			drawList.draws.push_back(unsortedDraws[packet.payload]);
+		}
+	}
+
+	uint64_t SimpleRenderSystem::makeSortKey(const LdInstanceBatcher::Batch& batch)
+	{
+		// slots are handed out in the order buffers and models first show up, a handful of models share
+		// each arena block
+		const LdModel& model = *batch.model;
+		std::pair<VkBuffer, VkBuffer> buffers{ model.getVertexBuffer(), model.getIndexBuffer() };
+		auto bufferSlot = std::find(bufferSlots.begin(), bufferSlots.end(), buffers);
+		if (bufferSlot == bufferSlots.end())
+		{
+			bufferSlot = bufferSlots.insert(bufferSlots.end(), buffers);
+		}
+		uint32_t modelSlot = modelSlots.try_emplace(&model, static_cast<uint32_t>(modelSlots.size())).first->second;
+
+		// one pass and no materials yet, every model shades alike
+		return LdRenderQueue::makeKey(
+			0,
+			static_cast<uint32_t>(model.getVertexFormat()),
+			0,
+			static_cast<uint32_t>(bufferSlot - bufferSlots.begin()),
+			modelSlot * LdModel::MAX_LODS + batch.lod,
+			batch.depth);
+	}
+
+	VkCommandBuffer SimpleRenderSystem::getStaticCommandBuffer(FrameInfo& frameInfo, const LdParallelRecorder::Target& target)
+	{
+		if (staticObjectCount == 0)
+		{
+			return VK_NULL_HANDLE;
+		}
+		// each frame in flight has its own cache, this one's fence has signaled so it may be recorded again
+		StaticCache& cache = staticCaches[frameInfo.frameIndex];
+		if (cache.version != staticVersion || cache.objects != staticObjectCount || cache.globalUboOffset != frameInfo.globalUboOffset)
+		{
+			recordStaticObjects(cache, frameInfo, target);
+			stats.staticRecorded = true;
+		}
+		stats.staticObjects = cache.objects;
+		stats.staticDrawCalls = static_cast<uint32_t>(cache.drawList.draws.size());
+		stats.trianglesFull += cache.triangles;
+		stats.trianglesDrawn += cache.triangles;
+		return cache.commandBuffer;
+	}
+
+	void SimpleRenderSystem::recordStaticObjects(StaticCache& cache, FrameInfo& frameInfo, const LdParallelRecorder::Target& target)
+	{
+		// full detail and unculled, nothing in the buffer may depend on the camera
+		DrawList& drawList = cache.drawList;
+		drawList.batcher.begin();
+		for (auto& kv : frameInfo.gameObjects)
+		{
+			auto& obj = kv.second;
+			if (!obj.isStatic || obj.model == nullptr || !obj.model->isResident()) continue;
+
+			LdInstanceBatcher::Instance instance{};
+			instance.modelMatrix = obj.transform.mat4() * obj.model->getPositionTransform();
+			instance.normalMatrix = obj.transform.normalMatrix();
+			drawList.batcher.add(obj.model.get(), 0, instance);
+		}
+
+		uint32_t instanceCount = drawList.batcher.getInstanceCount();
+		if (cache.instances == nullptr || cache.instances->getInstanceCount() < instanceCount)
+		{
+			// room for half as many again, objects streaming in one at a time would grow it every frame
+			cache.instances = std::make_unique<LdBuffer>(
+				ldDevice,
+				sizeof(LdInstanceBatcher::Instance),
+				instanceCount + instanceCount / 2,
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			if (cache.instances->map() != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to map static instance buffer!");
+			}
+			auto bufferInfo = cache.instances->descriptorInfo(cache.instances->getBufferSize());
+			LdDescriptorWriter writer{ *instanceSetLayout, *instancePool };
+			writer.writeBuffer(0, &bufferInfo);
+			if (drawList.instanceSet == VK_NULL_HANDLE)
+			{
+				if (!writer.build(drawList.instanceSet))
+				{
+					throw std::runtime_error("failed to allocate static instance descriptor set!");
+				}
+			}
+			else
+			{
+				writer.overwrite(drawList.instanceSet);
+			}
+		}
+		drawList.batcher.finish(static_cast<LdInstanceBatcher::Instance*>(cache.instances->getMappedMemory()));
+		drawList.instanceSetOffset = 0;
+		drawList.baseInstance = 0;
+		cache.triangles = 0;
+		uint32_t batches = 0;
+		listDraws(drawList, cache.triangles, batches);
+
+		if (cache.commandBuffer == VK_NULL_HANDLE)
+		{
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			allocInfo.commandPool = staticCommandPool;
+			allocInfo.commandBufferCount = 1;
+			if (vkAllocateCommandBuffers(ldDevice.device(), &allocInfo, &cache.commandBuffer) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to allocate static command buffer!");
+			}
+		}
+		// no framebuffer, the buffer is executed with whichever swap chain image the frame renders to
+		LdParallelRecorder::Target cacheTarget{ target.renderPass, VK_NULL_HANDLE, target.extent };
+		LdParallelRecorder::beginCommandBuffer(cache.commandBuffer, cacheTarget, 0);
+		recordDraws(cache.commandBuffer, frameInfo, drawList, 0, static_cast<uint32_t>(drawList.draws.size()));
+		if (vkEndCommandBuffer(cache.commandBuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to record static command buffer!");
+		}
+
+		cache.version = staticVersion;
+		cache.objects = staticObjectCount;
+		cache.globalUboOffset = frameInfo.globalUboOffset;
+	}
+
+	uint32_t SimpleRenderSystem::recordDraws(VkCommandBuffer commandBuffer, FrameInfo& frameInfo, const DrawList& drawList, uint32_t firstDraw, uint32_t drawCount)
+	{
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &frameInfo.globalDescriptorSet, 1, &frameInfo.globalUboOffset);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &drawList.instanceSet, 1, &drawList.instanceSetOffset);
+
+		uint32_t bufferBinds = 0;
+		LdPipeline* boundPipeline = nullptr;
+		VkBuffer boundVertexBuffer = VK_NULL_HANDLE;
+		VkBuffer boundIndexBuffer = VK_NULL_HANDLE;
+		const auto& draws = drawList.draws;
+		const auto& batches = drawList.batcher.getBatches();
+		const auto& ranges = drawList.batcher.getRanges();
+		for (uint32_t i = firstDraw; i < firstDraw + drawCount; i++)
+		{
+			const auto& batch = batches[draws[i].batch];
+			LdModel& model = *batch.model;
+			LdPipeline* pipeline = ldPipelines[static_cast<size_t>(model.getVertexFormat())].get();
+			if (pipeline != boundPipeline)
+			{
+				pipeline->bind(commandBuffer);
+				boundPipeline = pipeline;
+			}
+			if (model.getVertexBuffer() != boundVertexBuffer || model.getIndexBuffer() != boundIndexBuffer)
+			{
+				model.bind(commandBuffer);
+				boundVertexBuffer = model.getVertexBuffer();
+				boundIndexBuffer = model.getIndexBuffer();
+				bufferBinds++;
+			}
+
+			uint32_t firstInstance = drawList.baseInstance + batch.firstInstance;
+			if (draws[i].range != WHOLE_LEVEL)
+			{
+				const auto& range = ranges[draws[i].range];
+				model.drawRange(commandBuffer, range.firstIndex, range.indexCount, 1, firstInstance);
+			}
+			else
+			{
+				model.drawLod(commandBuffer, batch.lod, batch.instanceCount, firstInstance);
+			}
+		}
+		return bufferBinds;
+	}
+
+	void SimpleRenderSystem::addObject(const Candidate& candidate)
+	{
+		LdGameObject& obj = *candidate.object;
+		const glm::mat4& modelMatrix = candidate.modelMatrix;
+		if (occlusionCulling && occlusionCuller.hasOccluders() && occlusionCuller.isOccluded(obj.model->getBounds(), modelMatrix))
+		{
+			stats.occludedObjects++;
+			return;
+		}
+		uint32_t lod = lodSelection
+			? lodSelector.select(obj.model->getLods(), obj.model->getBoundsCenter(), obj.model->getBoundsRadius(), modelMatrix)
+			: 0;
+		stats.objectsPerLod[lod]++;
+
+		LdInstanceBatcher::Instance instance{};
+		// packed models store positions relative to their bounds
+		instance.modelMatrix = modelMatrix * obj.model->getPositionTransform();
+		instance.normalMatrix = obj.transform.normalMatrix();
+
+		// nearest first among draws of the same state, it lets early depth testing reject more
+		float depth = glm::length(glm::vec3{ modelMatrix * glm::vec4{ obj.model->getBoundsCenter(), 1.f } } - cameraPosition);
+
+		// meshlets only cover the full detail level
+		const auto& meshlets = obj.model->getMeshlets();
+		if (meshletCulling && lod == 0 && meshlets.size() > 1)
+		{
+			meshletCuller.cull(meshlets, modelMatrix, drawRanges);
+			if (drawRanges.empty()) return;
+			frameDraws.batcher.addRanges(obj.model.get(), instance, drawRanges, depth);
+		}
+		else
+		{
+			frameDraws.batcher.add(obj.model.get(), lod, instance, depth);
 		}
 	}
 
@@ -1,32 +1,192 @@
 #pragma once
 
+#include "ld_buffer.hpp"
 #include "ld_camera.hpp"
 #include "ld_pipeline.hpp"
 #include "ld_device.hpp"
+#include "ld_descriptors.hpp"
 #include "ld_game_object.hpp" 
 #include "ld_frame_info.hpp"
+#include "ld_frustum_culler.hpp"
+#include "ld_instance_batcher.hpp"
+#include "ld_lod_selector.hpp"
+#include "ld_meshlet_culler.hpp"
+#include "ld_occlusion_culler.hpp"
+#include "ld_parallel_recorder.hpp"
+#include "ld_render_queue.hpp"
 
+#include <array>
 #include <memory>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace ld {
+	// Draws every game object with a model, one instanced draw per model and level of detail. The
+	// model and normal matrices go to the frame allocator, the vertex shaders read them through a
+	// storage buffer at set 1 indexed by gl_InstanceIndex. The draws go through an LdRenderQueue, which
+	// orders them by pipeline, buffers and model, then nearest first.
+	//
+	// With staticCaching, objects marked isStatic are drawn from a secondary command buffer per frame in
+	// flight that is recorded once, with instances in a buffer of its own. They cost the cpu nothing per
+	// frame until the cache has to be recorded again, but skip frustum, occlusion and meshlet culling and
+	// always draw their finest level of detail.
 	class SimpleRenderSystem {
 	public:
-		SimpleRenderSystem(LdDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+		// what the last renderGameObjects() call drew
+		struct RenderStats {
+			// resident objects with a model, before culling, cached static objects not included
+			uint32_t objects = 0;
+			// static objects and their draws, executed from the cached command buffer
+			uint32_t staticObjects = 0;
+			uint32_t staticDrawCalls = 0;
+			// the cache was recorded again this frame
+			bool staticRecorded = false;
+			// whole objects outside the frustum, see LdFrustumCuller
+			uint32_t culledObjects = 0;
+			// inside the frustum but behind the occluders, see LdOcclusionCuller
+			uint32_t occludedObjects = 0;
+			uint32_t drawCalls = 0;
+			// secondary command buffers the draws were recorded into, 0 when recorded inline
+			uint32_t recordSlices = 0;
+			// recording the draw list once it is built, waiting for the recording threads included
+			double recordMilliseconds = 0.0;
+			// instanced draws of whole levels, objects of the same model and level share one
+			uint32_t batches = 0;
+			// vertex / index buffer binds, one per pass and vertex format while models share the arena
+			uint32_t bufferBinds = 0;
+			// the frame's draws in the order they were gathered and sorted, cached static draws not included
+			LdRenderQueue::Stats renderQueue{};
+			// every object at full detail and without culling
+			uint64_t trianglesFull = 0;
+			uint64_t trianglesDrawn = 0;
+			std::array<uint32_t, LdModel::MAX_LODS> objectsPerLod{};
+		};
+
+		// instance data is allocated from frameAllocator, which must be the one passed in each FrameInfo
+		SimpleRenderSystem(LdDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, LdFrameAllocator& frameAllocator);
 		~SimpleRenderSystem();
 		SimpleRenderSystem(const SimpleRenderSystem&) = delete;
 		SimpleRenderSystem& operator=(const SimpleRenderSystem&) = delete;
 	
 	private:
 		LdDevice &ldDevice;
-		std::unique_ptr<LdPipeline> ldPipeline;
+		// one pipeline per LdModel::VertexFormat, models pick theirs when drawn
+		std::array<std::unique_ptr<LdPipeline>, static_cast<size_t>(LdModel::VertexFormat::Count)> ldPipelines;
 		VkPipelineLayout pipelineLayout;
+		std::unique_ptr<LdDescriptorSetLayout> instanceSetLayout;
+		std::unique_ptr<LdDescriptorPool> instancePool;
+		// spans one frame allocator slice, bound at the current slice's offset
+		VkDescriptorSet instanceDescriptorSet;
+
+		// objects waiting for the frustum culler's verdict
+		struct Candidate {
+			LdGameObject* object;
+			glm::mat4 modelMatrix;
+		};
+
+		static constexpr uint32_t WHOLE_LEVEL = ~0u;
+
+		// one draw call, a range of a meshlet culled batch or its whole level
+		struct Draw {
+			uint32_t batch;
+			uint32_t range;
+		};
+
+		// draws of one batcher's batches and where its instances are bound
+		struct DrawList {
+			LdInstanceBatcher batcher{};
+			std::vector<Draw> draws{};
+			VkDescriptorSet instanceSet = VK_NULL_HANDLE;
+			uint32_t instanceSetOffset = 0;
+			// gl_InstanceIndex counts from instanceSetOffset, the list's instances start here
+			uint32_t baseInstance = 0;
+		};
+
+		// the static objects as one frame in flight draws them
+		struct StaticCache {
+			DrawList drawList{};
+			std::unique_ptr<LdBuffer> instances{};
+			VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+			// what the buffer was recorded for, it is recorded again when any of them changes
+			uint64_t version = 0;
+			uint32_t objects = 0;
+			uint32_t globalUboOffset = 0;
+			uint64_t triangles = 0;
+		};
+
+		std::vector<Candidate> candidates{};
+		glm::vec3 cameraPosition{};
+		LdFrustumCuller frustumCuller{};
+		LdOcclusionCuller occlusionCuller{};
+		LdMeshletCuller meshletCuller{};
+		// meshlets are only cone culled when the pipelines discard back faces
+		bool backFaceCulling = false;
+		std::vector<LdMeshletCuller::DrawRange> drawRanges{};
+		LdLodSelector lodSelector{};
+		// this frame's instances live in the frame allocator, see buildDraws()
+		DrawList frameDraws{};
+		LdRenderQueue renderQueue{};
+		// draws before sorting and the small numbers their buffers and models get in the sort key
+		std::vector<Draw> unsortedDraws{};
+		std::vector<std::pair<VkBuffer, VkBuffer>> bufferSlots{};
+		std::unordered_map<const LdModel*, uint32_t> modelSlots{};
+		std::vector<uint32_t> sliceBufferBinds{};
+		RenderStats stats{};
+
+		// reset one buffer at a time as a cache is recorded again
+		VkCommandPool staticCommandPool = VK_NULL_HANDLE;
+		std::array<StaticCache, LdSwapChain::MAX_FRAMES_IN_FLIGHT> staticCaches{};
+		uint64_t staticVersion = 1;
+		// resident static objects seen by the last buildDraws()
+		uint32_t staticObjectCount = 0;
 
 	public:
+		// objects whose bounds lie outside the frustum never reach lod selection and batching
+		bool frustumCulling = true;
+		// objects hidden behind game objects marked as occluders are skipped, tested after the frustum
+		bool occlusionCulling = true;
+		// models with more than one meshlet are frustum culled per meshlet, and cone culled as well when
+		// the pipelines cull back faces
+		bool meshletCulling = true;
+		// objects further away draw a coarser level of their model, see LdLodSelector::Settings
+		bool lodSelection = true;
+		// static objects come from cached command buffers when drawn through an LdParallelRecorder,
+		// opt-in since they are then never culled
+		bool staticCaching = false;
+
 		void renderGameObjects(FrameInfo &frameInfo);
+		// Records the draws into secondary command buffers on the recorder's threads and executes them
+		// on frameInfo.commandBuffer, whose pass has to be begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+		// The cached static objects are executed first. Only the render pass and extent of target matter
+		// to them, the cache stays valid for every framebuffer of the swap chain.
+		void renderGameObjects(FrameInfo& frameInfo, LdParallelRecorder& recorder, const LdParallelRecorder::Target& target);
+		// Call after moving a static object or changing its model, and when the swap chain, its render
+		// pass or the buffers of the models are recreated. Static objects appearing or leaving are noticed.
+		void invalidateStaticObjects() { staticVersion++; }
+		const LdMeshletCuller::Stats& getMeshletStats() const { return meshletCuller.getStats(); }
+		const LdFrustumCuller& getFrustumCuller() const { return frustumCuller; }
+		const LdOcclusionCuller& getOcclusionCuller() const { return occlusionCuller; }
+		const RenderStats& getStats() const { return stats; }
+		LdLodSelector::Settings& getLodSettings() { return lodSelector.getSettings(); }
 
 	private:
+		void createInstanceDescriptorSet(LdFrameAllocator& frameAllocator);
 		void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
 		void createPipeline(VkRenderPass renderPass);
+		void createStaticCommandPool();
+		void addObject(const Candidate& candidate);
+		// culls, batches and uploads the instances, false when nothing is left to draw. Static objects
+		// are left to the cache when skipStatic is set.
+		bool buildDraws(FrameInfo& frameInfo, bool skipStatic);
+		// One draw per range or whole level of the list's finished batcher, in the render queue's order.
+		// Counts what they draw into triangles and batchCount.
+		void listDraws(DrawList& drawList, uint64_t& triangles, uint32_t& batchCount);
+		uint64_t makeSortKey(const LdInstanceBatcher::Batch& batch);
+		// the frame's static cache, recorded again first if it is out of date, VK_NULL_HANDLE without static objects
+		VkCommandBuffer getStaticCommandBuffer(FrameInfo& frameInfo, const LdParallelRecorder::Target& target);
+		void recordStaticObjects(StaticCache& cache, FrameInfo& frameInfo, const LdParallelRecorder::Target& target);
+		// safe to call from several threads at once on different command buffers, returns the buffer binds
+		uint32_t recordDraws(VkCommandBuffer commandBuffer, FrameInfo& frameInfo, const DrawList& drawList, uint32_t firstDraw, uint32_t drawCount);
 	};
 }
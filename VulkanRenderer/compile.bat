@@ -1,5 +1,10 @@
-"C:\VulkanSDK\1.3.268.0\Bin\glslc.exe" shaders\simple_shader.vert -o shaders\simple_shader.vert.spv
-"C:\VulkanSDK\1.3.268.0\Bin\glslc.exe" shaders\simple_shader.frag -o shaders\simple_shader.frag.spv
-"C:\VulkanSDK\1.3.268.0\Bin\glslc.exe" shaders\point_light.vert -o shaders\point_light.vert.spv
-"C:\VulkanSDK\1.3.268.0\Bin\glslc.exe" shaders\point_light.frag -o shaders\point_light.frag.spv
-pause
\ No newline at end of file
+@echo off
+rem Builds every shader into its .spv next to the source, run before each build by the project's prebuild event.
+rem The binaries are not checked in, they only ever come from these sources.
+set GLSLC="C:\VulkanSDK\1.3.268.0\Bin\glslc.exe"
+if defined VULKAN_SDK set GLSLC="%VULKAN_SDK%\Bin\glslc.exe"
+cd /d "%~dp0"
+
+for %%s in (simple_shader.vert simple_shader_packed.vert simple_shader.frag point_light.vert point_light.frag cull.comp depth_pyramid.comp) do (
+	%GLSLC% shaders\%%s -o shaders\%%s.spv || exit /b 1
+)
@@ -22,12 +22,6 @@ layout(set = 0, binding = 0) uniform GlobalUBO
 	int numLights;
 } ubo;
 
-layout(push_constant) uniform Push 
-{ 
-	mat4 modelMatrix; // projection * view * model
-	mat4 normalMatrix;
-} push;
-
 void main()
 {
 	vec3 diffuseLight = ubo.ambientLightColor.xyz * ubo.ambientLightColor.w;
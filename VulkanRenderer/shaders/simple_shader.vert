@@ -25,21 +25,28 @@ layout(set = 0, binding = 0) uniform GlobalUBO
 	int numLights;
 } ubo;
 
-layout(push_constant) uniform Push 
-{ 
-	mat4 modelMatrix; // projection * view * model
+// per instance data, see LdInstanceBatcher::Instance
+struct Instance
+{
+	mat4 modelMatrix;
 	mat4 normalMatrix;
-} push;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer Instances
+{
+	Instance instances[];
+};
 
 
 void main()
 {
-	vec4 positionWorld = push.modelMatrix * vec4(position, 1.0);
+	Instance instance = instances[gl_InstanceIndex];
+	vec4 positionWorld = instance.modelMatrix * vec4(position, 1.0);
 
 	gl_Position = ubo.projection * ubo.view * positionWorld;
 	 
 	 // nonuniform scaling
-	fragNormalWorld = normalize(mat3(push.normalMatrix) * normal);
+	fragNormalWorld = normalize(mat3(instance.normalMatrix) * normal);
 	fragPosWorld = positionWorld.xyz;
 	fragColor = color;
 
@@ -0,0 +1,67 @@
+#version 450
+
+// packed vertex layout, see LdModel::PackedVertex
+// position is unorm16 or half relative to the model bounds, the model matrix expands it again
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec2 normalOct;
+layout(location = 3) in vec2 uv;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosWorld;
+layout(location = 2) out vec3 fragNormalWorld;
+
+struct PointLight 
+{
+	vec4 position;
+	vec4 color;
+};
+
+layout(set = 0, binding = 0) uniform GlobalUBO
+{
+	mat4 projection;
+	mat4 view;
+	mat4 invView;
+	vec4 ambientLightColor;
+	PointLight pointLights[10]; // can be specialized constant
+	int numLights;
+} ubo;
+
+// per instance data, see LdInstanceBatcher::Instance
+struct Instance
+{
+	mat4 modelMatrix;
+	mat4 normalMatrix;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer Instances
+{
+	Instance instances[];
+};
+
+
+vec3 octDecode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+void main()
+{
+	vec3 normal = octDecode(normalOct);
+
+	Instance instance = instances[gl_InstanceIndex];
+	vec4 positionWorld = instance.modelMatrix * vec4(position, 1.0);
+
+	gl_Position = ubo.projection * ubo.view * positionWorld;
+	 
+	 // nonuniform scaling
+	fragNormalWorld = normalize(mat3(instance.normalMatrix) * normal);
+	fragPosWorld = positionWorld.xyz;
+	fragColor = color;
+
+
+}
\ No newline at end of file
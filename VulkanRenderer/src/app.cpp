@@ -3,6 +3,7 @@
 #include "keyboard_movement_controller.hpp"
 #include "ld_camera.hpp"
 #include "systems/simple_render_system.hpp"
+#include "systems/gpu_driven_render_system.hpp"
 #include "systems/point_light_system.hpp"
 #include "ld_buffer.hpp"
 
@@ -12,22 +13,134 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
+#include <algorithm>
 #include <stdexcept>
 #include <chrono>
+#include <cmath>
 #include <array>
+#include <iostream>
+#include <string>
+#include <unordered_set>
 
 namespace ld {
 	// be aware of alignment rules std140
 
+	namespace {
+		// the cpu path writes one instance per drawn object, at most every object with a model each frame
+		LdFrameAllocator::Settings frameAllocatorSettings(uint32_t vaseCount)
+		{
+			// the vases plus the three objects loadGameObjects() always adds, and room for the uniforms
+			VkDeviceSize instanceBytes = (static_cast<VkDeviceSize>(vaseCount) + 3) * sizeof(LdInstanceBatcher::Instance);
+			LdFrameAllocator::Settings settings{};
+			settings.frameSize = std::max<VkDeviceSize>(16ull * 1024 * 1024, instanceBytes + 1024 * 1024);
+			return settings;
+		}
+
+		void logSceneIndexBuffers(LdGameObject::Map& gameObjects)
+		{
+			// models can be shared between objects, count each one once
+			std::unordered_set<const LdModel*> models{};
+			VkDeviceSize indexBytes = 0;
+			VkDeviceSize indexBytesSaved = 0;
+			for (auto& kv : gameObjects)
+			{
+				const LdModel* model = kv.second.model.get();
+				if (model != nullptr && models.insert(model).second)
+				{
+					indexBytes += model->getIndexBufferSize();
+					indexBytesSaved += model->getIndexBytesSaved();
+				}
+			}
+			std::cout << "scene index buffers: " << indexBytes / 1024.0 << " KiB, "
+				<< indexBytesSaved / 1024.0 << " KiB saved by 16 bit indices" << std::endl;
+		}
+
+		void logModelRegistry(const LdModelRegistry::Stats& stats)
+		{
+			std::cout << "model registry: " << stats.models << " models, " << stats.residentBytes / 1024.0 << " KiB resident, "
+				<< stats.hits << " hits, " << stats.misses << " misses, " << stats.evictions << " evictions, " << stats.failures << " failed, "
+				<< stats.pressureUpdates << " updates under memory pressure" << std::endl;
+		}
 
-	App::App()
+		void logGeometryArena(const LdGeometryArena::Stats& stats)
+		{
+			std::cout << "geometry arena: " << stats.allocations << " models in " << stats.blocks << " blocks, "
+				<< stats.usedBytes / 1024.0 << " of " << stats.capacityBytes / 1024.0 << " KiB used, "
+				<< stats.compactions << " compactions moved " << stats.bytesMoved / 1024.0 << " KiB" << std::endl;
+		}
+
+		void logMemoryHeaps(const LdMemoryAllocator& allocator)
+		{
+			static const char* categoryNames[] = { "geometry", "staging", "uniforms", "attachments", "other" };
+			static_assert(sizeof(categoryNames) / sizeof(categoryNames[0]) == static_cast<size_t>(LdMemoryCategory::Count),
+				"one name per memory category");
+
+			std::cout << "device memory: " << allocator.getDeviceAllocationCount() << " allocations, budget "
+				<< (allocator.hasDriverBudget() ? "from VK_EXT_memory_budget" : "estimated") << std::endl;
+			const auto heaps = allocator.getHeapStats();
+			for (size_t i = 0; i < heaps.size(); i++)
+			{
+				const auto& heap = heaps[i];
+				std::cout << "    heap " << i << (heap.deviceLocal ? " (device local)" : "") << ": "
+					<< heap.allocations << " allocations, " << heap.allocatedBytes / (1024.0 * 1024.0) << " MiB in "
+					<< heap.blocks << " blocks of " << heap.blockBytes / (1024.0 * 1024.0) << " MiB, "
+					<< heap.dedicatedAllocations << " dedicated, " << heap.dedicatedBytes / (1024.0 * 1024.0) << " MiB, of "
+					<< heap.heapSize / (1024.0 * 1024.0) << " MiB" << std::endl;
+				std::cout << "        usage " << heap.usage / (1024.0 * 1024.0) << " of " << heap.budget / (1024.0 * 1024.0)
+					<< " MiB budget,";
+				for (size_t category = 0; category < heap.categoryBytes.size(); category++)
+				{
+					std::cout << ' ' << categoryNames[category] << ' ' << heap.categoryBytes[category] / (1024.0 * 1024.0) << " MiB";
+				}
+				std::cout << std::endl;
+			}
+		}
+
+		void logFrameStats(const SimpleRenderSystem::RenderStats& stats, const LdFrameAllocator::Stats& transient)
+		{
+			double drawnPercent = stats.trianglesFull ? 100.0 * stats.trianglesDrawn / stats.trianglesFull : 100.0;
+			std::cout << "frame: " << stats.objects << " objects (" << stats.culledObjects << " frustum culled, " << stats.occludedObjects << " occluded) and "
+				<< stats.staticObjects << " static in " << stats.staticDrawCalls << " cached draws" << (stats.staticRecorded ? " recorded again, " : ", ") << stats.drawCalls << " draws (" << stats.batches << " instanced) recorded in " << stats.recordMilliseconds << " ms"
+				<< (stats.recordSlices > 0 ? " on " + std::to_string(stats.recordSlices) + " threads, " : ", ") << stats.bufferBinds << " buffer binds ("
+				<< stats.renderQueue.submitted.buffers << " unsorted), " << stats.renderQueue.sorted.pipelines << " pipeline changes ("
+				<< stats.renderQueue.submitted.pipelines << " unsorted), "
+				<< stats.trianglesDrawn << " of " << stats.trianglesFull << " triangles (" << drawnPercent << "%), objects per lod";
+			for (uint32_t count : stats.objectsPerLod)
+			{
+				std::cout << ' ' << count;
+			}
+			std::cout << ", transient " << transient.allocations << " allocations " << transient.usedBytes / 1024.0
+				<< " KiB (peak " << transient.peakBytes / 1024.0 << " of " << transient.frameSize / 1024.0 << " KiB)" << std::endl;
+		}
+
+		void logFrameStats(const GpuDrivenRenderSystem::RenderStats& stats)
+		{
+			std::cout << "frame (gpu driven): " << stats.visibleObjects << " of " << stats.objects << " objects visible, "
+				<< stats.occludedObjects << " occluded (" << stats.disoccludedObjects << " disoccluded), "
+				<< stats.drawCalls << " indirect draws for " << stats.groups << " groups, "
+				<< stats.sceneUploads << " scene uploads, last " << stats.sceneBytes / 1024.0 << " KiB" << std::endl;
+		}
+	}
+
+
+	App::App(Options options)
+		: frameAllocator{ ldDevice, frameAllocatorSettings(options.vaseCount) },
+		options{ options }
 	{
 		globalPool = LdDescriptorPool::Builder(ldDevice)
 			.setMaxSets(LdSwapChain::MAX_FRAMES_IN_FLIGHT)
-			.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, LdSwapChain::MAX_FRAMES_IN_FLIGHT)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, LdSwapChain::MAX_FRAMES_IN_FLIGHT)
 			.build();
 
-		loadGameObjects();
+		// the geometry arena creates its first block with the first model, after this
+		ldDevice.setUploadPolicy(options.uploadPolicy);
+		std::cout << "host visible device local memory: " << ldDevice.getHostVisibleDeviceLocalSize() / (1024 * 1024) << " MiB, "
+			<< (ldDevice.useDirectUploads() ? "direct" : "staged") << " static uploads" << std::endl;
+
+		LdModel::ImportSettings& importSettings = assetStreamer.getImportSettings();
+		importSettings.optimize = options.optimizeMeshes;
+		importSettings.verbose = options.verboseImport;
+		loadGameObjects(options.vaseCount);
 	}
 
 	App::~App()
@@ -36,37 +149,44 @@ namespace ld {
 
 	void App::run()
 	{
-		std::vector<std::unique_ptr<LdBuffer>> uboBuffers(LdSwapChain::MAX_FRAMES_IN_FLIGHT);
-		for (int i = 0; i < uboBuffers.size(); i++)
-		{
-			uboBuffers[i] = std::make_unique<LdBuffer>(
-				ldDevice,
-				sizeof(GlobalUBO),
-				1,
-				VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
-			);
-			uboBuffers[i]->map();
-		}
-
+		// the GlobalUBO lives in the frame allocator, every frame binds the set at its own offset
 		auto globalSetLayout = LdDescriptorSetLayout::Builder(ldDevice)
-			.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
+			.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_ALL_GRAPHICS)
 			.build();
 
-		std::vector<VkDescriptorSet> globalDescriptorSets(LdSwapChain::MAX_FRAMES_IN_FLIGHT);
-
-		for (int i = 0; i < globalDescriptorSets.size(); i++)
-		{
-			auto bufferInfo = uboBuffers[i]->descriptorInfo();
-			LdDescriptorWriter(*globalSetLayout, *globalPool)
-				.writeBuffer(0, &bufferInfo)
-				.build(globalDescriptorSets[i]);
+		VkDescriptorSet globalDescriptorSet;
+		auto bufferInfo = frameAllocator.descriptorInfo(sizeof(GlobalUBO));
+		LdDescriptorWriter(*globalSetLayout, *globalPool)
+			.writeBuffer(0, &bufferInfo)
+			.build(globalDescriptorSet);
 
 
+		SimpleRenderSystem simpleRenderSystem{ ldDevice, ldRenderer.getSwapChainRenderPass() , globalSetLayout->getDescriptorSetLayout(), frameAllocator };
+		std::unique_ptr<GpuDrivenRenderSystem> gpuDrivenRenderSystem{};
+		if (options.gpuDriven && ldDevice.supportsMultiDrawIndirect())
+		{
+			gpuDrivenRenderSystem = std::make_unique<GpuDrivenRenderSystem>(ldDevice, ldRenderer.getSwapChainRenderPass(), globalSetLayout->getDescriptorSetLayout());
+			std::cout << "gpu driven rendering, " << (ldDevice.cmdDrawIndexedIndirectCount() ? "indirect count draws" : "indirect draws") << std::endl;
 		}
-
-
-		SimpleRenderSystem simpleRenderSystem{ ldDevice, ldRenderer.getSwapChainRenderPass() , globalSetLayout->getDescriptorSetLayout() };
+		else if (options.gpuDriven)
+		{
+			std::cout << "gpu driven rendering needs multiDrawIndirect, drawing from the cpu" << std::endl;
+		}
+		// the gpu driven path records a handful of indirect draws, only the cpu path is worth spreading out
+		std::unique_ptr<LdParallelRecorder> parallelRecorder{};
+		if (!gpuDrivenRenderSystem && (options.recordWorkers > 0 || options.staticCaching))
+		{
+			parallelRecorder = std::make_unique<LdParallelRecorder>(ldDevice, options.recordWorkers);
+			std::cout << "recording draws on up to " << parallelRecorder->getMaxSlices() << " threads" << std::endl;
+		}
+		// cached buffers are executed, so the pass has to take secondary command buffers
+		simpleRenderSystem.staticCaching = parallelRecorder && options.staticCaching;
+		if (simpleRenderSystem.staticCaching)
+		{
+			std::cout << "static objects drawn from cached command buffers" << std::endl;
+		}
+		std::cout << "frustum culling with " << LdFrustumCuller::instructionSetName(simpleRenderSystem.getFrustumCuller().getInstructionSet())
+			<< ", occlusion culling with " << LdFrustumCuller::instructionSetName(simpleRenderSystem.getOcclusionCuller().getInstructionSet()) << std::endl;
 		PointLightSystem pointLightSystem{ ldDevice, ldRenderer.getSwapChainRenderPass() , globalSetLayout->getDescriptorSetLayout() };
 		LdCamera camera{};
 
@@ -76,10 +196,51 @@ namespace ld {
 
 
 		auto currentTime = std::chrono::high_resolution_clock::now();
+		float statsTimer = 0.f;
+		bool sceneLoaded = false;
+		bool overBudget = false;
+		// the gpu driven scene is rebuilt when models become resident or the arena moves them
+		uint64_t sceneKey = 0;
+		// the static cache also references the swap chain's render pass
+		uint64_t staticKey = 0;
 		while (!ldWindow.shouldClose())
 		{
 			glfwPollEvents();
 
+			// the registry and streamer react to the budget, so it is refreshed first
+			ldDevice.memoryAllocator().updateBudget();
+			if (overBudget != (ldDevice.memoryAllocator().getBudgetOvershoot(modelRegistry.getSettings().budgetPressure) > 0))
+			{
+				overBudget = !overBudget;
+				std::cout << (overBudget ? "over memory budget, evicting models" : "back under memory budget") << std::endl;
+				logMemoryHeaps(ldDevice.memoryAllocator());
+			}
+
+			// models stream in over the first frames, objects appear as they become resident
+			assetStreamer.update();
+			modelRegistry.update();
+			geometryArena.update();
+			if (!sceneLoaded && assetStreamer.getPendingCount() == 0)
+			{
+				sceneLoaded = true;
+				logSceneIndexBuffers(gameObjects);
+				logModelRegistry(modelRegistry.getStats());
+				logGeometryArena(geometryArena.getStats());
+				logMemoryHeaps(ldDevice.memoryAllocator());
+			}
+			uint64_t newSceneKey = assetStreamer.getStats().resident + geometryArena.getStats().compactions;
+			if (gpuDrivenRenderSystem && newSceneKey != sceneKey)
+			{
+				sceneKey = newSceneKey;
+				gpuDrivenRenderSystem->invalidateScene();
+			}
+			uint64_t newStaticKey = newSceneKey + ldRenderer.getSwapChainGeneration();
+			if (newStaticKey != staticKey)
+			{
+				staticKey = newStaticKey;
+				simpleRenderSystem.invalidateStaticObjects();
+			}
+
 			auto newTime = std::chrono::high_resolution_clock::now();
 			float frameTime = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
 			currentTime = newTime;
@@ -89,17 +250,26 @@ namespace ld {
 
 			float aspect = ldRenderer.getAspectRatio();
 			camera.setPerspectiveProjection(glm::radians(50.f), aspect, 0.1f, 100.f);
+			simpleRenderSystem.getLodSettings().viewportHeight = static_cast<float>(ldRenderer.getSwapChainExtent().height);
 
 			// beginFrame() returns nullptr if swapchain needs to be recreated
 			if (auto commandBuffer = ldRenderer.beginFrame()) {
 				int frameIndex = ldRenderer.getFrameIndex();
+				// beginFrame() waited for this frame's fence, its slice is free again
+				frameAllocator.beginFrame(frameIndex);
+				if (parallelRecorder)
+				{
+					parallelRecorder->beginFrame(frameIndex);
+				}
 				FrameInfo frameInfo{
 					frameIndex,
 					frameTime,
 					commandBuffer,
 					camera,
-					globalDescriptorSets[frameIndex],
-					gameObjects
+					globalDescriptorSet,
+					0,
+					gameObjects,
+					frameAllocator
 				};
 				// update objects in memory
 				GlobalUBO ubo{};
@@ -107,48 +277,118 @@ namespace ld {
 				ubo.view = camera.getView();
 				ubo.inverseView = camera.getInverseView();
 				pointLightSystem.update(frameInfo, ubo);
-				uboBuffers[frameIndex]->writeToBuffer(&ubo);
-				uboBuffers[frameIndex]->flush();
+				frameInfo.globalUboOffset = static_cast<uint32_t>(frameAllocator.write(ubo).offset);
+				bool occlusionCulling = gpuDrivenRenderSystem && gpuDrivenRenderSystem->occlusionCulling && ldRenderer.canSplitSwapChainRenderPass();
+				if (gpuDrivenRenderSystem)
+				{
+					gpuDrivenRenderSystem->prepare(frameInfo, ldRenderer.getSwapChainExtent(), occlusionCulling);
+				}
 
 				// additional render passes can be added here later
 				//render
-				ldRenderer.beginSwapChainRenderPass(commandBuffer);
-				
-				simpleRenderSystem.renderGameObjects(frameInfo);
-				pointLightSystem.render(frameInfo);
+				if (occlusionCulling)
+				{
+					// the depth pyramid is built between the two parts from the early phase's depth
+					ldRenderer.beginSwapChainRenderPass(commandBuffer, LdSwapChain::RenderPassPart::Early);
+					gpuDrivenRenderSystem->render(frameInfo);
+					ldRenderer.endSwapChainRenderPass(commandBuffer);
+					gpuDrivenRenderSystem->prepareLate(frameInfo, ldRenderer.getCurrentDepthImageView());
+					ldRenderer.beginSwapChainRenderPass(commandBuffer, LdSwapChain::RenderPassPart::Late);
+					gpuDrivenRenderSystem->renderLate(frameInfo);
+				}
+				else if (parallelRecorder)
+				{
+					// the pass only takes secondary command buffers, the point lights get one of their own
+					LdParallelRecorder::Target target{ ldRenderer.getSwapChainRenderPass(), ldRenderer.getCurrentFramebuffer(), ldRenderer.getSwapChainExtent() };
+					ldRenderer.beginSwapChainRenderPass(commandBuffer, LdSwapChain::RenderPassPart::Whole, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+					simpleRenderSystem.renderGameObjects(frameInfo, *parallelRecorder, target);
+					FrameInfo lightFrameInfo = frameInfo;
+					lightFrameInfo.commandBuffer = parallelRecorder->beginSecondary(target);
+					pointLightSystem.render(lightFrameInfo);
+					if (vkEndCommandBuffer(lightFrameInfo.commandBuffer) != VK_SUCCESS)
+					{
+						throw std::runtime_error("failed to record secondary command buffer!");
+					}
+					vkCmdExecuteCommands(commandBuffer, 1, &lightFrameInfo.commandBuffer);
+				}
+				else
+				{
+					ldRenderer.beginSwapChainRenderPass(commandBuffer);
+					if (gpuDrivenRenderSystem)
+					{
+						gpuDrivenRenderSystem->render(frameInfo);
+					}
+					else
+					{
+						simpleRenderSystem.renderGameObjects(frameInfo);
+					}
+				}
+				if (!parallelRecorder)
+				{
+					pointLightSystem.render(frameInfo);
+				}
 				
 				ldRenderer.endSwapChainRenderPass(commandBuffer);
 				ldRenderer.endFrame();
 			}
+
+			statsTimer += frameTime;
+			if (options.frameStats && statsTimer >= 1.f)
+			{
+				statsTimer = 0.f;
+				if (gpuDrivenRenderSystem)
+				{
+					logFrameStats(gpuDrivenRenderSystem->getStats());
+				}
+				else
+				{
+					logFrameStats(simpleRenderSystem.getStats(), frameAllocator.getStats());
+				}
+			}
 		}
 		vkDeviceWaitIdle(ldDevice.device());
 	}
 
 
 
-	void App::loadGameObjects()
+	void App::loadGameObjects(uint32_t vaseCount)
 	{
-		std::shared_ptr<LdModel> ldModel = LdModel::createModelFromFile(ldDevice, "models/flat_vase.obj");
+		std::shared_ptr<LdModel> ldModel = modelRegistry.get("models/flat_vase.obj");
 		auto flatVase = LdGameObject::createGameObject();
 		flatVase.model = ldModel;
 		flatVase.transform.translation = { -.5f, .5f, 0.f };
 		flatVase.transform.scale = { 3.f,1.5f, 3.f };
 		gameObjects.emplace(flatVase.getId(), std::move(flatVase));
 
-		ldModel = LdModel::createModelFromFile(ldDevice, "models/smooth_vase.obj");
+		ldModel = modelRegistry.get("models/smooth_vase.obj");
 		auto smoothVase = LdGameObject::createGameObject();
 		smoothVase.model = ldModel;
 		smoothVase.transform.translation = { .5f, .5f, 0.f };
 		smoothVase.transform.scale = { 3.f,1.5f, 3.f };
 		gameObjects.emplace(smoothVase.getId(), std::move(smoothVase));
 
-		ldModel = LdModel::createModelFromFile(ldDevice, "models/quad.obj");
+		// two triangles, cheap to rasterize, it hides whatever lies under the floor
+		ldModel = modelRegistry.get("models/quad.obj", LdModel::VertexFormat::Float32, true);
 		auto floor = LdGameObject::createGameObject();
 		floor.model = ldModel;
 		floor.transform.translation = { 0.f, .5f, 0.f };
 		floor.transform.scale = { 3.f,1.f, 3.f };
+		floor.isStatic = true;
+		floor.occluder = true;
 		gameObjects.emplace(floor.getId(), std::move(floor));
 
+		// both vase models alternate on a square grid behind the floor
+		uint32_t gridSize = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(vaseCount))));
+		for (uint32_t i = 0; i < vaseCount; i++)
+		{
+			auto vase = LdGameObject::createGameObject();
+			vase.model = modelRegistry.get(i % 2 ? "models/smooth_vase.obj" : "models/flat_vase.obj");
+			vase.transform.translation = { (static_cast<float>(i % gridSize) - gridSize * .5f) * .5f, .5f, 3.f + (i / gridSize) * .5f };
+			vase.transform.scale = { 1.f, .5f, 1.f };
+			vase.isStatic = true;
+			gameObjects.emplace(vase.getId(), std::move(vase));
+		}
+
 		std::vector<glm::vec3> lightColors{
 			 {1.f, .1f, .1f},
 			 {.1f, .1f, 1.f},
@@ -1,7 +1,12 @@
 #pragma once
 
 #include "ld_window.hpp"
+#include "ld_asset_streamer.hpp"
+#include "ld_geometry_arena.hpp"
+#include "ld_model_registry.hpp"
+#include "ld_parallel_recorder.hpp"
 #include "ld_device.hpp"
+#include "ld_frame_allocator.hpp"
 #include "ld_renderer.hpp"
 #include "ld_model.hpp"
 #include "ld_game_object.hpp"
@@ -12,7 +17,28 @@
 namespace ld {
 	class App {
 	public:
-		App();
+		struct Options {
+			// extra vases laid out in a grid around the scene, to stress instancing and culling
+			uint32_t vaseCount = 0;
+			// cull and build the draws on the gpu, see GpuDrivenRenderSystem
+			bool gpuDriven = false;
+			// threads recording the cpu path's draws besides the main thread, with 0 and no static caching they are recorded inline
+			uint32_t recordWorkers = LdParallelRecorder::defaultWorkerCount();
+			// draw the static objects from cached command buffers, needs the recorder even without workers.
+			// Off by default, cached objects are never culled
+			bool staticCaching = false;
+			// run the vertex cache optimizer on cold imports, meshes are cached apart per setting
+			bool optimizeMeshes = true;
+			// print statistics for every model load
+			bool verboseImport = false;
+			// print the render system's statistics once a second
+			bool frameStats = false;
+			// how static geometry reaches device memory, see LdDevice::UploadPolicy
+			LdDevice::UploadPolicy uploadPolicy = LdDevice::UploadPolicy::Auto;
+		};
+
+		App() : App(Options{}) {}
+		explicit App(Options options);
 		~App();
 		App(const App&) = delete;
 		App& operator=(const App&) = delete;
@@ -24,13 +50,19 @@ namespace ld {
 		LdWindow ldWindow{ WIDTH, HEIGHT, "App Window" };
 		LdDevice ldDevice{ ldWindow };
 		LdRenderer ldRenderer{ ldWindow, ldDevice };
+		// sized in the constructor to hold the instance data of every object in the scene
+		LdFrameAllocator frameAllocator;
+		LdGeometryArena geometryArena{ ldDevice };
+		LdAssetStreamer assetStreamer{ ldDevice, &geometryArena };
+		LdModelRegistry modelRegistry{ assetStreamer };
 
 		std::unique_ptr<LdDescriptorPool> globalPool{};
 		LdGameObject::Map gameObjects;
+		Options options;
 	public:
 		void run();
 
 	private:
-		void loadGameObjects();
+		void loadGameObjects(uint32_t vaseCount);
 	};
 }
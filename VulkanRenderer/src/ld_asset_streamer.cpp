@@ -0,0 +1,168 @@
+#include "ld_asset_streamer.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace ld {
+	LdAssetStreamer::LdAssetStreamer(LdDevice& device, LdGeometryArena* geometryArena, uint32_t workerCount)
+		: ldDevice{ device }, geometryArena{ geometryArena }, uploadQueue{ device, device.transferQueue(), device.transferQueueFamily() }
+	{
+		workerCount = std::max(workerCount, 1u);
+		runningWorkers = workerCount;
+		for (uint32_t i = 0; i < workerCount; i++)
+		{
+			workers.emplace_back(&LdAssetStreamer::workerLoop, this);
+		}
+	}
+
+	LdAssetStreamer::~LdAssetStreamer()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			stopping = true;
+			queuedJobs.clear();
+		}
+		jobAdded.notify_all();
+		// a worker mid load may wait in the upload queue for staging space, which only frees up as
+		// this thread submits and retires batches, so keep doing that until every worker has left
+		{
+			std::unique_lock<std::mutex> lock{ mutex };
+			while (runningWorkers > 0)
+			{
+				lock.unlock();
+				uploadQueue.update();
+				lock.lock();
+				workerExited.wait_for(lock, std::chrono::milliseconds{ 1 }, [this] { return runningWorkers == 0; });
+			}
+		}
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+		// the jobs keep their models alive, so every copy still has a destination here
+		uploadQueue.flush();
+	}
+
+	std::shared_ptr<LdModel> LdAssetStreamer::requestModel(const std::string& filepath, LdModel::VertexFormat vertexFormat, bool occluder)
+	{
+		auto job = std::make_unique<Job>();
+		job->model = std::make_shared<LdModel>(ldDevice, geometryArena);
+		job->filepath = filepath;
+		job->vertexFormat = vertexFormat;
+		job->occluder = occluder;
+		job->requestTime = Clock::now();
+		std::shared_ptr<LdModel> model = job->model;
+
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			queuedJobs.push_back(std::move(job));
+		}
+		jobAdded.notify_one();
+		stats.requested++;
+		pending++;
+		return model;
+	}
+
+	void LdAssetStreamer::update()
+	{
+		uploadQueue.update();
+		retireJobs();
+
+		bool overBudget = ldDevice.memoryAllocator().getBudgetOvershoot(MAX_BUDGET_USAGE) > 0;
+		bool resumed = false;
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			if (overBudget != throttled)
+			{
+				std::cout << (overBudget ? "streaming paused, device memory over budget" : "streaming resumed") << std::endl;
+			}
+			resumed = throttled && !overBudget;
+			throttled = overBudget;
+		}
+		if (overBudget)
+		{
+			stats.throttledFrames++;
+		}
+		if (resumed)
+		{
+			jobAdded.notify_all();
+		}
+	}
+
+	void LdAssetStreamer::workerLoop()
+	{
+		while (true)
+		{
+			std::unique_ptr<Job> job{};
+			{
+				std::unique_lock<std::mutex> lock{ mutex };
+				jobAdded.wait(lock, [this] { return stopping || (!throttled && !queuedJobs.empty()); });
+				if (stopping)
+				{
+					runningWorkers--;
+					workerExited.notify_all();
+					return;
+				}
+				job = std::move(queuedJobs.front());
+				queuedJobs.pop_front();
+			}
+
+			try
+			{
+				// may block until the render thread has freed staging space
+				LdModel::ImportSettings jobSettings = importSettings;
+				jobSettings.occluder = job->occluder;
+				job->model->loadFromFile(job->filepath, job->vertexFormat, &uploadQueue, jobSettings);
+				job->uploadBatch = job->model->getUploadBatch();
+			}
+			catch (const std::exception& e)
+			{
+				std::cerr << "failed to stream " << job->filepath << ": " << e.what() << std::endl;
+				job->failed = true;
+			}
+
+			std::lock_guard<std::mutex> lock{ mutex };
+			loadedJobs.push_back(std::move(job));
+		}
+	}
+
+	void LdAssetStreamer::retireJobs()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			for (auto& job : loadedJobs)
+			{
+				uploadingJobs.push_back(std::move(job));
+			}
+			loadedJobs.clear();
+		}
+
+		for (size_t i = 0; i < uploadingJobs.size();)
+		{
+			Job& job = *uploadingJobs[i];
+			if (job.failed)
+			{
+				job.model->markFailed();
+				stats.failed++;
+			}
+			else if (uploadQueue.isComplete(job.uploadBatch))
+			{
+				job.model->markResident();
+				stats.resident++;
+				if (importSettings.verbose)
+				{
+					double milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - job.requestTime).count();
+					std::cout << "streamed " << job.filepath << " in " << milliseconds << " ms" << std::endl;
+				}
+			}
+			else
+			{
+				i++;
+				continue;
+			}
+			pending--;
+			uploadingJobs.erase(uploadingJobs.begin() + i);
+		}
+	}
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "ld_device.hpp"
+#include "ld_geometry_arena.hpp"
+#include "ld_model.hpp"
+#include "ld_upload_queue.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ld {
+	// Loads models in the background. Worker threads read and import the mesh data and enqueue its copies
+	// on an LdUploadQueue for the transfer queue, the render thread submits them batched in update() and
+	// marks models resident once their batch has completed. Nothing here waits on the render thread,
+	// except the destructor.
+	//
+	// While a device local heap is past MAX_BUDGET_USAGE of its budget the workers leave queued jobs
+	// alone, so streaming does not push the driver into paging while the registry evicts.
+	class LdAssetStreamer {
+	public:
+		static constexpr float MAX_BUDGET_USAGE = 0.95f;
+
+		struct Stats {
+			uint32_t requested = 0;
+			uint32_t resident = 0;
+			uint32_t failed = 0;
+			// frames the workers spent paused over the memory budget
+			uint32_t throttledFrames = 0;
+		};
+
+		// models are suballocated from geometryArena when one is given
+		LdAssetStreamer(LdDevice& device, LdGeometryArena* geometryArena = nullptr, uint32_t workerCount = 2);
+		~LdAssetStreamer();
+
+		LdAssetStreamer(const LdAssetStreamer&) = delete;
+		LdAssetStreamer& operator=(const LdAssetStreamer&) = delete;
+
+	private:
+		using Clock = std::chrono::high_resolution_clock;
+
+		struct Job {
+			std::shared_ptr<LdModel> model;
+			std::string filepath;
+			LdModel::VertexFormat vertexFormat;
+			bool occluder = false;
+			uint64_t uploadBatch = 0;
+			Clock::time_point requestTime;
+			bool failed = false;
+		};
+
+		LdDevice& ldDevice;
+		LdGeometryArena* geometryArena;
+		LdUploadQueue uploadQueue;
+
+		std::vector<std::thread> workers{};
+		std::mutex mutex{};
+		std::condition_variable jobAdded{};
+		std::condition_variable workerExited{};
+		uint32_t runningWorkers = 0;
+		std::deque<std::unique_ptr<Job>> queuedJobs{};
+		std::vector<std::unique_ptr<Job>> loadedJobs{};
+		bool stopping = false;
+		bool throttled = false;
+		LdModel::ImportSettings importSettings{};
+
+		// render thread only, jobs waiting for their upload batch
+		std::vector<std::unique_ptr<Job>> uploadingJobs{};
+		uint32_t pending = 0;
+		Stats stats{};
+
+	public:
+		// returns at once, the model draws once isResident() turns true. Occluders keep an occluder mesh,
+		// see LdModel::ImportSettings::occluder
+		std::shared_ptr<LdModel> requestModel(const std::string& filepath,
+			LdModel::VertexFormat vertexFormat = LdModel::VertexFormat::Float32, bool occluder = false);
+		// call once per frame on the render thread, submits enqueued uploads and retires finished ones
+		void update();
+		const LdUploadQueue& getUploadQueue() const { return uploadQueue; }
+		// applies to every load, change it before the first request as the workers read it unlocked
+		LdModel::ImportSettings& getImportSettings() { return importSettings; }
+		LdMemoryAllocator& getMemoryAllocator() { return ldDevice.memoryAllocator(); }
+
+		// requested models that are neither resident nor failed yet
+		uint32_t getPendingCount() const { return pending; }
+		const Stats& getStats() const { return stats; }
+
+	private:
+		void workerLoop();
+		void retireJobs();
+	};
+}
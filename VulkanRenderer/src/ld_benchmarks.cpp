@@ -0,0 +1,768 @@
+#include "ld_benchmarks.hpp"
+
+#include "ld_camera.hpp"
+#include "ld_device.hpp"
+#include "ld_frustum_culler.hpp"
+#include "ld_instance_batcher.hpp"
+#include "ld_lod_selector.hpp"
+#include "ld_mesh_cache.hpp"
+#include "ld_mesh_optimizer.hpp"
+#include "ld_mesh_simplifier.hpp"
+#include "ld_meshlet_builder.hpp"
+#include "ld_meshlet_culler.hpp"
+#include "ld_model.hpp"
+#include "ld_obj_loader.hpp"
+#include "ld_occlusion_culler.hpp"
+#include "ld_render_queue.hpp"
+#include "ld_upload_queue.hpp"
+#include "ld_vertex_welder.hpp"
+#include "ld_window.hpp"
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace ld {
+	namespace {
+		using Clock = std::chrono::high_resolution_clock;
+
+		double millisecondsSince(Clock::time_point start)
+		{
+			return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		}
+
+		// un-indexed corner stream of a model, i.e. what an importer sees before dedup
+		std::vector<LdModel::Vertex> loadCorners(const std::string& filepath)
+		{
+			std::vector<LdModel::Vertex> vertices{};
+			std::vector<uint32_t> indices{};
+			LdObjLoader loader{};
+			loader.load(filepath, vertices, indices);
+
+			std::vector<LdModel::Vertex> corners(indices.size());
+			for (size_t i = 0; i < indices.size(); i++)
+			{
+				corners[i] = vertices[indices[i]];
+			}
+			return corners;
+		}
+
+		// one corner of a regular grid of side * side vertices, two triangles per quad, so the
+		// large synthetic mesh never has to sit in memory as an expanded corner stream
+		struct GridCorners {
+			uint32_t side;
+
+			size_t size() const { return static_cast<size_t>(side - 1) * (side - 1) * 6; }
+
+			LdModel::Vertex operator[](size_t corner) const
+			{
+				static constexpr uint32_t offsets[6][2] = { {0, 0}, {1, 0}, {0, 1}, {1, 0}, {1, 1}, {0, 1} };
+				size_t quad = corner / 6;
+				uint32_t x = static_cast<uint32_t>(quad % (side - 1)) + offsets[corner % 6][0];
+				uint32_t y = static_cast<uint32_t>(quad / (side - 1)) + offsets[corner % 6][1];
+
+				LdModel::Vertex vertex{};
+				vertex.position = { static_cast<float>(x), 0.f, static_cast<float>(y) };
+				vertex.color = { 1.f, 1.f, 1.f };
+				vertex.normal = { 0.f, -1.f, 0.f };
+				vertex.uv = { x / static_cast<float>(side), y / static_cast<float>(side) };
+				return vertex;
+			}
+		};
+
+		// writes the grid as an .obj with positions, normals and uvs, the importer's large input
+		void writeGridObj(const std::filesystem::path& filepath, uint32_t side)
+		{
+			std::ofstream file{ filepath };
+			if (!file)
+			{
+				throw std::runtime_error("failed to write " + filepath.string());
+			}
+			for (uint32_t y = 0; y < side; y++)
+			{
+				for (uint32_t x = 0; x < side; x++)
+				{
+					file << "v " << x << " 0 " << y << "\nvt " << x / static_cast<float>(side) << ' ' << y / static_cast<float>(side) << '\n';
+				}
+			}
+			file << "vn 0 -1 0\n";
+			for (uint32_t y = 0; y + 1 < side; y++)
+			{
+				for (uint32_t x = 0; x + 1 < side; x++)
+				{
+					// obj indices count from 1
+					uint32_t corners[4] = { y * side + x + 1, y * side + x + 2, (y + 1) * side + x + 1, (y + 1) * side + x + 2 };
+					file << "f " << corners[0] << '/' << corners[0] << "/1 " << corners[1] << '/' << corners[1] << "/1 " << corners[2] << '/' << corners[2] << "/1\n";
+					file << "f " << corners[1] << '/' << corners[1] << "/1 " << corners[3] << '/' << corners[3] << "/1 " << corners[2] << '/' << corners[2] << "/1\n";
+				}
+			}
+		}
+
+		// every .obj under models/, sorted so runs print in the same order
+		std::vector<std::string> modelFiles()
+		{
+			std::vector<std::string> filepaths{};
+			for (const auto& entry : std::filesystem::directory_iterator{ "models" })
+			{
+				if (entry.path().extension() == ".obj")
+				{
+					filepaths.push_back(entry.path().string());
+				}
+			}
+			std::sort(filepaths.begin(), filepaths.end());
+			return filepaths;
+		}
+
+		void reportImport(const std::string& name, const std::string& filepath)
+		{
+			// the first load pulls the file into the os cache, the timed rounds read it from memory
+			constexpr int rounds = 3;
+			std::vector<LdModel::Vertex> vertices{};
+			std::vector<uint32_t> indices{};
+			std::cout << "  " << name << ':';
+			for (uint32_t threads : { 1u, 0u })
+			{
+				LdObjLoader loader{ threads };
+				loader.load(filepath, vertices, indices);
+				LdObjLoader::Stats total{};
+				for (int round = 0; round < rounds; round++)
+				{
+					loader.load(filepath, vertices, indices);
+					const auto& stats = loader.getStats();
+					total.fileBytes += stats.fileBytes;
+					total.triangleCount += stats.triangleCount;
+					total.readSeconds += stats.readSeconds;
+					total.parseSeconds += stats.parseSeconds;
+					total.buildSeconds += stats.buildSeconds;
+					total.threadCount = stats.threadCount;
+				}
+				std::cout << ' ' << total.threadCount << (total.threadCount == 1 ? " thread " : " threads ")
+					<< total.totalSeconds() * 1000.0 / rounds << " ms (" << total.megabytesPerSecond() << " MB/s, "
+					<< total.trianglesPerSecond() / 1e6 << " Mtris/s)" << (threads == 1 ? "," : "");
+			}
+			std::cout << ", " << indices.size() / 3 << " triangles" << std::endl;
+		}
+
+		void runImport()
+		{
+			std::cout << "obj import (cpu only)" << std::endl;
+			for (const auto& filepath : modelFiles())
+			{
+				reportImport(std::filesystem::path{ filepath }.filename().string(), filepath);
+			}
+			// 1025^2 vertices, about 2M triangles and 90 MB of text
+			auto gridPath = std::filesystem::temp_directory_path() / "ld_import_grid.obj";
+			writeGridObj(gridPath, 1025);
+			reportImport("grid 2M", gridPath.string());
+			std::filesystem::remove(gridPath);
+		}
+
+		void runMeshCache()
+		{
+			// cold is everything loadFromFile does before an upload when the cache is missing or stale,
+			// warm maps the cache and copies the mesh out the way the staging upload reads it
+			constexpr int rounds = 5;
+			std::cout << "mesh cache (cpu only), " << rounds << " rounds" << std::endl;
+			for (const auto& filepath : modelFiles())
+			{
+				double coldMilliseconds = 0.0;
+				for (int round = 0; round < rounds; round++)
+				{
+					auto start = Clock::now();
+					LdModel::Builder builder{};
+					builder.loadModel(filepath);
+					builder.optimize();
+					builder.buildMeshlets();
+					builder.buildLods();
+					LdMeshCache{ filepath }.write(builder);
+					coldMilliseconds += millisecondsSince(start);
+				}
+
+				double warmMilliseconds = 0.0;
+				size_t bytes = 0;
+				std::vector<unsigned char> staging{};
+				for (int round = 0; round < rounds; round++)
+				{
+					auto start = Clock::now();
+					LdMeshCache cache{ filepath };
+					if (!cache.isValid())
+					{
+						throw std::runtime_error("failed to read mesh cache " + cache.getCachePath());
+					}
+					LdModel::MeshView mesh = cache.view();
+					size_t vertexBytes = mesh.vertexCount * sizeof(LdModel::Vertex);
+					bytes = vertexBytes + mesh.indexCount * sizeof(uint32_t);
+					staging.resize(bytes);
+					std::memcpy(staging.data(), mesh.vertices, vertexBytes);
+					std::memcpy(staging.data() + vertexBytes, mesh.indices, mesh.indexCount * sizeof(uint32_t));
+					warmMilliseconds += millisecondsSince(start);
+				}
+
+				coldMilliseconds /= rounds;
+				warmMilliseconds /= rounds;
+				std::cout << "  " << std::filesystem::path{ filepath }.filename().string() << ": cold " << coldMilliseconds
+					<< " ms, warm " << warmMilliseconds << " ms (" << bytes / 1024 << " KB), "
+					<< (warmMilliseconds > 0.0 ? coldMilliseconds / warmMilliseconds : 0.0) << "x" << std::endl;
+			}
+		}
+
+		template<typename Corners>
+		void benchmarkWelder(const std::string& name, const Corners& corners)
+		{
+			// indices are folded into a checksum instead of being stored, the 10M grid has 60M corners
+			auto checksum = [](uint64_t sum, uint32_t index) { return (sum ^ index) * 0x100000001b3ull; };
+
+			// the dedup loop Builder::loadModel used before the welder existed
+			auto mapStart = Clock::now();
+			std::vector<LdModel::Vertex> mapVertices{};
+			uint64_t mapChecksum = 0;
+			{
+				std::unordered_map<LdModel::Vertex, uint32_t> uniqueVertices{};
+				for (size_t i = 0; i < corners.size(); i++)
+				{
+					LdModel::Vertex vertex = corners[i];
+					if (uniqueVertices.count(vertex) == 0)
+					{
+						uniqueVertices[vertex] = static_cast<uint32_t>(mapVertices.size());
+						mapVertices.push_back(vertex);
+					}
+					mapChecksum = checksum(mapChecksum, uniqueVertices[vertex]);
+				}
+			}
+			double mapMilliseconds = millisecondsSince(mapStart);
+
+			auto welderStart = Clock::now();
+			uint64_t welderChecksum = 0;
+			LdVertexWelder welder{};
+			for (size_t i = 0; i < corners.size(); i++)
+			{
+				welderChecksum = checksum(welderChecksum, welder.weld(corners[i]));
+			}
+			double welderMilliseconds = millisecondsSince(welderStart);
+
+			bool identical = welderChecksum == mapChecksum && welder.getVertices() == mapVertices;
+			std::cout << "  " << name << ": " << corners.size() << " corners -> " << mapVertices.size() << " vertices, "
+				<< "unordered_map " << mapMilliseconds << " ms, welder " << welderMilliseconds << " ms ("
+				<< mapMilliseconds / std::max(welderMilliseconds, 1e-6) << "x)"
+				<< (identical ? "" : " OUTPUT MISMATCH") << std::endl;
+		}
+
+		void runVertexWelder()
+		{
+			std::cout << "vertex welder vs unordered_map" << std::endl;
+			benchmarkWelder("teapot", loadCorners("models/teapot.obj"));
+			benchmarkWelder("smooth_vase", loadCorners("models/smooth_vase.obj"));
+			// 3163^2 is just over 10M unique vertices
+			benchmarkWelder("grid 10M", GridCorners{ 3163 });
+		}
+
+		// same steps as the cold path of LdModel::createModelFromFile, without touching the device
+		void reportMeshletCulling(const std::string& name, const std::string& filepath)
+		{
+			std::vector<LdModel::Vertex> vertices{};
+			std::vector<uint32_t> indices{};
+			std::vector<LdModel::Meshlet> meshlets{};
+			LdObjLoader loader{};
+			loader.load(filepath, vertices, indices);
+			LdMeshOptimizer optimizer{};
+			optimizer.optimize(vertices, indices);
+			LdMeshletBuilder::build(vertices, indices, meshlets);
+
+			float radius = 0.f;
+			for (const auto& meshlet : meshlets)
+			{
+				radius = std::max(radius, glm::length(meshlet.center) + meshlet.radius);
+			}
+
+			// orbit the model at the distance the app views it from, then close enough that it overfills the view
+			LdMeshletCuller culler{};
+			std::vector<LdMeshletCuller::DrawRange> ranges{};
+			LdMeshletCuller::Stats total{};
+			Clock::duration cullTime{};
+			const int steps = 64;
+			for (float distance : { radius * 4.f, radius * 1.2f })
+			{
+				for (int step = 0; step < steps; step++)
+				{
+					float angle = glm::two_pi<float>() * step / steps;
+					LdCamera camera{};
+					camera.setPerspectiveProjection(glm::radians(50.f), 16.f / 9.f, 0.1f, 100.f);
+					camera.setViewTarget(glm::vec3{ std::sin(angle), -0.5f, std::cos(angle) } * distance, glm::vec3{ 0.f });
+
+					auto start = Clock::now();
+					// as if drawn with back face culling, so the cone test counts
+					culler.begin(camera, true);
+					culler.cull(meshlets, glm::mat4{ 1.f }, ranges);
+					cullTime += Clock::now() - start;
+					total.add(culler.getStats());
+				}
+			}
+
+			uint32_t views = steps * 2;
+			std::cout << "  " << name << ": " << meshlets.size() << " meshlets, " << indices.size() / 3 << " triangles, "
+				<< "frustum culled " << 100.f * total.frustumCulled / total.meshlets << "%, "
+				<< "cone culled " << 100.f * total.coneCulled / total.meshlets << "%, "
+				<< "triangles drawn " << 100.0 * total.trianglesDrawn / total.triangles << "%, "
+				<< static_cast<float>(total.drawCalls) / views << " draws/view, "
+				<< std::chrono::duration<double, std::micro>(cullTime).count() / views << " us/view" << std::endl;
+		}
+
+		void runMeshletCulling()
+		{
+			std::cout << "meshlet culling (cpu only)" << std::endl;
+			reportMeshletCulling("teapot", "models/teapot.obj");
+			reportMeshletCulling("smooth_vase", "models/smooth_vase.obj");
+			reportMeshletCulling("flat_vase", "models/flat_vase.obj");
+		}
+
+		void reportLodChain(const std::string& name, const std::string& filepath)
+		{
+			std::vector<LdModel::Vertex> vertices{};
+			std::vector<uint32_t> indices{};
+			std::vector<LdModel::Lod> lods{};
+			LdObjLoader loader{};
+			loader.load(filepath, vertices, indices);
+			LdMeshOptimizer optimizer{};
+			optimizer.optimize(vertices, indices);
+
+			auto start = Clock::now();
+			LdMeshSimplifier::buildLodChain(vertices, indices, lods);
+			double milliseconds = millisecondsSince(start);
+
+			std::cout << "  " << name << ": " << lods.size() << " levels in " << milliseconds << " ms, triangles (error)";
+			for (const auto& lod : lods)
+			{
+				std::cout << ' ' << lod.indexCount / 3 << " (" << lod.error << ')';
+			}
+			std::cout << std::endl;
+
+			glm::vec3 boundsMin{ std::numeric_limits<float>::max() };
+			glm::vec3 boundsMax{ std::numeric_limits<float>::lowest() };
+			for (const auto& vertex : vertices)
+			{
+				boundsMin = glm::min(boundsMin, vertex.position);
+				boundsMax = glm::max(boundsMax, vertex.position);
+			}
+			glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+			float radius = glm::length(boundsMax - center);
+
+			// walk the camera away from the model at the app's field of view, 1px threshold at 1080p
+			LdLodSelector selector{};
+			std::cout << "    distance/radius -> lod:";
+			for (float distance : { 2.f, 4.f, 8.f, 16.f, 32.f, 64.f, 128.f })
+			{
+				LdCamera camera{};
+				camera.setPerspectiveProjection(glm::radians(50.f), 16.f / 9.f, 0.1f, 1000.f);
+				camera.setViewTarget(center + glm::vec3{ 0.f, 0.f, -distance * radius }, center);
+				selector.begin(camera);
+				uint32_t lod = selector.select(lods, center, radius, glm::mat4{ 1.f });
+				std::cout << ' ' << distance << "->" << lod << " (" << 100.0 * lods[lod].indexCount / lods[0].indexCount << "%)";
+			}
+			std::cout << std::endl;
+		}
+
+		void runLodChain()
+		{
+			std::cout << "lod chain (cpu only)" << std::endl;
+			reportLodChain("teapot", "models/teapot.obj");
+			reportLodChain("smooth_vase", "models/smooth_vase.obj");
+			reportLodChain("flat_vase", "models/flat_vase.obj");
+			reportLodChain("cube", "models/cube.obj");
+		}
+
+		void runUploads()
+		{
+			std::vector<std::string> filepaths = modelFiles();
+
+			// the only benchmark that needs a device, the window stays hidden
+			glfwInit();
+			glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+			LdWindow window{ 64, 64, "upload benchmark" };
+			LdDevice device{ window };
+
+			// fill the mesh caches first so both paths read the same mapped data
+			for (const auto& filepath : filepaths)
+			{
+				LdModel::createModelFromFile(device, filepath);
+			}
+
+			constexpr int rounds = 10;
+			std::cout << "uploads, " << filepaths.size() << " models from models/*.obj, " << rounds << " rounds" << std::endl;
+
+			auto createScene = [&]() {
+				std::vector<std::unique_ptr<LdModel>> models{};
+				auto start = Clock::now();
+				for (const auto& filepath : filepaths)
+				{
+					models.push_back(LdModel::createModelFromFile(device, filepath));
+				}
+				return millisecondsSince(start);
+			};
+
+			// staging buffer, single time command buffer and queue wait idle per vertex and index buffer
+			device.setUploadPolicy(LdDevice::UploadPolicy::Staging);
+			double copyMilliseconds = 0.0;
+			for (int round = 0; round < rounds; round++)
+			{
+				copyMilliseconds += createScene();
+			}
+
+			// everything through the staging ring, one submit and one fence wait
+			double batchedMilliseconds = 0.0;
+			LdUploadQueue uploadQueue{ device, device.transferQueue(), device.transferQueueFamily() };
+			for (int round = 0; round < rounds; round++)
+			{
+				std::vector<std::unique_ptr<LdModel>> models{};
+				auto start = Clock::now();
+				for (const auto& filepath : filepaths)
+				{
+					models.push_back(std::make_unique<LdModel>(device));
+					models.back()->loadFromFile(filepath, LdModel::VertexFormat::Float32, &uploadQueue);
+				}
+				uploadQueue.flush();
+				batchedMilliseconds += millisecondsSince(start);
+			}
+
+			const auto stats = uploadQueue.getStats();
+			std::cout << "    copyBuffer per buffer: " << copyMilliseconds / rounds << " ms per scene" << std::endl;
+			std::cout << "    upload queue:          " << batchedMilliseconds / rounds << " ms per scene, "
+				<< stats.copies / rounds << " copies in " << static_cast<double>(stats.batches) / rounds << " batches, "
+				<< stats.ringStalls << " ring stalls, " << stats.dedicatedStagingBuffers << " dedicated staging buffers" << std::endl;
+			std::cout << "    speedup " << copyMilliseconds / batchedMilliseconds << "x" << std::endl;
+
+			// written in place, no staging and no submit at all
+			device.setUploadPolicy(LdDevice::UploadPolicy::Direct);
+			if (!device.useDirectUploads())
+			{
+				std::cout << "    direct writes:         skipped, no host visible device local memory" << std::endl;
+				return;
+			}
+			double directMilliseconds = 0.0;
+			for (int round = 0; round < rounds; round++)
+			{
+				directMilliseconds += createScene();
+			}
+			std::cout << "    direct writes:         " << directMilliseconds / rounds << " ms per scene into "
+				<< device.getHostVisibleDeviceLocalSize() / (1024 * 1024) << " MiB heap, "
+				<< batchedMilliseconds / directMilliseconds << "x over the upload queue" << std::endl;
+		}
+
+		void runInstancing()
+		{
+			glfwInit();
+			glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+			LdWindow window{ 64, 64, "instancing benchmark" };
+			LdDevice device{ window };
+			std::vector<std::unique_ptr<LdModel>> models{};
+			models.push_back(LdModel::createModelFromFile(device, "models/flat_vase.obj"));
+			models.push_back(LdModel::createModelFromFile(device, "models/smooth_vase.obj"));
+
+			// the app's --vases grid, every third object at a coarser level
+			constexpr uint32_t objectCount = 100000;
+			constexpr int rounds = 20;
+			std::vector<LdInstanceBatcher::Instance> objects(objectCount);
+			for (uint32_t i = 0; i < objectCount; i++)
+			{
+				objects[i].modelMatrix = glm::translate(glm::mat4{ 1.f }, glm::vec3{ (i % 317) * .5f, .5f, (i / 317) * .5f });
+			}
+			std::vector<LdInstanceBatcher::Instance> destination(objectCount);
+
+			LdInstanceBatcher batcher{};
+			auto start = Clock::now();
+			for (int round = 0; round < rounds; round++)
+			{
+				batcher.begin();
+				for (uint32_t i = 0; i < objectCount; i++)
+				{
+					LdModel* model = models[i % models.size()].get();
+					uint32_t lod = i % 3 == 0 ? static_cast<uint32_t>(model->getLods().size() - 1) : 0;
+					batcher.add(model, lod, objects[i]);
+				}
+				batcher.finish(destination.data());
+			}
+			double milliseconds = millisecondsSince(start) / rounds;
+
+			std::cout << "instancing, " << objectCount << " objects of " << models.size() << " models, " << rounds << " rounds" << std::endl;
+			std::cout << "    draws " << objectCount << " -> " << batcher.getBatches().size() << ", batching "
+				<< milliseconds << " ms per frame, " << objectCount * sizeof(LdInstanceBatcher::Instance) / (1024.0 * 1024.0)
+				<< " MiB instance data" << std::endl;
+		}
+
+		struct Benchmark {
+			const char* name;
+			std::function<void()> run;
+		};
+
+		void runFrustumCulling()
+		{
+			// unit boxes scattered around the camera, about a tenth of them in view
+			constexpr uint32_t objectCount = 1000000;
+			constexpr int rounds = 10;
+			LdModel::Bounds bounds{};
+			bounds.min = glm::vec3{ -.5f };
+			bounds.max = glm::vec3{ .5f };
+			bounds.radius = glm::length(bounds.max);
+			std::mt19937 random{ 1 };
+			std::uniform_real_distribution<float> position{ -100.f, 100.f };
+			std::uniform_real_distribution<float> angle{ 0.f, glm::two_pi<float>() };
+			std::vector<glm::mat4> modelMatrices(objectCount);
+			for (auto& modelMatrix : modelMatrices)
+			{
+				modelMatrix = glm::translate(glm::mat4{ 1.f }, glm::vec3{ position(random), position(random) * .1f, position(random) });
+				modelMatrix = glm::rotate(modelMatrix, angle(random), glm::vec3{ 0.f, 1.f, 0.f });
+			}
+			LdCamera camera{};
+			camera.setPerspectiveProjection(glm::radians(50.f), 16.f / 9.f, 0.1f, 100.f);
+			camera.setViewTarget(glm::vec3{ 0.f }, glm::vec3{ 0.f, 0.f, 1.f });
+
+			std::cout << "frustum culling (cpu only), " << objectCount << " objects, " << rounds << " rounds" << std::endl;
+			for (auto instructionSet : { LdFrustumCuller::InstructionSet::Scalar, LdFrustumCuller::InstructionSet::Sse, LdFrustumCuller::InstructionSet::Avx })
+			{
+				LdFrustumCuller culler{};
+				culler.setInstructionSet(instructionSet);
+				if (culler.getInstructionSet() != instructionSet)
+				{
+					std::cout << "    " << LdFrustumCuller::instructionSetName(instructionSet) << ": not supported" << std::endl;
+					continue;
+				}
+
+				Clock::duration addTime{};
+				Clock::duration cullTime{};
+				for (int round = 0; round < rounds; round++)
+				{
+					auto start = Clock::now();
+					culler.begin(camera);
+					for (const auto& modelMatrix : modelMatrices)
+					{
+						culler.add(bounds, modelMatrix);
+					}
+					auto added = Clock::now();
+					culler.cull();
+					cullTime += Clock::now() - added;
+					addTime += added - start;
+				}
+				double cullSeconds = std::chrono::duration<double>(cullTime).count() / rounds;
+				double addSeconds = std::chrono::duration<double>(addTime).count() / rounds;
+				const auto& stats = culler.getStats();
+				std::cout << "    " << LdFrustumCuller::instructionSetName(instructionSet) << ": " << stats.visible << " visible, "
+					<< stats.culled << " culled, test " << objectCount / cullSeconds / 1e6 << " M objects/s, with transforms "
+					<< objectCount / (cullSeconds + addSeconds) / 1e6 << " M objects/s" << std::endl;
+			}
+		}
+
+		// closed unit cube around the origin, twelve triangles
+		LdModel::OccluderMesh makeBoxOccluder()
+		{
+			LdModel::OccluderMesh box{};
+			for (int i = 0; i < 8; i++)
+			{
+				box.positions.push_back({ i & 1 ? .5f : -.5f, i & 2 ? .5f : -.5f, i & 4 ? .5f : -.5f });
+			}
+			box.indices = { 0, 1, 3, 0, 3, 2, 4, 7, 5, 4, 6, 7, 0, 4, 5, 0, 5, 1, 2, 3, 7, 2, 7, 6, 0, 2, 6, 0, 6, 4, 1, 5, 7, 1, 7, 3 };
+			return box;
+		}
+
+		void runOcclusionCulling()
+		{
+			// city blocks of four buildings each, streets ten units wide in between, and small props
+			// scattered over the whole city. The camera stands in a street looking along it, -y is up.
+			constexpr int blocksPerSide = 20;
+			constexpr float blockPitch = 50.f;
+			constexpr uint32_t propCount = 50000;
+			constexpr int rounds = 20;
+			std::mt19937 random{ 1 };
+			std::uniform_real_distribution<float> buildingHeight{ 8.f, 80.f };
+			std::uniform_real_distribution<float> position{ -blocksPerSide * blockPitch * .5f, blocksPerSide * blockPitch * .5f };
+
+			LdModel::OccluderMesh box = makeBoxOccluder();
+			LdModel::Bounds bounds{};
+			bounds.min = glm::vec3{ -.5f };
+			bounds.max = glm::vec3{ .5f };
+			bounds.radius = glm::length(bounds.max);
+			std::vector<glm::mat4> buildings{};
+			for (int blockX = 0; blockX < blocksPerSide; blockX++)
+			{
+				for (int blockZ = 0; blockZ < blocksPerSide; blockZ++)
+				{
+					// streets run along multiples of the pitch, the block fills the 40 units between them
+					glm::vec2 corner{ (blockX - blocksPerSide / 2) * blockPitch + 5.f, (blockZ - blocksPerSide / 2) * blockPitch + 5.f };
+					for (int i = 0; i < 4; i++)
+					{
+						float height = buildingHeight(random);
+						glm::vec3 center{ corner.x + (i & 1 ? 30.f : 10.f), -height * .5f, corner.y + (i & 2 ? 30.f : 10.f) };
+						buildings.push_back(glm::scale(glm::translate(glm::mat4{ 1.f }, center), glm::vec3{ 19.f, height, 19.f }));
+					}
+				}
+			}
+			std::vector<glm::mat4> objects = buildings;
+			for (uint32_t i = 0; i < propCount; i++)
+			{
+				objects.push_back(glm::translate(glm::mat4{ 1.f }, glm::vec3{ position(random), -.5f, position(random) }));
+			}
+
+			LdCamera camera{};
+			camera.setPerspectiveProjection(glm::radians(60.f), 16.f / 9.f, 0.1f, 1000.f);
+			camera.setViewDirection(glm::vec3{ 0.f, -1.7f, -400.f }, glm::vec3{ 0.1f, 0.f, 1.f });
+			LdFrustumCuller frustumCuller{};
+
+			std::cout << "occlusion culling (cpu only), city of " << buildings.size() << " buildings as occluders and "
+				<< objects.size() << " objects, " << LdOcclusionCuller::DEFAULT_WIDTH << "x" << LdOcclusionCuller::DEFAULT_HEIGHT
+				<< " depth buffer, " << rounds << " rounds" << std::endl;
+			for (auto instructionSet : { LdFrustumCuller::InstructionSet::Scalar, LdFrustumCuller::InstructionSet::Sse })
+			{
+				LdOcclusionCuller culler{};
+				culler.setInstructionSet(instructionSet);
+				if (culler.getInstructionSet() != instructionSet)
+				{
+					std::cout << "    " << LdFrustumCuller::instructionSetName(instructionSet) << ": not supported" << std::endl;
+					continue;
+				}
+
+				double rasterizeMilliseconds = 0.0;
+				Clock::duration testTime{};
+				for (int round = 0; round < rounds; round++)
+				{
+					frustumCuller.begin(camera);
+					culler.begin(camera);
+					for (const auto& building : buildings)
+					{
+						culler.addOccluder(box, building);
+					}
+					culler.rasterize();
+					for (const auto& modelMatrix : objects)
+					{
+						frustumCuller.add(bounds, modelMatrix);
+					}
+					const auto& visible = frustumCuller.cull();
+					// includes waiting for the worker, should it still be rasterizing
+					auto start = Clock::now();
+					for (uint32_t index : visible)
+					{
+						culler.isOccluded(bounds, objects[index]);
+					}
+					testTime += Clock::now() - start;
+					rasterizeMilliseconds += culler.getStats().rasterizeMilliseconds;
+				}
+				rasterizeMilliseconds /= rounds;
+				double testMilliseconds = std::chrono::duration<double, std::milli>(testTime).count() / rounds;
+				const auto& stats = culler.getStats();
+				const auto& frustumStats = frustumCuller.getStats();
+				uint32_t tested = stats.tested;
+				std::cout << "    " << LdFrustumCuller::instructionSetName(instructionSet) << ": rasterized " << stats.trianglesRasterized << " of "
+					<< stats.triangles << " triangles in " << rasterizeMilliseconds << " ms (" << stats.triangles / rasterizeMilliseconds << " triangles/ms), "
+					<< frustumStats.culled << " frustum culled (" << 100.f * frustumStats.culled / objects.size() << "%), "
+					<< stats.occluded << " of " << tested << " occluded (" << 100.f * stats.occluded / std::max(tested, 1u) << "%), test "
+					<< tested / std::max(testMilliseconds, 1e-6) / 1e3 << " M objects/s" << std::endl;
+			}
+		}
+
+		void runRenderQueue()
+		{
+			// draws gathered in hash map order, three vertex formats over a few arena blocks and models
+			constexpr uint32_t drawCount = 200000;
+			constexpr uint32_t modelCount = 400;
+			constexpr uint32_t blockCount = 12;
+			constexpr int rounds = 20;
+			std::mt19937 random{ 1 };
+			std::uniform_int_distribution<uint32_t> pickModel{ 0, modelCount - 1 };
+			std::uniform_real_distribution<float> depth{ 0.f, 100.f };
+			std::vector<uint64_t> keys(drawCount);
+			for (auto& key : keys)
+			{
+				uint32_t model = pickModel(random);
+				key = LdRenderQueue::makeKey(0, model % 3, 0, model % blockCount, model, depth(random));
+			}
+
+			std::cout << "render queue (cpu only), " << drawCount << " draws of " << modelCount << " models, " << rounds << " rounds" << std::endl;
+			LdRenderQueue queue{};
+			double radixMilliseconds = 0.0;
+			for (int round = 0; round < rounds; round++)
+			{
+				queue.begin();
+				for (uint32_t i = 0; i < drawCount; i++)
+				{
+					queue.submit(keys[i], i);
+				}
+				auto start = Clock::now();
+				queue.sort();
+				radixMilliseconds += millisecondsSince(start);
+			}
+			radixMilliseconds /= rounds;
+
+			std::vector<LdRenderQueue::Packet> packets(drawCount);
+			double stdMilliseconds = 0.0;
+			for (int round = 0; round < rounds; round++)
+			{
+				for (uint32_t i = 0; i < drawCount; i++)
+				{
+					packets[i] = { keys[i], i };
+				}
+				auto start = Clock::now();
+				std::stable_sort(packets.begin(), packets.end(), [](const LdRenderQueue::Packet& a, const LdRenderQueue::Packet& b) { return a.key < b.key; });
+				stdMilliseconds += millisecondsSince(start);
+			}
+			stdMilliseconds /= rounds;
+
+			const auto& stats = queue.getStats();
+			std::cout << "    radix sort " << radixMilliseconds << " ms, std::stable_sort " << stdMilliseconds << " ms, "
+				<< stats.skippedPasses << " of 8 byte passes skipped" << std::endl;
+			std::cout << "    state changes submitted -> sorted: pipelines " << stats.submitted.pipelines << " -> " << stats.sorted.pipelines
+				<< ", descriptor sets " << stats.submitted.descriptorSets << " -> " << stats.sorted.descriptorSets
+				<< ", buffers " << stats.submitted.buffers << " -> " << stats.sorted.buffers << std::endl;
+		}
+
+		const std::vector<Benchmark>& allBenchmarks()
+		{
+			static const std::vector<Benchmark> benchmarks = {
+				{ "import", runImport },
+				{ "meshcache", runMeshCache },
+				{ "welder", runVertexWelder },
+				{ "meshlets", runMeshletCulling },
+				{ "lods", runLodChain },
+				{ "uploads", runUploads },
+				{ "instancing", runInstancing },
+				{ "frustum", runFrustumCulling },
+				{ "occlusion", runOcclusionCulling },
+				{ "queue", runRenderQueue },
+			};
+			return benchmarks;
+		}
+	}
+
+	int runBenchmarks(const std::vector<std::string>& names)
+	{
+		bool ranAny = false;
+		for (const auto& benchmark : allBenchmarks())
+		{
+			if (names.empty() || std::find(names.begin(), names.end(), benchmark.name) != names.end())
+			{
+				benchmark.run();
+				ranAny = true;
+			}
+		}
+		if (!ranAny)
+		{
+			std::cerr << "unknown benchmark, available:";
+			for (const auto& benchmark : allBenchmarks())
+			{
+				std::cerr << ' ' << benchmark.name;
+			}
+			std::cerr << std::endl;
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+}
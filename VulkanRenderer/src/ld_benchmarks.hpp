@@ -0,0 +1,11 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace ld {
+	// Micro benchmarks, started with `VulkanRenderer --bench [name...]`. "uploads" and
+	// "instancing" create a device behind a hidden window, the others run on the cpu only. Results are printed to stdout.
+	// Runs every benchmark when no names are given, returns the process exit code.
+	int runBenchmarks(const std::vector<std::string>& names);
+}
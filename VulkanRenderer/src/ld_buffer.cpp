@@ -43,36 +43,42 @@ namespace ld {
 	{
 		unmap();
 		vkDestroyBuffer(ldDevice.device(), buffer, nullptr);
-		vkFreeMemory(ldDevice.device(), memory, nullptr);
+		ldDevice.memoryAllocator().free(memory);
 	}
 
 	/**
 	 * Map a memory range of this buffer. If successful, mapped points to the specified buffer range.
 	 *
 	 * @param size (Optional) Size of the memory range to map. Pass VK_WHOLE_SIZE to map the complete
-	 * buffer range.
+	 * buffer range. The range has to lie within the buffer, as with vkMapMemory.
 	 * @param offset (Optional) Byte offset from beginning
 	 *
+	 * @note The whole buffer stays reachable through the pointer, size is only checked
+	 *
 	 * @return VkResult of the buffer mapping call
 	 */
 	VkResult LdBuffer::map(VkDeviceSize size, VkDeviceSize offset)
 	{
-		assert(buffer && memory && "Called map on buffer before create");
-		return vkMapMemory(ldDevice.device(), memory, offset, size, 0, &mapped);
+		assert(buffer && memory.memory && "Called map on buffer before create");
+		assert(offset < bufferSize && (size == VK_WHOLE_SIZE || (size > 0 && size <= bufferSize - offset)) && "Mapped range outside the buffer");
+		(void)size;
+		// host visible memory is mapped by the allocator for its whole life, blocks are shared
+		if (memory.mapped == nullptr)
+		{
+			return VK_ERROR_MEMORY_MAP_FAILED;
+		}
+		mapped = static_cast<char*>(memory.mapped) + offset;
+		return VK_SUCCESS;
 	}
 
 	/**
 	 * Unmap a mapped memory range
 	 *
-	 * @note Does not return a result as vkUnmapMemory can't fail
+	 * @note The allocator keeps the memory itself mapped, this only drops the pointer
 	 */
 	void LdBuffer::unmap()
 	{
-		if (mapped)
-		{
-			vkUnmapMemory(ldDevice.device(), memory);
-			mapped = nullptr;
-		}
+		mapped = nullptr;
 	}
 
 	/**
@@ -115,8 +121,8 @@ namespace ld {
 	{
 		VkMappedMemoryRange mappedRange = {};
 		mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-		mappedRange.memory = memory;
-		mappedRange.offset = offset;
+		mappedRange.memory = memory.memory;
+		mappedRange.offset = memory.offset + offset;
 		mappedRange.size = size;
 		return vkFlushMappedMemoryRanges(ldDevice.device(), 1, &mappedRange);
 	}
@@ -136,8 +142,8 @@ namespace ld {
 	{
 		VkMappedMemoryRange mappedRange = {};
 		mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-		mappedRange.memory = memory;
-		mappedRange.offset = offset;
+		mappedRange.memory = memory.memory;
+		mappedRange.offset = memory.offset + offset;
 		mappedRange.size = size;
 		return vkInvalidateMappedMemoryRanges(ldDevice.device(), 1, &mappedRange);
 	}
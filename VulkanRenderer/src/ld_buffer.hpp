@@ -24,7 +24,8 @@ namespace ld {
 		LdDevice& ldDevice;
 		void* mapped = nullptr;
 		VkBuffer buffer = VK_NULL_HANDLE;
-		VkDeviceMemory memory = VK_NULL_HANDLE;
+		// a range of a larger block unless the buffer is very large, see LdMemoryAllocator
+		LdMemoryAllocation memory{};
 
 		VkDeviceSize bufferSize;
 		uint32_t instanceCount;
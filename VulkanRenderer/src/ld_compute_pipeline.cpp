@@ -0,0 +1,47 @@
+#include "ld_compute_pipeline.hpp"
+
+#include "ld_pipeline.hpp"
+
+#include <stdexcept>
+
+namespace ld {
+	LdComputePipeline::LdComputePipeline(LdDevice& device, const std::string& compFilepath, VkPipelineLayout pipelineLayout)
+		: ldDevice{ device }
+	{
+		std::vector<char> code = LdPipeline::readFile(compFilepath);
+		VkShaderModuleCreateInfo moduleInfo{};
+		moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		moduleInfo.codeSize = code.size();
+		moduleInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+		if (vkCreateShaderModule(ldDevice.device(), &moduleInfo, nullptr, &compShaderModule) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create shader module");
+		}
+
+		VkComputePipelineCreateInfo pipelineInfo{};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipelineInfo.stage.module = compShaderModule;
+		pipelineInfo.stage.pName = "main";
+		pipelineInfo.layout = pipelineLayout;
+		pipelineInfo.basePipelineIndex = -1;
+		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+		if (vkCreateComputePipelines(ldDevice.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &computePipeline) != VK_SUCCESS)
+		{
+			vkDestroyShaderModule(ldDevice.device(), compShaderModule, nullptr);
+			throw std::runtime_error("failed to create compute pipeline");
+		}
+	}
+
+	LdComputePipeline::~LdComputePipeline()
+	{
+		vkDestroyShaderModule(ldDevice.device(), compShaderModule, nullptr);
+		vkDestroyPipeline(ldDevice.device(), computePipeline, nullptr);
+	}
+
+	void LdComputePipeline::bind(VkCommandBuffer commandBuffer)
+	{
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+	}
+}
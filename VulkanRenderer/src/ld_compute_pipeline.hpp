@@ -0,0 +1,25 @@
+#pragma once
+
+#include "ld_device.hpp"
+
+#include <string>
+
+namespace ld {
+	// A compute shader and its pipeline, the layout belongs to the caller like for LdPipeline.
+	class LdComputePipeline {
+	public:
+		LdComputePipeline(LdDevice& device, const std::string& compFilepath, VkPipelineLayout pipelineLayout);
+		~LdComputePipeline();
+
+		LdComputePipeline(const LdComputePipeline&) = delete;
+		LdComputePipeline& operator=(const LdComputePipeline&) = delete;
+
+	private:
+		LdDevice& ldDevice;
+		VkShaderModule compShaderModule;
+		VkPipeline computePipeline;
+
+	public:
+		void bind(VkCommandBuffer commandBuffer);
+	};
+}
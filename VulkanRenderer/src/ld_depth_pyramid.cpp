@@ -0,0 +1,269 @@
+#include "ld_depth_pyramid.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace ld {
+	namespace {
+		constexpr uint32_t BUILD_GROUP_SIZE = 8;
+
+		// compute writes of one level become readable by the next dispatch
+		void computeBarrier(VkCommandBuffer commandBuffer, VkAccessFlags srcAccessMask)
+		{
+			VkMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = srcAccessMask;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0, 1, &barrier, 0, nullptr, 0, nullptr);
+		}
+	}
+
+	LdDepthPyramid::LdDepthPyramid(LdDevice& device)
+		: ldDevice{ device }
+	{
+		createSampler();
+		createDescriptors();
+		createPipeline();
+	}
+
+	LdDepthPyramid::~LdDepthPyramid()
+	{
+		destroyImage();
+		vkDestroySampler(ldDevice.device(), sampler, nullptr);
+		vkDestroyPipelineLayout(ldDevice.device(), pipelineLayout, nullptr);
+	}
+
+	void LdDepthPyramid::createSampler()
+	{
+		// the build reads with texelFetch, cull.comp with textureLod. Nearest texels from the nearest level
+		// keep its four taps the exact maxima of the pyramid, filtering would blend in nearer depths
+		VkSamplerCreateInfo samplerInfo{};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerInfo.magFilter = VK_FILTER_NEAREST;
+		samplerInfo.minFilter = VK_FILTER_NEAREST;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.minLod = 0.f;
+		samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+		if (vkCreateSampler(ldDevice.device(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create depth pyramid sampler!");
+		}
+	}
+
+	void LdDepthPyramid::createDescriptors()
+	{
+		buildSetLayout = LdDescriptorSetLayout::Builder(ldDevice)
+			.addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+			.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)
+			.build();
+		readSetLayout = LdDescriptorSetLayout::Builder(ldDevice)
+			.addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+			.build();
+
+		uint32_t buildSetCount = LdSwapChain::MAX_FRAMES_IN_FLIGHT * MAX_LEVELS;
+		descriptorPool = LdDescriptorPool::Builder(ldDevice)
+			.setMaxSets(buildSetCount + 1)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, buildSetCount + 1)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, buildSetCount)
+			.build();
+
+		// written by resize() and build(), the sets stay allocated for any size
+		for (auto& frameSets : buildSets)
+		{
+			for (auto& set : frameSets)
+			{
+				if (!descriptorPool->allocateDescriptorSet(buildSetLayout->getDescriptorSetLayout(), set))
+				{
+					throw std::runtime_error("failed to allocate depth pyramid descriptor set!");
+				}
+			}
+		}
+		if (!descriptorPool->allocateDescriptorSet(readSetLayout->getDescriptorSetLayout(), readSet))
+		{
+			throw std::runtime_error("failed to allocate depth pyramid descriptor set!");
+		}
+	}
+
+	void LdDepthPyramid::createPipeline()
+	{
+		VkDescriptorSetLayout setLayout = buildSetLayout->getDescriptorSetLayout();
+		VkPushConstantRange pushConstantRange{};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(BuildPush);
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = 1;
+		pipelineLayoutInfo.pSetLayouts = &setLayout;
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+		if (vkCreatePipelineLayout(ldDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create depth pyramid pipeline layout!");
+		}
+		buildPipeline = std::make_unique<LdComputePipeline>(ldDevice, "shaders/depth_pyramid.comp.spv", pipelineLayout);
+	}
+
+	void LdDepthPyramid::resize(VkExtent2D newDepthExtent)
+	{
+		if (image != VK_NULL_HANDLE && newDepthExtent.width == depthExtent.width && newDepthExtent.height == depthExtent.height)
+		{
+			return;
+		}
+		if (image != VK_NULL_HANDLE)
+		{
+			// the frames in flight may still sample the old image
+			vkDeviceWaitIdle(ldDevice.device());
+			destroyImage();
+		}
+
+		depthExtent = newDepthExtent;
+		extent.width = std::max((depthExtent.width + 1) / 2, 1u);
+		extent.height = std::max((depthExtent.height + 1) / 2, 1u);
+		levelCount = 1;
+		while (levelCount < MAX_LEVELS && (extent.width >> levelCount > 0 || extent.height >> levelCount > 0))
+		{
+			levelCount++;
+		}
+		createImage();
+		built = false;
+
+		for (auto& frameSets : buildSets)
+		{
+			// level 0 gets its source in build(), every other level reads the one above
+			for (uint32_t level = 1; level < levelCount; level++)
+			{
+				VkDescriptorImageInfo sourceInfo{ sampler, levelViews[level - 1], VK_IMAGE_LAYOUT_GENERAL };
+				VkDescriptorImageInfo destinationInfo{ VK_NULL_HANDLE, levelViews[level], VK_IMAGE_LAYOUT_GENERAL };
+				LdDescriptorWriter(*buildSetLayout, *descriptorPool)
+					.writeImage(0, &sourceInfo)
+					.writeImage(1, &destinationInfo)
+					.overwrite(frameSets[level]);
+			}
+		}
+		VkDescriptorImageInfo pyramidInfo{ sampler, pyramidView, VK_IMAGE_LAYOUT_GENERAL };
+		LdDescriptorWriter(*readSetLayout, *descriptorPool)
+			.writeImage(0, &pyramidInfo)
+			.overwrite(readSet);
+	}
+
+	void LdDepthPyramid::createImage()
+	{
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent.width = extent.width;
+		imageInfo.extent.height = extent.height;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = levelCount;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = VK_FORMAT_R32_SFLOAT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.flags = 0;
+		ldDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageMemory);
+
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = VK_FORMAT_R32_SFLOAT;
+		viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		viewInfo.subresourceRange.baseMipLevel = 0;
+		viewInfo.subresourceRange.levelCount = levelCount;
+		viewInfo.subresourceRange.baseArrayLayer = 0;
+		viewInfo.subresourceRange.layerCount = 1;
+		if (vkCreateImageView(ldDevice.device(), &viewInfo, nullptr, &pyramidView) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create depth pyramid image view!");
+		}
+		levelViews.resize(levelCount);
+		for (uint32_t level = 0; level < levelCount; level++)
+		{
+			viewInfo.subresourceRange.baseMipLevel = level;
+			viewInfo.subresourceRange.levelCount = 1;
+			if (vkCreateImageView(ldDevice.device(), &viewInfo, nullptr, &levelViews[level]) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create depth pyramid image view!");
+			}
+		}
+
+		// never leaves GENERAL, it is written and sampled by compute shaders only
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange = viewInfo.subresourceRange;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = levelCount;
+		VkCommandBuffer commandBuffer = ldDevice.beginSingleTimeCommands();
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &barrier);
+		ldDevice.endSingleTimeCommands(commandBuffer);
+	}
+
+	void LdDepthPyramid::destroyImage()
+	{
+		for (VkImageView view : levelViews)
+		{
+			vkDestroyImageView(ldDevice.device(), view, nullptr);
+		}
+		levelViews.clear();
+		if (image == VK_NULL_HANDLE)
+		{
+			return;
+		}
+		vkDestroyImageView(ldDevice.device(), pyramidView, nullptr);
+		vkDestroyImage(ldDevice.device(), image, nullptr);
+		ldDevice.memoryAllocator().free(imageMemory);
+		image = VK_NULL_HANDLE;
+		pyramidView = VK_NULL_HANDLE;
+	}
+
+	void LdDepthPyramid::build(VkCommandBuffer commandBuffer, int frameIndex, VkImageView depthView, const glm::mat4& viewProjection)
+	{
+		assert(image != VK_NULL_HANDLE && "Cannot build depth pyramid before resize()");
+
+		// this frame's set is not in use any more, the other frame may still read its own
+		VkDescriptorImageInfo sourceInfo{ sampler, depthView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		VkDescriptorImageInfo destinationInfo{ VK_NULL_HANDLE, levelViews[0], VK_IMAGE_LAYOUT_GENERAL };
+		LdDescriptorWriter(*buildSetLayout, *descriptorPool)
+			.writeImage(0, &sourceInfo)
+			.writeImage(1, &destinationInfo)
+			.overwrite(buildSets[frameIndex][0]);
+
+		// culling earlier in the frame still samples the last build
+		computeBarrier(commandBuffer, VK_ACCESS_SHADER_READ_BIT);
+		buildPipeline->bind(commandBuffer);
+
+		BuildPush push{ depthExtent.width, depthExtent.height, extent.width, extent.height };
+		for (uint32_t level = 0; level < levelCount; level++)
+		{
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &buildSets[frameIndex][level], 0, nullptr);
+			vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(BuildPush), &push);
+			vkCmdDispatch(commandBuffer, (push.width + BUILD_GROUP_SIZE - 1) / BUILD_GROUP_SIZE, (push.height + BUILD_GROUP_SIZE - 1) / BUILD_GROUP_SIZE, 1);
+			computeBarrier(commandBuffer, VK_ACCESS_SHADER_WRITE_BIT);
+
+			push.sourceWidth = push.width;
+			push.sourceHeight = push.height;
+			push.width = std::max(push.width / 2, 1u);
+			push.height = std::max(push.height / 2, 1u);
+		}
+		this->viewProjection = viewProjection;
+		built = true;
+	}
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "ld_compute_pipeline.hpp"
+#include "ld_descriptors.hpp"
+#include "ld_device.hpp"
+#include "ld_swapchain.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace ld {
+	// Hierarchical z buffer for occlusion culling. build() reduces a depth attachment into a mip chain
+	// where every texel holds the farthest depth of the texels it covers, so a bounding rectangle's
+	// nearest depth can be compared against two by two texels of the right level. Level 0 is half the
+	// depth resolution, rounded up. The image stays in VK_IMAGE_LAYOUT_GENERAL, compute shaders sample
+	// it through getReadSet() with a nearest sampler.
+	class LdDepthPyramid {
+	public:
+		static constexpr uint32_t MAX_LEVELS = 16;
+
+		explicit LdDepthPyramid(LdDevice& device);
+		~LdDepthPyramid();
+
+		LdDepthPyramid(const LdDepthPyramid&) = delete;
+		LdDepthPyramid& operator=(const LdDepthPyramid&) = delete;
+
+	private:
+		struct BuildPush {
+			uint32_t sourceWidth;
+			uint32_t sourceHeight;
+			uint32_t width;
+			uint32_t height;
+		};
+
+		LdDevice& ldDevice;
+		std::unique_ptr<LdDescriptorSetLayout> buildSetLayout;
+		std::unique_ptr<LdDescriptorSetLayout> readSetLayout;
+		std::unique_ptr<LdDescriptorPool> descriptorPool;
+		// one per level, level 0 reads the depth of the frame it is built in
+		std::array<std::array<VkDescriptorSet, MAX_LEVELS>, LdSwapChain::MAX_FRAMES_IN_FLIGHT> buildSets{};
+		VkDescriptorSet readSet = VK_NULL_HANDLE;
+		VkPipelineLayout pipelineLayout;
+		std::unique_ptr<LdComputePipeline> buildPipeline;
+		VkSampler sampler;
+
+		VkImage image = VK_NULL_HANDLE;
+		LdMemoryAllocation imageMemory{};
+		VkImageView pyramidView = VK_NULL_HANDLE;
+		std::vector<VkImageView> levelViews{};
+		VkExtent2D depthExtent{ 0, 0 };
+		VkExtent2D extent{ 0, 0 };
+		uint32_t levelCount = 0;
+		bool built = false;
+		glm::mat4 viewProjection{ 1.f };
+
+	public:
+		// (re)creates the pyramid for a depth attachment of this size, waits for the device when the
+		// size changed. Forgets the last build.
+		void resize(VkExtent2D depthExtent);
+		// records the reduction of depthView, which must be readable by compute shaders. viewProjection
+		// is the one the depth was rendered with, tests have to project into the pyramid with it.
+		void build(VkCommandBuffer commandBuffer, int frameIndex, VkImageView depthView, const glm::mat4& viewProjection);
+
+		bool isBuilt() const { return built; }
+		const glm::mat4& getViewProjection() const { return viewProjection; }
+		VkExtent2D getExtent() const { return extent; }
+		uint32_t getLevelCount() const { return levelCount; }
+		VkDescriptorSetLayout getReadSetLayout() const { return readSetLayout->getDescriptorSetLayout(); }
+		VkDescriptorSet getReadSet() const { return readSet; }
+
+	private:
+		void createDescriptors();
+		void createPipeline();
+		void createSampler();
+		void createImage();
+		void destroyImage();
+	};
+}
@@ -1,6 +1,7 @@
 #include "ld_device.hpp"
 
 // std headers
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <set>
@@ -53,6 +54,38 @@ namespace ld
         }
     }
 
+    namespace {
+        // only used to account memory, see LdMemoryAllocator::getHeapStats
+        LdMemoryCategory bufferCategory(VkBufferUsageFlags usage)
+        {
+            if (usage & (VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT))
+            {
+                return LdMemoryCategory::Uniforms;
+            }
+            if (usage & (VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT))
+            {
+                return LdMemoryCategory::Geometry;
+            }
+            if (usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT)
+            {
+                return LdMemoryCategory::Staging;
+            }
+            return LdMemoryCategory::Other;
+        }
+
+        // the classic BAR window, memory no larger than this is too scarce to hold all static geometry
+        constexpr VkDeviceSize BAR_WINDOW_SIZE = 256ull * 1024 * 1024;
+
+        LdMemoryCategory imageCategory(VkImageUsageFlags usage)
+        {
+            if (usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT))
+            {
+                return LdMemoryCategory::Attachments;
+            }
+            return LdMemoryCategory::Other;
+        }
+    }
+
     // class member functions
     LdDevice::LdDevice(LdWindow& window) : window{ window }
     {
@@ -61,12 +94,31 @@ namespace ld
         createSurface();
         pickPhysicalDevice();
         createLogicalDevice();
+        auto getMemoryProperties2 = memoryBudgetEnabled_
+            ? reinterpret_cast<PFN_vkGetPhysicalDeviceMemoryProperties2KHR>(
+                vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceMemoryProperties2KHR"))
+            : nullptr;
+        memoryAllocator_ = std::make_unique<LdMemoryAllocator>(physicalDevice, device_, getMemoryProperties2);
+
+        VkPhysicalDeviceMemoryProperties memoryProperties;
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+        const VkMemoryPropertyFlags directFlags =
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+        {
+            if ((memoryProperties.memoryTypes[i].propertyFlags & directFlags) == directFlags)
+            {
+                VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[i].heapIndex].size;
+                hostVisibleDeviceLocalSize_ = std::max(hostVisibleDeviceLocalSize_, heapSize);
+            }
+        }
         createCommandPool();
     }
 
     LdDevice::~LdDevice()
     {
         vkDestroyCommandPool(device_, commandPool, nullptr);
+        memoryAllocator_.reset();
         vkDestroyDevice(device_, nullptr);
 
         if (enableValidationLayers) {
@@ -97,6 +149,12 @@ namespace ld
         createInfo.pApplicationInfo = &appInfo;
 
         auto extensions = getRequiredExtensions();
+        // VK_EXT_memory_budget is queried through it, the instance is still 1.0
+        if (isInstanceExtensionAvailable(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME))
+        {
+            extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+            physicalDeviceProperties2Enabled_ = true;
+        }
         createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
         createInfo.ppEnabledExtensionNames = extensions.data();
 
@@ -157,7 +215,7 @@ namespace ld
         QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
 
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-        std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily };
+        std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily, indices.transferFamily };
 
         float queuePriority = 1.0f;
         for (uint32_t queueFamily : uniqueQueueFamilies)
@@ -170,8 +228,14 @@ namespace ld
             queueCreateInfos.push_back(queueCreateInfo);
         }
 
+        VkPhysicalDeviceFeatures supportedFeatures;
+        vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
         VkPhysicalDeviceFeatures deviceFeatures = {};
         deviceFeatures.samplerAnisotropy = VK_TRUE;
+        // gpu driven rendering, see GpuDrivenRenderSystem
+        deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+        deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+        enabledFeatures_ = deviceFeatures;
 
         VkDeviceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -180,8 +244,20 @@ namespace ld
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
         createInfo.pEnabledFeatures = &deviceFeatures;
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        std::vector<const char*> extensions = deviceExtensions;
+        if (physicalDeviceProperties2Enabled_ && isDeviceExtensionAvailable(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+        {
+            extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+            memoryBudgetEnabled_ = true;
+        }
+        bool drawIndirectCount = isDeviceExtensionAvailable(physicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+        if (drawIndirectCount)
+        {
+            extensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+        }
+        std::cout << "memory budget: " << (memoryBudgetEnabled_ ? "VK_EXT_memory_budget" : "estimated") << std::endl;
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+        createInfo.ppEnabledExtensionNames = extensions.data();
 
         // might not really be necessary anymore because device specific validation layers
         // have been deprecated
@@ -199,9 +275,21 @@ namespace ld
         {
             throw std::runtime_error("failed to create logical device!");
         }
+        if (drawIndirectCount)
+        {
+            cmdDrawIndexedIndirectCount_ = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+                vkGetDeviceProcAddr(device_, "vkCmdDrawIndexedIndirectCountKHR"));
+        }
 
         vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
         vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+        vkGetDeviceQueue(device_, indices.transferFamily, 0, &transferQueue_);
+        graphicsFamily_ = indices.graphicsFamily;
+        transferFamily_ = indices.transferFamily;
+        if (hasDedicatedTransferQueue())
+        {
+            std::cout << "transfer queue family: " << transferFamily_ << std::endl;
+        }
     }
 
     void LdDevice::createCommandPool() 
@@ -211,8 +299,8 @@ namespace ld
         VkCommandPoolCreateInfo poolInfo = {};
         poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
         poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;
-        poolInfo.flags =
-            VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        // the one buffer is reset with the pool
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
 
         if (vkCreateCommandPool(device_, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
         {
@@ -341,6 +429,40 @@ namespace ld
         }
     }
 
+    bool LdDevice::isInstanceExtensionAvailable(const char* name)
+    {
+        uint32_t extensionCount = 0;
+        vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> extensions(extensionCount);
+        vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
+
+        for (const auto& extension : extensions)
+        {
+            if (strcmp(extension.extensionName, name) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool LdDevice::isDeviceExtensionAvailable(VkPhysicalDevice device, const char* name)
+    {
+        uint32_t extensionCount = 0;
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> extensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
+
+        for (const auto& extension : extensions)
+        {
+            if (strcmp(extension.extensionName, name) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
     bool LdDevice::checkDeviceExtensionSupport(VkPhysicalDevice device) 
     {
         uint32_t extensionCount;
@@ -396,6 +518,24 @@ namespace ld
             i++;
         }
 
+        // prefer a copy engine that does neither graphics nor compute, those run next to rendering
+        indices.transferFamily = indices.graphicsFamily;
+        int bestScore = 0;
+        for (uint32_t family = 0; family < queueFamilyCount; family++)
+        {
+            VkQueueFlags flags = queueFamilies[family].queueFlags;
+            if (queueFamilies[family].queueCount == 0 || !(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT))
+            {
+                continue;
+            }
+            int score = (flags & VK_QUEUE_COMPUTE_BIT) ? 1 : 2;
+            if (score > bestScore)
+            {
+                bestScore = score;
+                indices.transferFamily = family;
+            }
+        }
+
         return indices;
     }
 
@@ -462,13 +602,12 @@ namespace ld
         throw std::runtime_error("failed to find suitable memory type!");
     }
 
-    // rewrite when using a memory allocator
     void LdDevice::createBuffer(
         VkDeviceSize size,
         VkBufferUsageFlags usage,
         VkMemoryPropertyFlags properties,
         VkBuffer& buffer,
-        VkDeviceMemory& bufferMemory) 
+        LdMemoryAllocation& bufferMemory) 
     {
         VkBufferCreateInfo bufferInfo{};
         bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -476,37 +615,55 @@ namespace ld
         bufferInfo.usage = usage;
         bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-        if (vkCreateBuffer(device_, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+        // buffers filled by the transfer queue are read by the graphics queue, sharing them
+        // concurrently saves the queue family ownership transfers
+        uint32_t queueFamilies[] = { graphicsFamily_, transferFamily_ };
+        if (hasDedicatedTransferQueue() && (usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT))
         {
-            throw std::runtime_error("failed to create vertex buffer!");
+            bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            bufferInfo.queueFamilyIndexCount = 2;
+            bufferInfo.pQueueFamilyIndices = queueFamilies;
         }
 
-        VkMemoryRequirements memRequirements;
-        vkGetBufferMemoryRequirements(device_, buffer, &memRequirements);
-
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+        memoryAllocator_->createBuffer(bufferInfo, properties, bufferCategory(usage), buffer, bufferMemory);
+    }
 
-        if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
+    bool LdDevice::useDirectUploads() const
+    {
+        switch (uploadPolicy)
         {
-            throw std::runtime_error("failed to allocate vertex buffer memory!");
+        case UploadPolicy::Staging:
+            return false;
+        case UploadPolicy::Direct:
+            return hostVisibleDeviceLocalSize_ > 0;
+        default:
+            return hostVisibleDeviceLocalSize_ > BAR_WINDOW_SIZE;
         }
+    }
 
-        vkBindBufferMemory(device_, buffer, bufferMemory, 0);
+    VkMemoryPropertyFlags LdDevice::staticBufferMemoryProperties() const
+    {
+        if (useDirectUploads())
+        {
+            return VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        }
+        return VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
     }
 
     VkCommandBuffer LdDevice::beginSingleTimeCommands()
     {
-        VkCommandBufferAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandPool = commandPool;
-        allocInfo.commandBufferCount = 1;
-
-        VkCommandBuffer commandBuffer;
-        vkAllocateCommandBuffers(device_, &allocInfo, &commandBuffer);
+        // released in endSingleTimeCommands, recording needs the pool to itself
+        singleTimeMutex.lock();
+        if (singleTimeCommandBuffer == VK_NULL_HANDLE)
+        {
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandPool = commandPool;
+            allocInfo.commandBufferCount = 1;
+            vkAllocateCommandBuffers(device_, &allocInfo, &singleTimeCommandBuffer);
+        }
+        VkCommandBuffer commandBuffer = singleTimeCommandBuffer;
 
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -528,16 +685,17 @@ namespace ld
         vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
         vkQueueWaitIdle(graphicsQueue_);
 
-        vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
+        vkResetCommandPool(device_, commandPool, 0);
+        singleTimeMutex.unlock();
     }
 
-    void LdDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
+    void LdDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize dstOffset)
     {
         VkCommandBuffer commandBuffer = beginSingleTimeCommands();
 
         VkBufferCopy copyRegion{};
         copyRegion.srcOffset = 0;  // Optional
-        copyRegion.dstOffset = 0;  // Optional
+        copyRegion.dstOffset = dstOffset;
         copyRegion.size = size;
         vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
@@ -571,30 +729,9 @@ namespace ld
         endSingleTimeCommands(commandBuffer);
     }
 
-    void LdDevice::createImageWithInfo(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory)
+    void LdDevice::createImageWithInfo(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, VkImage& image, LdMemoryAllocation& imageMemory)
     {
-        if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS)
-        {
-            throw std::runtime_error("failed to create image!");
-        }
-
-        VkMemoryRequirements memRequirements;
-        vkGetImageMemoryRequirements(device_, image, &memRequirements);
-
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-        if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) 
-        {
-            throw std::runtime_error("failed to allocate image memory!");
-        }
-
-        if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS) 
-        {
-            throw std::runtime_error("failed to bind image memory!");
-        }
+        memoryAllocator_->createImage(imageInfo, properties, imageCategory(imageInfo.usage), image, imageMemory);
     }
 
 }  // namespace lve
\ No newline at end of file
@@ -1,8 +1,11 @@
 #pragma once
 
+#include "ld_memory_allocator.hpp"
 #include "ld_window.hpp"
 
 // std lib headers
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -17,6 +20,8 @@ namespace ld {
 	struct QueueFamilyIndices {
 		uint32_t graphicsFamily;
 		uint32_t presentFamily;
+		// a family that can only copy if the device has one, otherwise the graphics family
+		uint32_t transferFamily;
 		bool graphicsFamilyHasValue = false;
 		bool presentFamilyHasValue = false;
 		bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
@@ -39,14 +44,40 @@ namespace ld {
 		LdDevice(LdDevice&&) = delete;
 		LdDevice& operator=(LdDevice&&) = delete;
 
-		VkCommandPool getCommandPool() { return commandPool; }
 		VkDevice device() { return device_; }
 		VkSurfaceKHR surface() { return surface_; }
 		VkQueue graphicsQueue() { return graphicsQueue_; }
 		VkQueue presentQueue() { return presentQueue_; }
+		// same as graphicsQueue() when there is no dedicated transfer family
+		VkQueue transferQueue() { return transferQueue_; }
+		uint32_t transferQueueFamily() const { return transferFamily_; }
+		bool hasDedicatedTransferQueue() const { return transferFamily_ != graphicsFamily_; }
+		// VK_EXT_memory_budget is enabled, the allocator reports the driver's budget
+		bool hasMemoryBudget() const { return memoryBudgetEnabled_; }
+
+		// Staging always copies through host memory. Direct makes static buffers host visible device
+		// local and writes them in place whenever the device has such memory, Auto only when its heap is
+		// larger than the 256 MiB PCIe window, i.e. on UMA, resizable BAR and software devices.
+		// Buffers keep the memory they were created with, set the policy before the first static buffer.
+		enum class UploadPolicy { Auto, Staging, Direct };
+		void setUploadPolicy(UploadPolicy policy) { uploadPolicy = policy; }
+		UploadPolicy getUploadPolicy() const { return uploadPolicy; }
+		// largest heap behind a device local, host visible and coherent memory type, 0 if there is none
+		VkDeviceSize getHostVisibleDeviceLocalSize() const { return hostVisibleDeviceLocalSize_; }
+		bool useDirectUploads() const;
+		// memory properties for buffers filled once from the cpu, mapped and written when host visible
+		VkMemoryPropertyFlags staticBufferMemoryProperties() const;
+
+		// optional features are enabled whenever the device has them
+		const VkPhysicalDeviceFeatures& getEnabledFeatures() const { return enabledFeatures_; }
+		// multi draw indirect with firstInstance, what gpu driven draws need at the least
+		bool supportsMultiDrawIndirect() const { return enabledFeatures_.multiDrawIndirect && enabledFeatures_.drawIndirectFirstInstance; }
+		// vkCmdDrawIndexedIndirectCountKHR from VK_KHR_draw_indirect_count, nullptr if unsupported
+		PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount() const { return cmdDrawIndexedIndirectCount_; }
 
 		SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
 		uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+		LdMemoryAllocator& memoryAllocator() { return *memoryAllocator_; }
 		QueueFamilyIndices findPhysicalQueueFamilies() { return findQueueFamilies(physicalDevice); }
 		VkFormat findSupportedFormat(
 			const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
@@ -57,10 +88,12 @@ namespace ld {
 			VkBufferUsageFlags usage,
 			VkMemoryPropertyFlags properties,
 			VkBuffer& buffer,
-			VkDeviceMemory& bufferMemory);
+			LdMemoryAllocation& bufferMemory);
+		// Any thread may record single time commands, the calling thread holds the pool from begin to
+		// end so they run one after the other. The buffer is reused and its pool reset once it completed.
 		VkCommandBuffer beginSingleTimeCommands();
 		void endSingleTimeCommands(VkCommandBuffer commandBuffer);
-		void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+		void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize dstOffset = 0);
 		void copyBufferToImage(
 			VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
 
@@ -68,7 +101,7 @@ namespace ld {
 			const VkImageCreateInfo& imageInfo,
 			VkMemoryPropertyFlags properties,
 			VkImage& image,
-			VkDeviceMemory& imageMemory);
+			LdMemoryAllocation& imageMemory);
 
 		VkPhysicalDeviceProperties properties;
 
@@ -88,18 +121,33 @@ namespace ld {
 		void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
 		void hasGflwRequiredInstanceExtensions();
 		bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+		bool isInstanceExtensionAvailable(const char* name);
+		bool isDeviceExtensionAvailable(VkPhysicalDevice device, const char* name);
 		SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 
 		VkInstance instance;
 		VkDebugUtilsMessengerEXT debugMessenger;
 		VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
 		LdWindow& window;
+		// single time commands only, frames record into LdFrameCommandPool
 		VkCommandPool commandPool;
+		std::mutex singleTimeMutex{};
+		VkCommandBuffer singleTimeCommandBuffer = VK_NULL_HANDLE;
 
 		VkDevice device_;
 		VkSurfaceKHR surface_;
 		VkQueue graphicsQueue_;
 		VkQueue presentQueue_;
+		VkQueue transferQueue_;
+		std::unique_ptr<LdMemoryAllocator> memoryAllocator_;
+		uint32_t graphicsFamily_;
+		uint32_t transferFamily_;
+		bool physicalDeviceProperties2Enabled_ = false;
+		bool memoryBudgetEnabled_ = false;
+		VkDeviceSize hostVisibleDeviceLocalSize_ = 0;
+		UploadPolicy uploadPolicy = UploadPolicy::Auto;
+		VkPhysicalDeviceFeatures enabledFeatures_{};
+		PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount_ = nullptr;
 
 		const std::vector<const char*> validationLayers = { "VK_LAYER_KHRONOS_validation" };
 		const std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
@@ -0,0 +1,54 @@
+#include "ld_frame_allocator.hpp"
+
+#include "ld_swapchain.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace ld {
+	LdFrameAllocator::LdFrameAllocator(LdDevice& device, Settings settings)
+	{
+		alignment = std::max<VkDeviceSize>(device.properties.limits.minUniformBufferOffsetAlignment, 16);
+		buffer = std::make_unique<LdBuffer>(
+			device,
+			settings.frameSize,
+			LdSwapChain::MAX_FRAMES_IN_FLIGHT,
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			alignment);
+		if (buffer->map() != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to map frame allocator buffer!");
+		}
+		stats.frameSize = buffer->getBufferSize() / LdSwapChain::MAX_FRAMES_IN_FLIGHT;
+	}
+
+	void LdFrameAllocator::beginFrame(int frameIndex)
+	{
+		this->frameIndex = frameIndex;
+		head = 0;
+		stats.allocations = 0;
+		stats.usedBytes = 0;
+	}
+
+	LdFrameAllocator::Allocation LdFrameAllocator::allocate(VkDeviceSize size, VkDeviceSize alignment)
+	{
+		// both are powers of two, the larger one satisfies either
+		alignment = std::max(alignment, this->alignment);
+		VkDeviceSize offset = (head + alignment - 1) & ~(alignment - 1);
+		if (offset + size > stats.frameSize)
+		{
+			throw std::runtime_error("frame allocator out of memory!");
+		}
+		head = offset + size;
+		stats.allocations++;
+		stats.usedBytes = head;
+		stats.peakBytes = std::max(stats.peakBytes, head);
+
+		Allocation allocation{};
+		allocation.buffer = buffer->getBuffer();
+		allocation.offset = getFrameOffset() + offset;
+		allocation.mapped = static_cast<char*>(buffer->getMappedMemory()) + allocation.offset;
+		return allocation;
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "ld_buffer.hpp"
+#include "ld_device.hpp"
+
+#include <memory>
+
+namespace ld {
+	// Transient per frame memory for uniforms and vertex data that only live for one frame. A single
+	// persistently mapped buffer holds one slice per frame in flight, allocations bump a pointer inside
+	// the current slice and are aligned for use as dynamic uniform buffer offsets.
+	//
+	// beginFrame() rewinds the slice, which is only safe once the frame's fence has signaled, i.e. after
+	// LdRenderer::beginFrame().
+	class LdFrameAllocator {
+	public:
+		struct Settings {
+			VkDeviceSize frameSize = 4ull * 1024 * 1024;
+		};
+
+		struct Allocation {
+			VkBuffer buffer = VK_NULL_HANDLE;
+			// from the start of the buffer, pass as the dynamic offset or bind offset
+			VkDeviceSize offset = 0;
+			void* mapped = nullptr;
+		};
+
+		struct Stats {
+			uint32_t allocations = 0;
+			VkDeviceSize usedBytes = 0;
+			VkDeviceSize peakBytes = 0;
+			VkDeviceSize frameSize = 0;
+		};
+
+		explicit LdFrameAllocator(LdDevice& device) : LdFrameAllocator(device, Settings{}) {}
+		LdFrameAllocator(LdDevice& device, Settings settings);
+
+		LdFrameAllocator(const LdFrameAllocator&) = delete;
+		LdFrameAllocator& operator=(const LdFrameAllocator&) = delete;
+
+	private:
+		VkDeviceSize alignment;
+		std::unique_ptr<LdBuffer> buffer;
+		int frameIndex = 0;
+		VkDeviceSize head = 0;
+		Stats stats{};
+
+	public:
+		void beginFrame(int frameIndex);
+		// throws once the frame's slice is full. alignment, a power of two, only matters above the
+		// dynamic uniform offset alignment, e.g. to index an array of larger structs from the slice start
+		Allocation allocate(VkDeviceSize size, VkDeviceSize alignment = 1);
+
+		template<typename T>
+		Allocation write(const T& data)
+		{
+			Allocation allocation = allocate(sizeof(T));
+			*static_cast<T*>(allocation.mapped) = data;
+			return allocation;
+		}
+
+		VkBuffer getBuffer() const { return buffer->getBuffer(); }
+		// for a dynamic uniform buffer descriptor, the offset comes with each bind
+		VkDescriptorBufferInfo descriptorInfo(VkDeviceSize range) { return buffer->descriptorInfo(range, 0); }
+		// start of the current frame's slice, as a dynamic offset for descriptors spanning a whole slice
+		VkDeviceSize getFrameOffset() const { return frameIndex * stats.frameSize; }
+		const Stats& getStats() const { return stats; }
+	};
+}
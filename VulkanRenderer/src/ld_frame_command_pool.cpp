@@ -0,0 +1,67 @@
+#include "ld_frame_command_pool.hpp"
+
+#include <stdexcept>
+
+namespace ld {
+	LdFrameCommandPool::LdFrameCommandPool(LdDevice& device) : ldDevice{ device }
+	{
+		for (Frame& frame : frames)
+		{
+			VkCommandPoolCreateInfo poolInfo{};
+			poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			poolInfo.queueFamilyIndex = ldDevice.findPhysicalQueueFamilies().graphicsFamily;
+			// no RESET_COMMAND_BUFFER_BIT, buffers are only ever reset with their pool
+			poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+			if (vkCreateCommandPool(ldDevice.device(), &poolInfo, nullptr, &frame.pool) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create frame command pool!");
+			}
+		}
+	}
+
+	LdFrameCommandPool::~LdFrameCommandPool()
+	{
+		// destroying the pools frees the command buffers
+		for (Frame& frame : frames)
+		{
+			vkDestroyCommandPool(ldDevice.device(), frame.pool, nullptr);
+		}
+	}
+
+	void LdFrameCommandPool::reset(int frameIndex)
+	{
+		this->frameIndex = frameIndex;
+		Frame& frame = frames[frameIndex];
+		if (vkResetCommandPool(ldDevice.device(), frame.pool, 0) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to reset frame command pool!");
+		}
+		frame.used = {};
+	}
+
+	VkCommandBuffer LdFrameCommandPool::acquire(VkCommandBufferLevel level)
+	{
+		Frame& frame = frames[frameIndex];
+		size_t index = level == VK_COMMAND_BUFFER_LEVEL_PRIMARY ? 0 : 1;
+		auto& buffers = frame.buffers[index];
+		uint32_t& used = frame.used[index];
+		if (used < buffers.size())
+		{
+			return buffers[used++];
+		}
+
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = level;
+		allocInfo.commandPool = frame.pool;
+		allocInfo.commandBufferCount = 1;
+		VkCommandBuffer commandBuffer;
+		if (vkAllocateCommandBuffers(ldDevice.device(), &allocInfo, &commandBuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to allocate frame command buffer!");
+		}
+		buffers.push_back(commandBuffer);
+		used++;
+		return commandBuffer;
+	}
+}
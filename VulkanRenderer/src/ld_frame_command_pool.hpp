@@ -0,0 +1,46 @@
+#pragma once
+
+#include "ld_device.hpp"
+#include "ld_swapchain.hpp"
+
+#include <array>
+#include <vector>
+
+namespace ld {
+	// Command buffers that live for one frame. There is one VkCommandPool per frame in flight and
+	// reset() returns every buffer of a frame to the initial state with a single vkResetCommandPool,
+	// acquire() then hands the same buffers out again and allocates only when a frame needs more than
+	// any frame before it. Nothing is freed or reset one buffer at a time.
+	//
+	// A pool and its buffers may only be used by one thread at a time, threads that record in
+	// parallel need a pool each, see LdParallelRecorder.
+	class LdFrameCommandPool {
+	public:
+		LdFrameCommandPool(LdDevice& device);
+		~LdFrameCommandPool();
+
+		LdFrameCommandPool(const LdFrameCommandPool&) = delete;
+		LdFrameCommandPool& operator=(const LdFrameCommandPool&) = delete;
+
+	private:
+		struct Frame {
+			VkCommandPool pool = VK_NULL_HANDLE;
+			// indexed by level, primary first
+			std::array<std::vector<VkCommandBuffer>, 2> buffers{};
+			// buffers handed out since the last reset
+			std::array<uint32_t, 2> used{};
+		};
+
+		LdDevice& ldDevice;
+		std::array<Frame, LdSwapChain::MAX_FRAMES_IN_FLIGHT> frames{};
+		int frameIndex = 0;
+
+	public:
+		// call once the frame's fence has signaled, before anything records for it
+		void reset(int frameIndex);
+		// a buffer of the current frame in the initial state, valid until the frame is reset again
+		VkCommandBuffer acquire(VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+
+		int getFrameIndex() const { return frameIndex; }
+	};
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ld_camera.hpp"
+#include "ld_frame_allocator.hpp"
 #include "ld_game_object.hpp"
 
 
@@ -30,6 +31,10 @@ namespace ld {
 		VkCommandBuffer commandBuffer;
 		LdCamera& camera;
 		VkDescriptorSet globalDescriptorSet;
+		// dynamic offset of this frame's GlobalUBO in globalDescriptorSet
+		uint32_t globalUboOffset;
 		LdGameObject::Map& gameObjects;
+		// transient uniforms and vertices, rewound every frame
+		LdFrameAllocator& frameAllocator;
 	};	
 }
\ No newline at end of file
@@ -0,0 +1,40 @@
+#include "ld_frustum.hpp"
+
+namespace ld {
+	LdFrustum::LdFrustum(const glm::mat4& viewProjection)
+	{
+		// Gribb/Hartmann, rows of the column major matrix
+		glm::vec4 rows[4];
+		for (int i = 0; i < 4; i++)
+		{
+			rows[i] = glm::vec4{ viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i] };
+		}
+		planes[LEFT] = rows[3] + rows[0];
+		planes[RIGHT] = rows[3] - rows[0];
+		planes[BOTTOM] = rows[3] + rows[1];
+		planes[TOP] = rows[3] - rows[1];
+		planes[NEAR_PLANE] = rows[2]; // depth is [0, w], not [-w, w]
+		planes[FAR_PLANE] = rows[3] - rows[2];
+
+		for (auto& plane : planes)
+		{
+			float length = glm::length(glm::vec3{ plane });
+			if (length > 0.f)
+			{
+				plane /= length;
+			}
+		}
+	}
+
+	bool LdFrustum::intersectsSphere(const glm::vec3& center, float radius) const
+	{
+		for (const auto& plane : planes)
+		{
+			if (glm::dot(glm::vec3{ plane }, center) + plane.w < -radius)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+namespace ld {
+	// View frustum as six inward facing planes (xyz normal, w distance), extracted from a
+	// projection * view matrix with Vulkan's [0, 1] depth range.
+	class LdFrustum {
+	public:
+		enum Plane { LEFT = 0, RIGHT, BOTTOM, TOP, NEAR_PLANE, FAR_PLANE, PLANE_COUNT };
+
+		LdFrustum() = default;
+		explicit LdFrustum(const glm::mat4& viewProjection);
+
+	private:
+		glm::vec4 planes[PLANE_COUNT]{};
+
+	public:
+		const glm::vec4& getPlane(int plane) const { return planes[plane]; }
+		bool intersectsSphere(const glm::vec3& center, float radius) const;
+	};
+}
@@ -0,0 +1,255 @@
+#include "ld_frustum_culler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define LD_CULLER_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+// MSVC emits AVX intrinsics without /arch:AVX, cull() only calls them after checking the cpu
+#define LD_TARGET_AVX
+#else
+#define LD_TARGET_AVX __attribute__((target("avx")))
+#endif
+#endif
+
+namespace ld {
+	namespace {
+		constexpr uint32_t BATCH_SIZE = 8;
+
+		bool cpuSupportsAvx()
+		{
+#if defined(LD_CULLER_X86) && defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 1);
+			bool osxsave = (info[2] & (1 << 27)) != 0;
+			bool avx = (info[2] & (1 << 28)) != 0;
+			// the os has to save the ymm registers on context switches too
+			return osxsave && avx && (_xgetbv(0) & 0x6) == 0x6;
+#elif defined(LD_CULLER_X86)
+			return __builtin_cpu_supports("avx");
+#else
+			return false;
+#endif
+		}
+	}
+
+	LdFrustumCuller::LdFrustumCuller()
+		: instructionSet{ bestInstructionSet() }
+	{
+	}
+
+	LdFrustumCuller::InstructionSet LdFrustumCuller::bestInstructionSet()
+	{
+#if defined(LD_CULLER_X86)
+		// SSE is part of every x86-64 cpu and of the 32 bit MSVC default target
+		static const InstructionSet best = cpuSupportsAvx() ? InstructionSet::Avx : InstructionSet::Sse;
+		return best;
+#else
+		return InstructionSet::Scalar;
+#endif
+	}
+
+	const char* LdFrustumCuller::instructionSetName(InstructionSet instructionSet)
+	{
+		switch (instructionSet)
+		{
+		case InstructionSet::Scalar: return "scalar";
+		case InstructionSet::Sse: return "sse";
+		case InstructionSet::Avx: return "avx";
+		default: return "unknown";
+		}
+	}
+
+	void LdFrustumCuller::setInstructionSet(InstructionSet requested)
+	{
+		instructionSet = std::min(requested, bestInstructionSet());
+	}
+
+	void LdFrustumCuller::begin(const LdCamera& camera)
+	{
+		begin(camera.getProjection() * camera.getView());
+	}
+
+	void LdFrustumCuller::begin(const glm::mat4& viewProjection)
+	{
+		frustum = LdFrustum{ viewProjection };
+		centerX.clear();
+		centerY.clear();
+		centerZ.clear();
+		radius.clear();
+		extentX.clear();
+		extentY.clear();
+		extentZ.clear();
+		count = 0;
+		stats = Stats{};
+	}
+
+	uint32_t LdFrustumCuller::add(const LdModel::Bounds& bounds, const glm::mat4& modelMatrix)
+	{
+		glm::vec3 center = glm::vec3{ modelMatrix * glm::vec4{ bounds.center, 1.f } };
+		glm::vec3 extent = (bounds.max - bounds.min) * 0.5f;
+		// extents of the box around the transformed box, Arvo
+		glm::vec3 worldExtent{ 0.f };
+		for (int column = 0; column < 3; column++)
+		{
+			worldExtent += glm::abs(glm::vec3{ modelMatrix[column] }) * extent[column];
+		}
+		float scale = std::max({ glm::length(glm::vec3{ modelMatrix[0] }), glm::length(glm::vec3{ modelMatrix[1] }),
+			glm::length(glm::vec3{ modelMatrix[2] }) });
+
+		centerX.push_back(center.x);
+		centerY.push_back(center.y);
+		centerZ.push_back(center.z);
+		radius.push_back(bounds.radius * scale);
+		extentX.push_back(worldExtent.x);
+		extentY.push_back(worldExtent.y);
+		extentZ.push_back(worldExtent.z);
+		return count++;
+	}
+
+	const std::vector<uint32_t>& LdFrustumCuller::cull()
+	{
+		visible.clear();
+		// padding lanes have a negative radius, which every plane rejects
+		uint32_t padded = (count + BATCH_SIZE - 1) / BATCH_SIZE * BATCH_SIZE;
+		for (auto* values : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ })
+		{
+			values->resize(padded, 0.f);
+		}
+		radius.resize(padded, -std::numeric_limits<float>::max());
+
+		switch (instructionSet)
+		{
+		case InstructionSet::Avx: cullAvx(); break;
+		case InstructionSet::Sse: cullSse(); break;
+		default: cullScalar(); break;
+		}
+
+		// the next add() appends after the real objects again
+		for (auto* values : { &centerX, &centerY, &centerZ, &radius, &extentX, &extentY, &extentZ })
+		{
+			values->resize(count);
+		}
+		stats.tested = count;
+		stats.visible = static_cast<uint32_t>(visible.size());
+		stats.culled = count - stats.visible;
+		return visible;
+	}
+
+	void LdFrustumCuller::cullScalar()
+	{
+		for (uint32_t i = 0; i < count; i++)
+		{
+			bool inside = true;
+			for (int p = 0; p < LdFrustum::PLANE_COUNT && inside; p++)
+			{
+				const glm::vec4& plane = frustum.getPlane(p);
+				float distance = plane.x * centerX[i] + plane.y * centerY[i] + plane.z * centerZ[i] + plane.w;
+				// how far the box reaches towards the plane, the smaller of the two bounds decides
+				float boxReach = std::abs(plane.x) * extentX[i] + std::abs(plane.y) * extentY[i] + std::abs(plane.z) * extentZ[i];
+				inside = distance + std::min(radius[i], boxReach) >= 0.f;
+			}
+			if (inside)
+			{
+				visible.push_back(i);
+			}
+		}
+	}
+
+	void LdFrustumCuller::cullSse()
+	{
+#if defined(LD_CULLER_X86)
+		const __m128 zero = _mm_setzero_ps();
+		for (uint32_t i = 0; i < count; i += 4)
+		{
+			__m128 cx = _mm_loadu_ps(&centerX[i]);
+			__m128 cy = _mm_loadu_ps(&centerY[i]);
+			__m128 cz = _mm_loadu_ps(&centerZ[i]);
+			__m128 r = _mm_loadu_ps(&radius[i]);
+			__m128 ex = _mm_loadu_ps(&extentX[i]);
+			__m128 ey = _mm_loadu_ps(&extentY[i]);
+			__m128 ez = _mm_loadu_ps(&extentZ[i]);
+
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int p = 0; p < LdFrustum::PLANE_COUNT; p++)
+			{
+				const glm::vec4& plane = frustum.getPlane(p);
+				__m128 distance = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), cx), _mm_mul_ps(_mm_set1_ps(plane.y), cy)),
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), cz), _mm_set1_ps(plane.w)));
+				__m128 boxReach = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(std::abs(plane.x)), ex), _mm_mul_ps(_mm_set1_ps(std::abs(plane.y)), ey)),
+					_mm_mul_ps(_mm_set1_ps(std::abs(plane.z)), ez));
+				__m128 reach = _mm_add_ps(distance, _mm_min_ps(r, boxReach));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(reach, zero));
+			}
+
+			int mask = _mm_movemask_ps(inside);
+			while (mask != 0)
+			{
+				uint32_t lane = 0;
+				while ((mask & (1 << lane)) == 0) lane++;
+				mask &= mask - 1;
+				visible.push_back(i + lane);
+			}
+		}
+#else
+		cullScalar();
+#endif
+	}
+
+#if defined(LD_CULLER_X86)
+	namespace {
+		// the same test as cullSse() on eight objects, compiled for AVX on its own
+		LD_TARGET_AVX int cullBatchAvx(const LdFrustum& frustum, const float* cx, const float* cy, const float* cz,
+			const float* r, const float* ex, const float* ey, const float* ez)
+		{
+			__m256 centerX = _mm256_loadu_ps(cx);
+			__m256 centerY = _mm256_loadu_ps(cy);
+			__m256 centerZ = _mm256_loadu_ps(cz);
+			__m256 radius = _mm256_loadu_ps(r);
+			__m256 extentX = _mm256_loadu_ps(ex);
+			__m256 extentY = _mm256_loadu_ps(ey);
+			__m256 extentZ = _mm256_loadu_ps(ez);
+
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int p = 0; p < LdFrustum::PLANE_COUNT; p++)
+			{
+				const glm::vec4& plane = frustum.getPlane(p);
+				__m256 distance = _mm256_add_ps(
+					_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), centerX), _mm256_mul_ps(_mm256_set1_ps(plane.y), centerY)),
+					_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.z), centerZ), _mm256_set1_ps(plane.w)));
+				__m256 boxReach = _mm256_add_ps(
+					_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(std::abs(plane.x)), extentX), _mm256_mul_ps(_mm256_set1_ps(std::abs(plane.y)), extentY)),
+					_mm256_mul_ps(_mm256_set1_ps(std::abs(plane.z)), extentZ));
+				__m256 reach = _mm256_add_ps(distance, _mm256_min_ps(radius, boxReach));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(reach, _mm256_setzero_ps(), _CMP_GE_OQ));
+			}
+			return _mm256_movemask_ps(inside);
+		}
+	}
+#endif
+
+	void LdFrustumCuller::cullAvx()
+	{
+#if defined(LD_CULLER_X86)
+		for (uint32_t i = 0; i < count; i += BATCH_SIZE)
+		{
+			int mask = cullBatchAvx(frustum, &centerX[i], &centerY[i], &centerZ[i], &radius[i], &extentX[i], &extentY[i], &extentZ[i]);
+			while (mask != 0)
+			{
+				uint32_t lane = 0;
+				while ((mask & (1 << lane)) == 0) lane++;
+				mask &= mask - 1;
+				visible.push_back(i + lane);
+			}
+		}
+#else
+		cullScalar();
+#endif
+	}
+}
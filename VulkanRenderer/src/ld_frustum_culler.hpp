@@ -0,0 +1,64 @@
+#pragma once
+
+#include "ld_camera.hpp"
+#include "ld_frustum.hpp"
+#include "ld_model.hpp"
+
+#include <vector>
+
+namespace ld {
+	// Culls whole objects on the cpu before anything else looks at them. add() transforms an object's
+	// bounds to world space and stores them structure of arrays, cull() then tests four or eight objects
+	// per plane at once with SSE or AVX. An object is culled when its bounding sphere or its box lies
+	// fully outside one of the frustum planes.
+	class LdFrustumCuller {
+	public:
+		enum class InstructionSet { Scalar, Sse, Avx };
+
+		struct Stats {
+			uint32_t tested = 0;
+			uint32_t visible = 0;
+			uint32_t culled = 0;
+		};
+
+		// uses the widest instruction set the cpu supports
+		LdFrustumCuller();
+
+	private:
+		InstructionSet instructionSet;
+		LdFrustum frustum{};
+		// world space bounds, padded with objects that are always culled up to a multiple of eight
+		std::vector<float> centerX{};
+		std::vector<float> centerY{};
+		std::vector<float> centerZ{};
+		std::vector<float> radius{};
+		std::vector<float> extentX{};
+		std::vector<float> extentY{};
+		std::vector<float> extentZ{};
+		uint32_t count = 0;
+		std::vector<uint32_t> visible{};
+		Stats stats{};
+
+	public:
+		static InstructionSet bestInstructionSet();
+		static const char* instructionSetName(InstructionSet instructionSet);
+		// falls back to the best supported set when the cpu lacks the requested one
+		void setInstructionSet(InstructionSet requested);
+		InstructionSet getInstructionSet() const { return instructionSet; }
+
+		// call once per frame before add(), forgets the objects of the last frame and resets the statistics
+		void begin(const LdCamera& camera);
+		void begin(const glm::mat4& viewProjection);
+		// returns the object's index, cull() reports the visible ones by it
+		uint32_t add(const LdModel::Bounds& bounds, const glm::mat4& modelMatrix);
+		// indices of the visible objects added since begin(), in ascending order
+		const std::vector<uint32_t>& cull();
+
+		const Stats& getStats() const { return stats; }
+
+	private:
+		void cullScalar();
+		void cullSse();
+		void cullAvx();
+	};
+}
@@ -41,6 +41,11 @@ namespace ld {
 		// optional components
 		std::shared_ptr<LdModel> model{};
 		std::unique_ptr<PointLightComponent> pointLight = nullptr;
+		// rasterized into the software occlusion buffer with its model's occluder mesh, see LdOcclusionCuller.
+		// The model has to come from LdModelRegistry::get() with occluder set
+		bool occluder = false;
+		// never moves, drawn from command buffers recorded once, see SimpleRenderSystem::staticCaching
+		bool isStatic = false;
 	private:
 		id_t id;
 
@@ -0,0 +1,322 @@
+#include "ld_geometry_arena.hpp"
+
+#include "ld_swapchain.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace ld {
+	namespace {
+		// frames that may still be reading a range after the cpu let go of it
+		constexpr uint64_t FRAMES_IN_USE = LdSwapChain::MAX_FRAMES_IN_FLIGHT + 1;
+	}
+
+	LdGeometryArena::LdGeometryArena(LdDevice& device, Settings settings) : ldDevice{ device }, settings{ settings }
+	{
+		for (size_t i = 0; i < vertexPools.size(); i++)
+		{
+			auto format = static_cast<LdModel::VertexFormat>(i);
+			vertexPools[i].stride = format == LdModel::VertexFormat::Float32 ? sizeof(LdModel::Vertex) : sizeof(LdModel::PackedVertex);
+			vertexPools[i].blockSize = settings.vertexBlockSize;
+			vertexPools[i].usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+		}
+		indexPools[0].stride = sizeof(uint16_t);
+		indexPools[1].stride = sizeof(uint32_t);
+		for (auto& pool : indexPools)
+		{
+			pool.blockSize = settings.indexBlockSize;
+			pool.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+		}
+
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = ldDevice.findPhysicalQueueFamilies().graphicsFamily;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		if (vkCreateCommandPool(ldDevice.device(), &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create geometry compaction command pool!");
+		}
+	}
+
+	LdGeometryArena::~LdGeometryArena()
+	{
+		// destroying the pool frees the command buffers
+		vkDestroyCommandPool(ldDevice.device(), commandPool, nullptr);
+	}
+
+	std::unique_ptr<LdGeometryArena::Allocation> LdGeometryArena::allocate(LdModel::VertexFormat vertexFormat, uint32_t vertexCount,
+		VkIndexType indexType, uint32_t indexCount)
+	{
+		auto allocation = std::make_unique<Allocation>();
+		allocation->vertexFormat = vertexFormat;
+		allocation->indexType = indexType;
+		allocation->vertexCount = vertexCount;
+		allocation->indexCount = indexCount;
+
+		std::lock_guard<std::mutex> lock{ mutex };
+		uint64_t offset = 0;
+		Pool& vertices = vertexPool(vertexFormat);
+		allocation->vertexBlock = allocateRange(vertices, vertexCount, offset);
+		allocation->vertexOffset = static_cast<uint32_t>(offset);
+		allocation->vertexBuffer = vertices.blocks[allocation->vertexBlock].buffer->getBuffer();
+		if (indexCount > 0)
+		{
+			Pool& indices = indexPool(indexType);
+			allocation->indexBlock = allocateRange(indices, indexCount, offset);
+			allocation->firstIndex = static_cast<uint32_t>(offset);
+			allocation->indexBuffer = indices.blocks[allocation->indexBlock].buffer->getBuffer();
+		}
+		liveAllocations.insert(allocation.get());
+		return allocation;
+	}
+
+	void LdGeometryArena::free(Allocation& allocation)
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		liveAllocations.erase(&allocation);
+		pendingFrees.push_back({ &vertexPool(allocation.vertexFormat), allocation.vertexBlock, allocation.vertexOffset, allocation.vertexCount, frame });
+		if (allocation.indexCount > 0)
+		{
+			pendingFrees.push_back({ &indexPool(allocation.indexType), allocation.indexBlock, allocation.firstIndex, allocation.indexCount, frame });
+		}
+	}
+
+	VkDeviceSize LdGeometryArena::getVertexByteOffset(const Allocation& allocation) const
+	{
+		return allocation.vertexOffset * vertexPool(allocation.vertexFormat).stride;
+	}
+
+	VkDeviceSize LdGeometryArena::getIndexByteOffset(const Allocation& allocation) const
+	{
+		return allocation.firstIndex * indexPool(allocation.indexType).stride;
+	}
+
+	void* LdGeometryArena::getMappedVertexData(const Allocation& allocation) const
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		auto* mapped = static_cast<uint8_t*>(vertexPool(allocation.vertexFormat).blocks[allocation.vertexBlock].buffer->getMappedMemory());
+		return mapped ? mapped + getVertexByteOffset(allocation) : nullptr;
+	}
+
+	void* LdGeometryArena::getMappedIndexData(const Allocation& allocation) const
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		auto* mapped = static_cast<uint8_t*>(indexPool(allocation.indexType).blocks[allocation.indexBlock].buffer->getMappedMemory());
+		return mapped ? mapped + getIndexByteOffset(allocation) : nullptr;
+	}
+
+	void LdGeometryArena::update()
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		frame++;
+
+		pendingFrees.erase(std::remove_if(pendingFrees.begin(), pendingFrees.end(), [this](const PendingFree& pending) {
+			if (frame - pending.frame <= FRAMES_IN_USE)
+			{
+				return false;
+			}
+			pending.pool->blocks[pending.block].ranges.free(pending.offset, pending.count);
+			return true;
+		}), pendingFrees.end());
+
+		retired.erase(std::remove_if(retired.begin(), retired.end(), [this](Retired& old) {
+			if (frame - old.frame <= FRAMES_IN_USE)
+			{
+				return false;
+			}
+			if (old.commandBuffer != VK_NULL_HANDLE)
+			{
+				spareCommandBuffers.push_back(old.commandBuffer);
+			}
+			return true;
+		}), retired.end());
+
+		// moving data under an upload in flight would lose it
+		for (const Allocation* allocation : liveAllocations)
+		{
+			if (!allocation->ready.load(std::memory_order_acquire))
+			{
+				return;
+			}
+		}
+
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		Retired retiring{ frame };
+		for (auto& pool : vertexPools)
+		{
+			if (needsCompaction(pool))
+			{
+				compact(pool, true, commandBuffer, retiring);
+			}
+		}
+		for (auto& pool : indexPools)
+		{
+			if (needsCompaction(pool))
+			{
+				compact(pool, false, commandBuffer, retiring);
+			}
+		}
+		if (commandBuffer == VK_NULL_HANDLE)
+		{
+			return;
+		}
+
+		// make the copies visible to every draw submitted after them on this queue
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		vkEndCommandBuffer(commandBuffer);
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+		if (vkQueueSubmit(ldDevice.graphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to submit geometry compaction!");
+		}
+		retiring.commandBuffer = commandBuffer;
+		retired.push_back(std::move(retiring));
+	}
+
+	LdGeometryArena::Stats LdGeometryArena::getStats() const
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		Stats stats{};
+		stats.allocations = static_cast<uint32_t>(liveAllocations.size());
+		stats.compactions = compactions;
+		stats.bytesMoved = bytesMoved;
+		auto addPool = [&](const Pool& pool) {
+			for (const auto& block : pool.blocks)
+			{
+				stats.blocks++;
+				stats.capacityBytes += block.ranges.getSize() * pool.stride;
+				stats.usedBytes += block.ranges.getUsed() * pool.stride;
+			}
+		};
+		for (const auto& pool : vertexPools) addPool(pool);
+		for (const auto& pool : indexPools) addPool(pool);
+		return stats;
+	}
+
+	uint32_t LdGeometryArena::allocateRange(Pool& pool, uint64_t count, uint64_t& offset)
+	{
+		for (uint32_t i = 0; i < pool.blocks.size(); i++)
+		{
+			offset = pool.blocks[i].ranges.allocate(count);
+			if (offset != LdRangeAllocator::INVALID_OFFSET)
+			{
+				return i;
+			}
+		}
+
+		// meshes larger than a block get a block of their own
+		uint64_t blockCount = std::max<uint64_t>(pool.blockSize / pool.stride, count);
+		VkMemoryPropertyFlags properties = ldDevice.staticBufferMemoryProperties();
+		pool.blocks.push_back({
+			std::make_unique<LdBuffer>(ldDevice, pool.stride, static_cast<uint32_t>(blockCount),
+				pool.usage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, properties),
+			LdRangeAllocator{ blockCount } });
+		if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+		{
+			pool.blocks.back().buffer->map();
+		}
+		offset = pool.blocks.back().ranges.allocate(count);
+		return static_cast<uint32_t>(pool.blocks.size() - 1);
+	}
+
+	bool LdGeometryArena::needsCompaction(const Pool& pool) const
+	{
+		uint64_t capacity = 0;
+		uint64_t used = 0;
+		bool holes = pool.blocks.size() > 1;
+		for (const auto& block : pool.blocks)
+		{
+			capacity += block.ranges.getSize();
+			used += block.ranges.getUsed();
+			holes = holes || block.ranges.getFreeRangeCount() > 1;
+		}
+		// ranges waiting for frames in flight count as used until released
+		for (const auto& pending : pendingFrees)
+		{
+			if (pending.pool == &pool)
+			{
+				return false;
+			}
+		}
+		return capacity > 0 && holes && used < capacity * settings.compactionThreshold;
+	}
+
+	void LdGeometryArena::compact(Pool& pool, bool vertices, VkCommandBuffer& commandBuffer, Retired& retiring)
+	{
+		if (commandBuffer == VK_NULL_HANDLE)
+		{
+			if (!spareCommandBuffers.empty())
+			{
+				commandBuffer = spareCommandBuffers.back();
+				spareCommandBuffers.pop_back();
+			}
+			else
+			{
+				VkCommandBufferAllocateInfo allocInfo{};
+				allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+				allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+				allocInfo.commandPool = commandPool;
+				allocInfo.commandBufferCount = 1;
+				if (vkAllocateCommandBuffers(ldDevice.device(), &allocInfo, &commandBuffer) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to allocate geometry compaction command buffer!");
+				}
+			}
+			VkCommandBufferBeginInfo beginInfo{};
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			vkBeginCommandBuffer(commandBuffer, &beginInfo);
+		}
+
+		std::vector<Block> oldBlocks{};
+		oldBlocks.swap(pool.blocks);
+
+		// largest first packs the new blocks tighter
+		std::vector<Allocation*> moving{};
+		for (Allocation* allocation : liveAllocations)
+		{
+			if ((vertices ? &vertexPool(allocation->vertexFormat) : &indexPool(allocation->indexType)) == &pool
+				&& (vertices || allocation->indexCount > 0))
+			{
+				moving.push_back(allocation);
+			}
+		}
+		std::sort(moving.begin(), moving.end(), [vertices](const Allocation* a, const Allocation* b) {
+			return vertices ? a->vertexCount > b->vertexCount : a->indexCount > b->indexCount;
+		});
+
+		for (Allocation* allocation : moving)
+		{
+			uint32_t& block = vertices ? allocation->vertexBlock : allocation->indexBlock;
+			uint32_t& offset = vertices ? allocation->vertexOffset : allocation->firstIndex;
+			uint32_t count = vertices ? allocation->vertexCount : allocation->indexCount;
+
+			uint64_t newOffset = 0;
+			uint32_t newBlock = allocateRange(pool, count, newOffset);
+			VkBufferCopy region{};
+			region.srcOffset = offset * pool.stride;
+			region.dstOffset = newOffset * pool.stride;
+			region.size = count * pool.stride;
+			vkCmdCopyBuffer(commandBuffer, oldBlocks[block].buffer->getBuffer(), pool.blocks[newBlock].buffer->getBuffer(), 1, &region);
+			bytesMoved += region.size;
+
+			block = newBlock;
+			offset = static_cast<uint32_t>(newOffset);
+			(vertices ? allocation->vertexBuffer : allocation->indexBuffer) = pool.blocks[newBlock].buffer->getBuffer();
+		}
+
+		for (auto& old : oldBlocks)
+		{
+			retiring.buffers.push_back(std::move(old.buffer));
+		}
+		compactions++;
+	}
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "ld_buffer.hpp"
+#include "ld_device.hpp"
+#include "ld_model.hpp"
+#include "ld_range_allocator.hpp"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace ld {
+	// where a model's geometry lives in an LdGeometryArena, offsets are in vertices and indices of the pool's type
+	struct LdGeometryAllocation {
+		LdModel::VertexFormat vertexFormat;
+		VkIndexType indexType;
+		VkBuffer vertexBuffer = VK_NULL_HANDLE;
+		VkBuffer indexBuffer = VK_NULL_HANDLE;
+		uint32_t vertexBlock = 0;
+		uint32_t vertexOffset = 0;
+		uint32_t vertexCount = 0;
+		uint32_t indexBlock = 0;
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+		// set once the data has been uploaded, nothing is compacted while an upload is pending
+		std::atomic<bool> ready{ false };
+	};
+
+	// Shared device local vertex and index buffers that models suballocate from, so a whole pass can
+	// bind its geometry once and draw with firstIndex / vertexOffset. Vertices are pooled per
+	// LdModel::VertexFormat since strides differ, indices per index type. Each pool is a list of large
+	// blocks that usually holds a single one.
+	//
+	// Freed ranges are only reused once no frame in flight can read them. When a pool gets sparse,
+	// update() packs the live ranges into fresh blocks on the graphics queue and retires the old ones.
+	//
+	// Blocks are created with LdDevice::staticBufferMemoryProperties(), when that is host visible they
+	// stay mapped and models write their data straight into their ranges.
+	class LdGeometryArena {
+	public:
+		struct Settings {
+			VkDeviceSize vertexBlockSize = 64ull * 1024 * 1024;
+			VkDeviceSize indexBlockSize = 16ull * 1024 * 1024;
+			// pools with holes are compacted once less than this share of their capacity is live
+			float compactionThreshold = 0.5f;
+		};
+
+		using Allocation = LdGeometryAllocation;
+
+		struct Stats {
+			uint32_t allocations = 0;
+			uint32_t blocks = 0;
+			VkDeviceSize capacityBytes = 0;
+			VkDeviceSize usedBytes = 0;
+			uint32_t compactions = 0;
+			VkDeviceSize bytesMoved = 0;
+		};
+
+		explicit LdGeometryArena(LdDevice& device) : LdGeometryArena(device, Settings{}) {}
+		LdGeometryArena(LdDevice& device, Settings settings);
+		~LdGeometryArena();
+
+		LdGeometryArena(const LdGeometryArena&) = delete;
+		LdGeometryArena& operator=(const LdGeometryArena&) = delete;
+
+	private:
+		struct Block {
+			std::unique_ptr<LdBuffer> buffer;
+			LdRangeAllocator ranges;
+		};
+
+		struct Pool {
+			VkDeviceSize stride;
+			VkDeviceSize blockSize;
+			VkBufferUsageFlags usage;
+			std::vector<Block> blocks{};
+		};
+
+		struct PendingFree {
+			Pool* pool;
+			uint32_t block;
+			uint64_t offset;
+			uint64_t count;
+			uint64_t frame;
+		};
+
+		// old blocks and the command buffer that copied out of them, released once the gpu is done
+		struct Retired {
+			uint64_t frame;
+			std::vector<std::unique_ptr<LdBuffer>> buffers{};
+			VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		};
+
+		LdDevice& ldDevice;
+		Settings settings;
+		// compactions are rare, their buffers are reset one at a time as they are begun again
+		VkCommandPool commandPool = VK_NULL_HANDLE;
+		std::vector<VkCommandBuffer> spareCommandBuffers{};
+
+		// allocate() and free() may run on loading threads
+		mutable std::mutex mutex{};
+		std::array<Pool, static_cast<size_t>(LdModel::VertexFormat::Count)> vertexPools{};
+		std::array<Pool, 2> indexPools{};
+		std::unordered_set<Allocation*> liveAllocations{};
+		std::vector<PendingFree> pendingFrees{};
+		std::vector<Retired> retired{};
+		uint64_t frame = 0;
+		uint32_t compactions = 0;
+		VkDeviceSize bytesMoved = 0;
+
+	public:
+		std::unique_ptr<Allocation> allocate(LdModel::VertexFormat vertexFormat, uint32_t vertexCount,
+			VkIndexType indexType, uint32_t indexCount);
+		// the ranges stay reserved until the frames in flight are done, then the caller deletes the allocation
+		void free(Allocation& allocation);
+
+		VkDeviceSize getVertexByteOffset(const Allocation& allocation) const;
+		VkDeviceSize getIndexByteOffset(const Allocation& allocation) const;
+		// where the allocation's data starts in a mapped block, nullptr if it has to be staged
+		void* getMappedVertexData(const Allocation& allocation) const;
+		void* getMappedIndexData(const Allocation& allocation) const;
+
+		// call once per frame before recording, on the render thread
+		void update();
+		Stats getStats() const;
+
+	private:
+		Pool& vertexPool(LdModel::VertexFormat vertexFormat) { return vertexPools[static_cast<size_t>(vertexFormat)]; }
+		Pool& indexPool(VkIndexType indexType) { return indexPools[indexType == VK_INDEX_TYPE_UINT16 ? 0 : 1]; }
+		const Pool& vertexPool(LdModel::VertexFormat vertexFormat) const { return vertexPools[static_cast<size_t>(vertexFormat)]; }
+		const Pool& indexPool(VkIndexType indexType) const { return indexPools[indexType == VK_INDEX_TYPE_UINT16 ? 0 : 1]; }
+
+		// returns the block index and sets offset
+		uint32_t allocateRange(Pool& pool, uint64_t count, uint64_t& offset);
+		bool needsCompaction(const Pool& pool) const;
+		void compact(Pool& pool, bool vertices, VkCommandBuffer& commandBuffer, Retired& retiring);
+	};
+}
@@ -0,0 +1,64 @@
+#include "ld_instance_batcher.hpp"
+
+#include <algorithm>
+
+namespace ld {
+	namespace {
+		constexpr uint32_t NO_BATCH = ~0u;
+	}
+
+	void LdInstanceBatcher::begin()
+	{
+		batches.clear();
+		batchLookup.clear();
+		instances.clear();
+		instanceBatches.clear();
+		ranges.clear();
+	}
+
+	void LdInstanceBatcher::add(LdModel* model, uint32_t lod, const Instance& instance, float depth)
+	{
+		auto inserted = batchLookup.try_emplace(model);
+		if (inserted.second)
+		{
+			inserted.first->second.fill(NO_BATCH);
+		}
+		uint32_t& batch = inserted.first->second[lod];
+		if (batch == NO_BATCH)
+		{
+			batch = static_cast<uint32_t>(batches.size());
+			batches.push_back({ model, lod, 0, 0, 0, 0, depth });
+		}
+		batches[batch].instanceCount++;
+		batches[batch].depth = std::min(batches[batch].depth, depth);
+		instances.push_back(instance);
+		instanceBatches.push_back(batch);
+	}
+
+	void LdInstanceBatcher::addRanges(LdModel* model, const Instance& instance, const std::vector<LdMeshletCuller::DrawRange>& drawRanges, float depth)
+	{
+		uint32_t batch = static_cast<uint32_t>(batches.size());
+		batches.push_back({ model, 0, 0, 1, static_cast<uint32_t>(ranges.size()), static_cast<uint32_t>(drawRanges.size()), depth });
+		ranges.insert(ranges.end(), drawRanges.begin(), drawRanges.end());
+		instances.push_back(instance);
+		instanceBatches.push_back(batch);
+	}
+
+	void LdInstanceBatcher::finish(Instance* destination)
+	{
+		// next free slot of every batch
+		std::vector<uint32_t> cursors(batches.size());
+		uint32_t firstInstance = 0;
+		for (size_t i = 0; i < batches.size(); i++)
+		{
+			batches[i].firstInstance = firstInstance;
+			cursors[i] = firstInstance;
+			firstInstance += batches[i].instanceCount;
+		}
+
+		for (size_t i = 0; i < instances.size(); i++)
+		{
+			destination[cursors[instanceBatches[i]]++] = instances[i];
+		}
+	}
+}
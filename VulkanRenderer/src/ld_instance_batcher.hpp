@@ -0,0 +1,57 @@
+#pragma once
+
+#include "ld_meshlet_culler.hpp"
+#include "ld_model.hpp"
+
+#include <array>
+#include <unordered_map>
+#include <vector>
+
+namespace ld {
+	// Groups the objects of a frame into one instanced draw per model and level of detail. Instances are
+	// collected in any order, finish() counting sorts them so every batch's instances are contiguous and
+	// writes them out, e.g. into the frame allocator for the vertex shader to read by gl_InstanceIndex.
+	// Batches keep the order they were started in, LdRenderQueue orders their draws for recording.
+	class LdInstanceBatcher {
+	public:
+		// std430 layout of the Instance struct in the instanced shaders
+		struct Instance {
+			glm::mat4 modelMatrix{ 1.f };
+			glm::mat4 normalMatrix{ 1.f };
+		};
+
+		struct Batch {
+			LdModel* model;
+			uint32_t lod;
+			// into the array written by finish()
+			uint32_t firstInstance;
+			uint32_t instanceCount;
+			// meshlet culled objects draw these ranges of getRanges() instead of the whole level
+			uint32_t firstRange;
+			uint32_t rangeCount;
+			// nearest depth of the batch's instances
+			float depth;
+		};
+
+	private:
+		std::vector<Batch> batches{};
+		std::unordered_map<const LdModel*, std::array<uint32_t, LdModel::MAX_LODS>> batchLookup{};
+		std::vector<Instance> instances{};
+		std::vector<uint32_t> instanceBatches{};
+		std::vector<LdMeshletCuller::DrawRange> ranges{};
+
+	public:
+		// forgets the last frame, keeps the capacity
+		void begin();
+		// depth only orders the draws, e.g. the distance to the camera
+		void add(LdModel* model, uint32_t lod, const Instance& instance, float depth = 0.f);
+		// a batch of its own that draws ranges of the full detail level, see LdMeshletCuller
+		void addRanges(LdModel* model, const Instance& instance, const std::vector<LdMeshletCuller::DrawRange>& drawRanges, float depth = 0.f);
+		// places the batches one after the other and writes getInstanceCount() instances in batch order to destination
+		void finish(Instance* destination);
+
+		uint32_t getInstanceCount() const { return static_cast<uint32_t>(instances.size()); }
+		const std::vector<Batch>& getBatches() const { return batches; }
+		const std::vector<LdMeshletCuller::DrawRange>& getRanges() const { return ranges; }
+	};
+}
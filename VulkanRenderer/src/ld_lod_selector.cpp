@@ -0,0 +1,48 @@
+#include "ld_lod_selector.hpp"
+
+#include <algorithm>
+
+namespace ld {
+	LdLodSelector::LdLodSelector(Settings settings) : settings{ settings }
+	{
+	}
+
+	void LdLodSelector::begin(const LdCamera& camera)
+	{
+		cameraPosition = camera.getPosition();
+		// projection[1][1] is 1 / tan(fovy / 2), so it maps a unit at distance one to half the viewport
+		pixelsPerUnit = camera.getProjection()[1][1] * settings.viewportHeight * 0.5f;
+	}
+
+	uint32_t LdLodSelector::select(const std::vector<LdModel::Lod>& lods, const glm::vec3& boundsCenter, float boundsRadius,
+		const glm::mat4& modelMatrix) const
+	{
+		if (lods.size() <= 1)
+		{
+			return 0;
+		}
+		uint32_t coarsest = static_cast<uint32_t>(lods.size() - 1);
+		if (settings.forcedLod >= 0)
+		{
+			return std::min(static_cast<uint32_t>(settings.forcedLod), coarsest);
+		}
+
+		float scale = std::max(glm::length(glm::vec3{ modelMatrix[0] }),
+			std::max(glm::length(glm::vec3{ modelMatrix[1] }), glm::length(glm::vec3{ modelMatrix[2] })));
+		glm::vec3 center = glm::vec3{ modelMatrix * glm::vec4{ boundsCenter, 1.f } };
+		// distance to the closest point of the bounds, so large objects refine where the camera is
+		float distance = glm::length(center - cameraPosition) - boundsRadius * scale;
+		if (distance <= 0.f)
+		{
+			return 0;
+		}
+
+		float errorToPixels = scale * pixelsPerUnit / distance;
+		uint32_t lod = 0;
+		while (lod < coarsest && lods[lod + 1].error * errorToPixels <= settings.maxScreenError)
+		{
+			lod++;
+		}
+		return lod;
+	}
+}
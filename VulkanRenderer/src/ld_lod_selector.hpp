@@ -0,0 +1,40 @@
+#pragma once
+
+#include "ld_camera.hpp"
+#include "ld_model.hpp"
+
+#include <vector>
+
+namespace ld {
+	// Picks the coarsest level of detail whose error, projected to the screen at the object's
+	// distance, stays under a pixel threshold.
+	class LdLodSelector {
+	public:
+		struct Settings {
+			// largest error in pixels a coarser level may show, raise it to trade quality for triangles
+			float maxScreenError = 1.f;
+			// height of the render target in pixels, errors are measured against it
+			float viewportHeight = 1080.f;
+			// draws every model at this level (or its coarsest) when not negative
+			int forcedLod = -1;
+		};
+
+		LdLodSelector() : LdLodSelector(Settings{}) {}
+		explicit LdLodSelector(Settings settings);
+
+	private:
+		Settings settings;
+		glm::vec3 cameraPosition{};
+		// pixels covered by one world unit at distance one
+		float pixelsPerUnit = 0.f;
+
+	public:
+		// call once per frame before select()
+		void begin(const LdCamera& camera);
+		uint32_t select(const std::vector<LdModel::Lod>& lods, const glm::vec3& boundsCenter, float boundsRadius,
+			const glm::mat4& modelMatrix) const;
+
+		Settings& getSettings() { return settings; }
+		const Settings& getSettings() const { return settings; }
+	};
+}
@@ -0,0 +1,111 @@
+#include "ld_mapped_file.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ld {
+
+#ifdef _WIN32
+	LdMappedFile::LdMappedFile(const std::string& filepath)
+	{
+		HANDLE file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return;
+		}
+		fileHandle = file;
+
+		LARGE_INTEGER size{};
+		if (!GetFileSizeEx(file, &size))
+		{
+			close();
+			return;
+		}
+		fileSize = static_cast<size_t>(size.QuadPart);
+
+		// zero length files cannot be mapped, but are still valid files
+		if (fileSize > 0)
+		{
+			mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mappingHandle == nullptr)
+			{
+				close();
+				return;
+			}
+			mapped = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+			if (mapped == nullptr)
+			{
+				close();
+				return;
+			}
+		}
+		opened = true;
+	}
+
+	void LdMappedFile::close()
+	{
+		if (mapped) UnmapViewOfFile(mapped);
+		if (mappingHandle) CloseHandle(mappingHandle);
+		if (fileHandle) CloseHandle(fileHandle);
+		mapped = nullptr;
+		mappingHandle = nullptr;
+		fileHandle = nullptr;
+		fileSize = 0;
+		opened = false;
+	}
+#else
+	LdMappedFile::LdMappedFile(const std::string& filepath)
+	{
+		fileDescriptor = ::open(filepath.c_str(), O_RDONLY);
+		if (fileDescriptor < 0)
+		{
+			return;
+		}
+
+		struct stat info {};
+		if (fstat(fileDescriptor, &info) != 0)
+		{
+			close();
+			return;
+		}
+		fileSize = static_cast<size_t>(info.st_size);
+
+		if (fileSize > 0)
+		{
+			void* view = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+			if (view == MAP_FAILED)
+			{
+				close();
+				return;
+			}
+			madvise(view, fileSize, MADV_SEQUENTIAL);
+			mapped = static_cast<const char*>(view);
+		}
+		opened = true;
+	}
+
+	void LdMappedFile::close()
+	{
+		if (mapped) munmap(const_cast<char*>(mapped), fileSize);
+		if (fileDescriptor >= 0) ::close(fileDescriptor);
+		mapped = nullptr;
+		fileDescriptor = -1;
+		fileSize = 0;
+		opened = false;
+	}
+#endif
+
+	LdMappedFile::~LdMappedFile()
+	{
+		close();
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace ld {
+	// Read-only memory mapping of a whole file. A missing file leaves the mapping closed
+	// instead of throwing so callers can treat it as a cache miss.
+	class LdMappedFile {
+	public:
+		explicit LdMappedFile(const std::string& filepath);
+		~LdMappedFile();
+
+		LdMappedFile(const LdMappedFile&) = delete;
+		LdMappedFile& operator=(const LdMappedFile&) = delete;
+
+	private:
+		const char* mapped = nullptr;
+		size_t fileSize = 0;
+		bool opened = false;
+
+#ifdef _WIN32
+		void* fileHandle = nullptr;
+		void* mappingHandle = nullptr;
+#else
+		int fileDescriptor = -1;
+#endif
+
+	public:
+		bool isOpen() const { return opened; }
+		const char* data() const { return mapped; }
+		size_t size() const { return fileSize; }
+
+	private:
+		void close();
+	};
+}
@@ -0,0 +1,326 @@
+#include "ld_memory_allocator.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace ld {
+	namespace {
+		// without the extension the budget is a guess, leave room for other processes
+		constexpr double FALLBACK_BUDGET_RATIO = 0.8;
+
+		uint32_t countBits(uint32_t value)
+		{
+			uint32_t count = 0;
+			for (; value; value &= value - 1)
+			{
+				count++;
+			}
+			return count;
+		}
+	}
+
+	LdMemoryAllocator::LdMemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device,
+		PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2, Settings settings)
+		: physicalDevice{ physicalDevice }, device{ device }, getMemoryProperties2{ getMemoryProperties2 }, settings{ settings }
+	{
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+		VkPhysicalDeviceProperties properties{};
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		bufferImageGranularity = properties.limits.bufferImageGranularity;
+
+		heapStats.resize(memoryProperties.memoryHeapCount);
+		for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+		{
+			heapStats[i].heapSize = memoryProperties.memoryHeaps[i].size;
+			heapStats[i].deviceLocal = (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+		}
+
+		pools.resize(memoryProperties.memoryTypeCount * 2);
+		for (uint32_t type = 0; type < memoryProperties.memoryTypeCount; type++)
+		{
+			VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[type].propertyFlags;
+			VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[type].heapIndex].size;
+			bool nonCoherent = (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			for (uint32_t kind = 0; kind < 2; kind++)
+			{
+				Pool& pool = pools[type * 2 + kind];
+				pool.memoryType = type;
+				pool.blockSize = heapSize < 1024ull * 1024 * 1024 ? heapSize / 8 : settings.blockSize;
+				pool.minAlignment = nonCoherent ? properties.limits.nonCoherentAtomSize : 1;
+			}
+		}
+		updateBudget();
+	}
+
+	LdMemoryAllocator::~LdMemoryAllocator()
+	{
+		for (auto& pool : pools)
+		{
+			for (auto& block : pool.blocks)
+			{
+				if (block)
+				{
+					vkFreeMemory(device, block->memory, nullptr);
+				}
+			}
+		}
+	}
+
+	LdMemoryAllocation LdMemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceKind kind,
+		LdMemoryCategory category)
+	{
+		uint32_t memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+		uint32_t heap = memoryProperties.memoryTypes[memoryType].heapIndex;
+
+		std::lock_guard<std::mutex> lock{ mutex };
+		Pool& pool = getPool(memoryType, kind);
+		LdMemoryAllocation allocation{};
+		allocation.memoryType = memoryType;
+		allocation.size = requirements.size;
+		allocation.category = category;
+
+		if (requirements.size >= pool.blockSize / 2)
+		{
+			allocation.memory = allocateDeviceMemory(memoryType, requirements.size, allocation.mapped);
+			heapStats[heap].dedicatedAllocations++;
+			heapStats[heap].dedicatedBytes += requirements.size;
+			heapStats[heap].categoryBytes[static_cast<size_t>(category)] += requirements.size;
+			return allocation;
+		}
+
+		VkDeviceSize alignment = std::max(requirements.alignment, pool.minAlignment);
+		LdTlsfAllocator::Range range{};
+		uint32_t blockIndex = 0;
+		for (; blockIndex < pool.blocks.size(); blockIndex++)
+		{
+			if (pool.blocks[blockIndex] && pool.blocks[blockIndex]->ranges.allocate(requirements.size, alignment, range))
+			{
+				break;
+			}
+		}
+		if (blockIndex == pool.blocks.size())
+		{
+			// reuse the slot of a released block so the indices of the others stay valid
+			auto freeSlot = std::find(pool.blocks.begin(), pool.blocks.end(), nullptr);
+			blockIndex = static_cast<uint32_t>(freeSlot - pool.blocks.begin());
+			if (freeSlot == pool.blocks.end())
+			{
+				pool.blocks.emplace_back();
+			}
+
+			void* mapped = nullptr;
+			VkDeviceMemory memory = allocateDeviceMemory(memoryType, pool.blockSize, mapped);
+			pool.blocks[blockIndex] = std::make_unique<Block>(Block{ memory, mapped, LdTlsfAllocator{ pool.blockSize } });
+			heapStats[heap].blocks++;
+			heapStats[heap].blockBytes += pool.blockSize;
+			pool.blocks[blockIndex]->ranges.allocate(requirements.size, alignment, range);
+		}
+
+		Block& block = *pool.blocks[blockIndex];
+		allocation.memory = block.memory;
+		allocation.offset = range.offset;
+		allocation.mapped = block.mapped ? static_cast<char*>(block.mapped) + range.offset : nullptr;
+		allocation.pool = static_cast<uint32_t>(&pool - pools.data());
+		allocation.block = blockIndex;
+		allocation.node = range.node;
+		heapStats[heap].allocations++;
+		heapStats[heap].allocatedBytes += requirements.size;
+		heapStats[heap].categoryBytes[static_cast<size_t>(category)] += requirements.size;
+		return allocation;
+	}
+
+	void LdMemoryAllocator::free(const LdMemoryAllocation& allocation)
+	{
+		if (allocation.memory == VK_NULL_HANDLE)
+		{
+			return;
+		}
+		uint32_t heap = memoryProperties.memoryTypes[allocation.memoryType].heapIndex;
+
+		std::lock_guard<std::mutex> lock{ mutex };
+		heapStats[heap].categoryBytes[static_cast<size_t>(allocation.category)] -= allocation.size;
+		if (allocation.pool == ~0u)
+		{
+			freeDeviceMemory(allocation.memory, allocation.mapped != nullptr);
+			heapStats[heap].dedicatedAllocations--;
+			heapStats[heap].dedicatedBytes -= allocation.size;
+			return;
+		}
+
+		Pool& pool = pools[allocation.pool];
+		auto& block = pool.blocks[allocation.block];
+		block->ranges.free(allocation.node);
+		heapStats[heap].allocations--;
+		heapStats[heap].allocatedBytes -= allocation.size;
+
+		// keep one empty block around so a pool that drains and refills does not thrash
+		size_t liveBlocks = std::count_if(pool.blocks.begin(), pool.blocks.end(), [](const auto& other) { return other != nullptr; });
+		if (block->ranges.isEmpty() && liveBlocks > 1)
+		{
+			freeDeviceMemory(block->memory, block->mapped != nullptr);
+			block.reset();
+			heapStats[heap].blocks--;
+			heapStats[heap].blockBytes -= pool.blockSize;
+		}
+	}
+
+	void LdMemoryAllocator::createBuffer(const VkBufferCreateInfo& bufferInfo, VkMemoryPropertyFlags properties, LdMemoryCategory category,
+		VkBuffer& buffer, LdMemoryAllocation& allocation)
+	{
+		if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create buffer!");
+		}
+
+		VkMemoryRequirements requirements;
+		vkGetBufferMemoryRequirements(device, buffer, &requirements);
+		allocation = allocate(requirements, properties, ResourceKind::Linear, category);
+		if (vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to bind buffer memory!");
+		}
+	}
+
+	void LdMemoryAllocator::createImage(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, LdMemoryCategory category,
+		VkImage& image, LdMemoryAllocation& allocation)
+	{
+		if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create image!");
+		}
+
+		VkMemoryRequirements requirements;
+		vkGetImageMemoryRequirements(device, image, &requirements);
+		ResourceKind kind = imageInfo.tiling == VK_IMAGE_TILING_LINEAR ? ResourceKind::Linear : ResourceKind::Optimal;
+		allocation = allocate(requirements, properties, kind, category);
+		if (vkBindImageMemory(device, image, allocation.memory, allocation.offset) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to bind image memory!");
+		}
+	}
+
+	uint32_t LdMemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+	{
+		uint32_t best = ~0u;
+		uint32_t bestExtraCount = ~0u;
+		for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+		{
+			VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[i].propertyFlags;
+			if ((typeFilter & (1 << i)) && (flags & properties) == properties)
+			{
+				uint32_t extraCount = countBits(flags & ~properties);
+				if (extraCount < bestExtraCount)
+				{
+					best = i;
+					bestExtraCount = extraCount;
+				}
+			}
+		}
+		if (best == ~0u)
+		{
+			throw std::runtime_error("failed to find suitable memory type!");
+		}
+		return best;
+	}
+
+	void LdMemoryAllocator::updateBudget()
+	{
+		VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+		budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+		if (getMemoryProperties2 != nullptr)
+		{
+			VkPhysicalDeviceMemoryProperties2 properties{};
+			properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+			properties.pNext = &budgetProperties;
+			getMemoryProperties2(physicalDevice, &properties);
+		}
+
+		std::lock_guard<std::mutex> lock{ mutex };
+		for (uint32_t i = 0; i < heapStats.size(); i++)
+		{
+			HeapStats& heap = heapStats[i];
+			if (getMemoryProperties2 != nullptr)
+			{
+				heap.usage = budgetProperties.heapUsage[i];
+				heap.budget = budgetProperties.heapBudget[i];
+			}
+			else
+			{
+				heap.usage = heap.blockBytes + heap.dedicatedBytes;
+				heap.budget = static_cast<VkDeviceSize>(heap.heapSize * FALLBACK_BUDGET_RATIO);
+			}
+		}
+	}
+
+	VkDeviceSize LdMemoryAllocator::getBudgetOvershoot(float usageRatio) const
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		VkDeviceSize overshoot = 0;
+		for (const auto& heap : heapStats)
+		{
+			VkDeviceSize limit = static_cast<VkDeviceSize>(heap.budget * static_cast<double>(usageRatio));
+			if (heap.deviceLocal && heap.usage > limit)
+			{
+				overshoot = std::max(overshoot, heap.usage - limit);
+			}
+		}
+		return overshoot;
+	}
+
+	std::vector<LdMemoryAllocator::HeapStats> LdMemoryAllocator::getHeapStats() const
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		return heapStats;
+	}
+
+	uint32_t LdMemoryAllocator::getDeviceAllocationCount() const
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		return allocationCount;
+	}
+
+	LdMemoryAllocator::Pool& LdMemoryAllocator::getPool(uint32_t memoryType, ResourceKind kind)
+	{
+		// with a granularity of 1 buffers and images can share pages, one pool is enough
+		bool separate = bufferImageGranularity > 1 && kind == ResourceKind::Optimal;
+		return pools[memoryType * 2 + (separate ? 1 : 0)];
+	}
+
+	VkDeviceMemory LdMemoryAllocator::allocateDeviceMemory(uint32_t memoryType, VkDeviceSize size, void*& mapped)
+	{
+		VkMemoryAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = size;
+		allocInfo.memoryTypeIndex = memoryType;
+
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to allocate device memory!");
+		}
+		allocationCount++;
+
+		mapped = nullptr;
+		if (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+		{
+			// mapped once for good, the ranges inside can not be mapped one by one
+			if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+			{
+				vkFreeMemory(device, memory, nullptr);
+				allocationCount--;
+				throw std::runtime_error("failed to map device memory!");
+			}
+		}
+		return memory;
+	}
+
+	void LdMemoryAllocator::freeDeviceMemory(VkDeviceMemory memory, bool mapped)
+	{
+		if (mapped)
+		{
+			vkUnmapMemory(device, memory);
+		}
+		vkFreeMemory(device, memory, nullptr);
+		allocationCount--;
+	}
+}
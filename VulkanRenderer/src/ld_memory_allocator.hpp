@@ -0,0 +1,134 @@
+#pragma once
+
+#include "ld_tlsf_allocator.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ld {
+	// what an allocation is used for, only for accounting
+	enum class LdMemoryCategory { Geometry, Staging, Uniforms, Attachments, Other, Count };
+
+	// a range of device memory handed out by LdMemoryAllocator
+	struct LdMemoryAllocation {
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+		// host visible memory stays mapped for its whole life, this points at offset
+		void* mapped = nullptr;
+		uint32_t memoryType = 0;
+		LdMemoryCategory category = LdMemoryCategory::Other;
+		// dedicated allocations have no pool
+		uint32_t pool = ~0u;
+		uint32_t block = 0;
+		uint32_t node = LdTlsfAllocator::INVALID_NODE;
+	};
+
+	// Keeps large device memory blocks per memory type and suballocates buffers and images from them with
+	// LdTlsfAllocator, so a scene needs a handful of vkAllocateMemory calls instead of one per resource.
+	// Linear (buffers) and optimal (images) resources use separate blocks whenever the device has a
+	// bufferImageGranularity above 1, so neighbouring ranges never have to be checked for it. Resources
+	// of half a block or more get a dedicated allocation. Thread safe.
+	//
+	// Every allocation is accounted per heap and LdMemoryCategory. With VK_EXT_memory_budget the heap
+	// usage and budget come from the driver and include other processes, otherwise usage is what this
+	// allocator holds and the budget a share of the heap size.
+	class LdMemoryAllocator {
+	public:
+		enum class ResourceKind { Linear, Optimal };
+
+		struct Settings {
+			// heaps smaller than 1 GiB use an eighth of their size instead
+			VkDeviceSize blockSize = 64ull * 1024 * 1024;
+		};
+
+		struct HeapStats {
+			VkDeviceSize heapSize = 0;
+			bool deviceLocal = false;
+			uint32_t blocks = 0;
+			VkDeviceSize blockBytes = 0;
+			uint32_t allocations = 0;
+			VkDeviceSize allocatedBytes = 0;
+			uint32_t dedicatedAllocations = 0;
+			VkDeviceSize dedicatedBytes = 0;
+			// allocated and dedicated bytes by LdMemoryCategory
+			std::array<VkDeviceSize, static_cast<size_t>(LdMemoryCategory::Count)> categoryBytes{};
+			// as of the last updateBudget()
+			VkDeviceSize usage = 0;
+			VkDeviceSize budget = 0;
+		};
+
+		// getMemoryProperties2 is only set when VK_EXT_memory_budget is enabled on the device
+		LdMemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device, PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2)
+			: LdMemoryAllocator(physicalDevice, device, getMemoryProperties2, Settings{}) {}
+		LdMemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device, PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2,
+			Settings settings);
+		~LdMemoryAllocator();
+
+		LdMemoryAllocator(const LdMemoryAllocator&) = delete;
+		LdMemoryAllocator& operator=(const LdMemoryAllocator&) = delete;
+
+	private:
+		struct Block {
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			void* mapped = nullptr;
+			LdTlsfAllocator ranges;
+		};
+
+		struct Pool {
+			uint32_t memoryType;
+			VkDeviceSize blockSize;
+			// non coherent memory is flushed in whole atoms, so ranges must not share one
+			VkDeviceSize minAlignment;
+			std::vector<std::unique_ptr<Block>> blocks{};
+		};
+
+		VkPhysicalDevice physicalDevice;
+		VkDevice device;
+		PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2;
+		Settings settings;
+		VkPhysicalDeviceMemoryProperties memoryProperties{};
+		VkDeviceSize bufferImageGranularity;
+
+		mutable std::mutex mutex{};
+		// memoryType * 2 + resource kind
+		std::vector<Pool> pools{};
+		std::vector<HeapStats> heapStats{};
+		uint32_t allocationCount = 0;
+
+	public:
+		LdMemoryAllocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceKind kind,
+			LdMemoryCategory category);
+		void free(const LdMemoryAllocation& allocation);
+
+		// create a resource, allocate and bind its memory
+		void createBuffer(const VkBufferCreateInfo& bufferInfo, VkMemoryPropertyFlags properties, LdMemoryCategory category,
+			VkBuffer& buffer, LdMemoryAllocation& allocation);
+		void createImage(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, LdMemoryCategory category,
+			VkImage& image, LdMemoryAllocation& allocation);
+
+		// the matching type with the fewest properties beyond the requested ones, so e.g. staging
+		// buffers do not take host visible device local memory when plain host memory exists
+		uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+		// refreshes heap usage and budget, cheap enough for once per frame
+		void updateBudget();
+		// how far the fullest device local heap is past usageRatio of its budget, 0 if none is
+		VkDeviceSize getBudgetOvershoot(float usageRatio) const;
+		bool hasDriverBudget() const { return getMemoryProperties2 != nullptr; }
+		// one entry per memory heap
+		std::vector<HeapStats> getHeapStats() const;
+		// live vkAllocateMemory calls, blocks and dedicated allocations
+		uint32_t getDeviceAllocationCount() const;
+
+	private:
+		Pool& getPool(uint32_t memoryType, ResourceKind kind);
+		VkDeviceMemory allocateDeviceMemory(uint32_t memoryType, VkDeviceSize size, void*& mapped);
+		void freeDeviceMemory(VkDeviceMemory memory, bool mapped);
+	};
+}
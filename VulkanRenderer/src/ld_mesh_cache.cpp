@@ -0,0 +1,184 @@
+#include "ld_mesh_cache.hpp"
+
+#include "ld_utils.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+namespace ld {
+	namespace {
+		constexpr char MAGIC[4] = { 'L', 'D', 'M', 'S' };
+	}
+
+	static_assert(sizeof(LdMeshCache::Header) == 120, "ldmesh header layout changed, bump FORMAT_VERSION");
+
+	LdMeshCache::LdMeshCache(const std::string& sourcePath, bool optimized)
+		: sourcePath{ sourcePath }, cachePath{ cachePathFor(sourcePath) }, importFlags{ optimized ? IMPORT_OPTIMIZED : 0u }
+	{
+		{
+			LdMappedFile source{ sourcePath };
+			if (!source.isOpen())
+			{
+				return;
+			}
+			sourceHash = hashBytes(source.data(), source.size());
+			sourceSize = source.size();
+		}
+
+		cacheFile = std::make_unique<LdMappedFile>(cachePath);
+		if (cacheFile->isOpen() && cacheFile->size() >= sizeof(Header))
+		{
+			header = reinterpret_cast<const Header*>(cacheFile->data());
+			if (!validate())
+			{
+				header = nullptr;
+			}
+		}
+		if (header == nullptr)
+		{
+			cacheFile.reset();
+		}
+	}
+
+	bool LdMeshCache::validate() const
+	{
+		if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0) return false;
+		if (header->formatVersion != FORMAT_VERSION) return false;
+		if (header->vertexLayoutVersion != LdModel::Vertex::LAYOUT_VERSION) return false;
+		if (header->vertexStride != sizeof(LdModel::Vertex)) return false;
+		if (header->meshletStride != sizeof(LdModel::Meshlet)) return false;
+		if (header->lodStride != sizeof(LdModel::Lod)) return false;
+		if (header->sourceHash != sourceHash || header->sourceSize != sourceSize) return false;
+		if (header->importFlags != importFlags) return false;
+
+		uint64_t vertexBytes = static_cast<uint64_t>(header->vertexCount) * sizeof(LdModel::Vertex);
+		uint64_t indexBytes = static_cast<uint64_t>(header->indexCount) * sizeof(uint32_t);
+		uint64_t meshletBytes = static_cast<uint64_t>(header->meshletCount) * sizeof(LdModel::Meshlet);
+		uint64_t lodBytes = static_cast<uint64_t>(header->lodCount) * sizeof(LdModel::Lod);
+		uint64_t fileSize = cacheFile->size();
+		return header->vertexOffset % alignof(LdModel::Vertex) == 0
+			&& header->indexOffset % alignof(uint32_t) == 0
+			&& header->meshletOffset % alignof(LdModel::Meshlet) == 0
+			&& header->lodOffset % alignof(LdModel::Lod) == 0
+			&& header->vertexOffset >= sizeof(Header)
+			&& header->vertexOffset + vertexBytes <= fileSize
+			&& header->indexOffset + indexBytes <= fileSize
+			&& header->meshletOffset + meshletBytes <= fileSize
+			&& header->lodOffset + lodBytes <= fileSize;
+	}
+
+	const LdModel::Vertex* LdMeshCache::getVertices() const
+	{
+		return header ? reinterpret_cast<const LdModel::Vertex*>(cacheFile->data() + header->vertexOffset) : nullptr;
+	}
+
+	const uint32_t* LdMeshCache::getIndices() const
+	{
+		return header ? reinterpret_cast<const uint32_t*>(cacheFile->data() + header->indexOffset) : nullptr;
+	}
+
+	const LdModel::Meshlet* LdMeshCache::getMeshlets() const
+	{
+		return header ? reinterpret_cast<const LdModel::Meshlet*>(cacheFile->data() + header->meshletOffset) : nullptr;
+	}
+
+	const LdModel::Lod* LdMeshCache::getLods() const
+	{
+		return header ? reinterpret_cast<const LdModel::Lod*>(cacheFile->data() + header->lodOffset) : nullptr;
+	}
+
+	LdModel::MeshView LdMeshCache::view() const
+	{
+		LdModel::MeshView mesh{};
+		mesh.vertices = getVertices();
+		mesh.vertexCount = getVertexCount();
+		mesh.indices = getIndices();
+		mesh.indexCount = getIndexCount();
+		mesh.meshlets = getMeshlets();
+		mesh.meshletCount = getMeshletCount();
+		mesh.lods = getLods();
+		mesh.lodCount = getLodCount();
+		return mesh;
+	}
+
+	glm::vec3 LdMeshCache::getBoundsMin() const
+	{
+		return header ? glm::vec3{ header->boundsMin[0], header->boundsMin[1], header->boundsMin[2] } : glm::vec3{ 0.f };
+	}
+
+	glm::vec3 LdMeshCache::getBoundsMax() const
+	{
+		return header ? glm::vec3{ header->boundsMax[0], header->boundsMax[1], header->boundsMax[2] } : glm::vec3{ 0.f };
+	}
+
+	bool LdMeshCache::write(const LdModel::Builder& builder) const
+	{
+		if (sourceSize == 0 && sourceHash == 0)
+		{
+			return false;
+		}
+
+		Header out{};
+		std::memcpy(out.magic, MAGIC, sizeof(MAGIC));
+		out.formatVersion = FORMAT_VERSION;
+		out.vertexLayoutVersion = LdModel::Vertex::LAYOUT_VERSION;
+		out.vertexStride = sizeof(LdModel::Vertex);
+		out.sourceHash = sourceHash;
+		out.sourceSize = sourceSize;
+		out.vertexCount = static_cast<uint32_t>(builder.vertices.size());
+		out.indexCount = static_cast<uint32_t>(builder.indices.size());
+		out.meshletCount = static_cast<uint32_t>(builder.meshlets.size());
+		out.meshletStride = sizeof(LdModel::Meshlet);
+		out.lodCount = static_cast<uint32_t>(builder.lods.size());
+		out.lodStride = sizeof(LdModel::Lod);
+		out.importFlags = importFlags;
+
+		glm::vec3 boundsMin{ std::numeric_limits<float>::max() };
+		glm::vec3 boundsMax{ std::numeric_limits<float>::lowest() };
+		for (const auto& vertex : builder.vertices)
+		{
+			boundsMin = glm::min(boundsMin, vertex.position);
+			boundsMax = glm::max(boundsMax, vertex.position);
+		}
+		if (builder.vertices.empty())
+		{
+			boundsMin = boundsMax = glm::vec3{ 0.f };
+		}
+		for (int i = 0; i < 3; i++)
+		{
+			out.boundsMin[i] = boundsMin[i];
+			out.boundsMax[i] = boundsMax[i];
+		}
+
+		out.vertexOffset = sizeof(Header);
+		out.indexOffset = out.vertexOffset + static_cast<uint64_t>(out.vertexCount) * sizeof(LdModel::Vertex);
+		out.meshletOffset = out.indexOffset + static_cast<uint64_t>(out.indexCount) * sizeof(uint32_t);
+		out.lodOffset = out.meshletOffset + static_cast<uint64_t>(out.meshletCount) * sizeof(LdModel::Meshlet);
+
+		// write to a temporary and swap it in, so a crash never leaves a half written cache behind
+		std::string tempPath = cachePath + ".tmp";
+		{
+			std::ofstream file{ tempPath, std::ios::binary | std::ios::trunc };
+			if (!file.is_open())
+			{
+				return false;
+			}
+			file.write(reinterpret_cast<const char*>(&out), sizeof(out));
+			file.write(reinterpret_cast<const char*>(builder.vertices.data()), builder.vertices.size() * sizeof(LdModel::Vertex));
+			file.write(reinterpret_cast<const char*>(builder.indices.data()), builder.indices.size() * sizeof(uint32_t));
+			file.write(reinterpret_cast<const char*>(builder.meshlets.data()), builder.meshlets.size() * sizeof(LdModel::Meshlet));
+			file.write(reinterpret_cast<const char*>(builder.lods.data()), builder.lods.size() * sizeof(LdModel::Lod));
+			if (!file.good())
+			{
+				file.close();
+				std::remove(tempPath.c_str());
+				return false;
+			}
+		}
+
+		std::remove(cachePath.c_str());
+		return std::rename(tempPath.c_str(), cachePath.c_str()) == 0;
+	}
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "ld_mapped_file.hpp"
+#include "ld_model.hpp"
+
+#include <memory>
+#include <string>
+
+namespace ld {
+	// Binary cache of an imported mesh, stored next to the source as <source>.ldmesh.
+	// Holds the final deduplicated vertex and index arrays so later loads can map the file and
+	// upload straight from it. A cache is only used if the source hash and vertex layout match.
+	class LdMeshCache {
+	public:
+		// 2: meshes are stored after LdModel::Builder::optimize()
+		// 3: meshlets follow the indices
+		// 4: lods follow the meshlets, indices hold every level
+		// 5: importFlags records the optional import steps that ran
+		static constexpr uint32_t FORMAT_VERSION = 5;
+
+		// importFlags bits
+		static constexpr uint32_t IMPORT_OPTIMIZED = 1;
+
+		struct Header {
+			char magic[4];
+			uint32_t formatVersion;
+			uint32_t vertexLayoutVersion;
+			uint32_t vertexStride;
+			uint64_t sourceHash;
+			uint64_t sourceSize;
+			uint32_t vertexCount;
+			uint32_t indexCount;
+			float boundsMin[3];
+			float boundsMax[3];
+			uint64_t vertexOffset;
+			uint64_t indexOffset;
+			uint32_t meshletCount;
+			uint32_t meshletStride;
+			uint64_t meshletOffset;
+			uint32_t lodCount;
+			uint32_t lodStride;
+			uint64_t lodOffset;
+			uint32_t importFlags;
+			uint32_t reserved;
+		};
+
+		// optimized tells whether the mesh is expected after LdModel::Builder::optimize(), a cache written
+		// otherwise is rejected
+		explicit LdMeshCache(const std::string& sourcePath, bool optimized = true);
+
+		LdMeshCache(const LdMeshCache&) = delete;
+		LdMeshCache& operator=(const LdMeshCache&) = delete;
+
+	private:
+		std::string sourcePath;
+		std::string cachePath;
+		uint64_t sourceHash = 0;
+		uint64_t sourceSize = 0;
+		uint32_t importFlags = 0;
+
+		std::unique_ptr<LdMappedFile> cacheFile;
+		const Header* header = nullptr;
+
+	public:
+		bool isValid() const { return header != nullptr; }
+		const std::string& getCachePath() const { return cachePath; }
+
+		const LdModel::Vertex* getVertices() const;
+		uint32_t getVertexCount() const { return header ? header->vertexCount : 0; }
+		const uint32_t* getIndices() const;
+		uint32_t getIndexCount() const { return header ? header->indexCount : 0; }
+		const LdModel::Meshlet* getMeshlets() const;
+		uint32_t getMeshletCount() const { return header ? header->meshletCount : 0; }
+		const LdModel::Lod* getLods() const;
+		uint32_t getLodCount() const { return header ? header->lodCount : 0; }
+		LdModel::MeshView view() const;
+		glm::vec3 getBoundsMin() const;
+		glm::vec3 getBoundsMax() const;
+
+		// writes the builder's data for the current source, returns false if the cache could not be written
+		bool write(const LdModel::Builder& builder) const;
+
+		static std::string cachePathFor(const std::string& sourcePath) { return sourcePath + ".ldmesh"; }
+
+	private:
+		bool validate() const;
+	};
+}
@@ -0,0 +1,416 @@
+#include "ld_mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace ld {
+	namespace {
+		// FIFO cache simulation, a vertex counts as cached until cacheSize later misses pushed it out
+		class FifoCache {
+		public:
+			FifoCache(size_t vertexCount, uint32_t cacheSize) : timestamps(vertexCount, 0), cacheSize{ cacheSize }, timestamp{ cacheSize + 1 } {}
+
+			// returns the number of misses for one triangle
+			uint32_t access(const uint32_t* triangle)
+			{
+				uint32_t misses = 0;
+				for (int k = 0; k < 3; k++)
+				{
+					uint32_t vertex = triangle[k];
+					if (timestamp - timestamps[vertex] > cacheSize)
+					{
+						timestamps[vertex] = timestamp++;
+						misses++;
+					}
+				}
+				return misses;
+			}
+
+			void flush() { timestamp += cacheSize + 1; }
+
+		private:
+			std::vector<uint32_t> timestamps;
+			uint32_t cacheSize;
+			uint32_t timestamp;
+		};
+
+		// Forsyth's vertex scoring, tabulated. It models a larger LRU cache than the FIFO it is measured against
+		constexpr uint32_t SCORING_CACHE_SIZE = 32;
+		constexpr uint32_t MAX_SCORED_VALENCE = 32;
+
+		struct ForsythScores {
+			float cache[SCORING_CACHE_SIZE];
+			float valence[MAX_SCORED_VALENCE + 1];
+
+			ForsythScores()
+			{
+				const float cacheDecayPower = 1.5f;
+				const float lastTriangleScore = 0.75f;
+				const float valenceBoostScale = 2.f;
+				const float valenceBoostPower = 0.5f;
+
+				for (uint32_t i = 0; i < SCORING_CACHE_SIZE; i++)
+				{
+					// the three vertices of the last triangle get a fixed score so the next triangle does
+					// not simply reuse the same edge, which would make a strip instead of a compact patch
+					cache[i] = i < 3 ? lastTriangleScore : std::pow(1.f - (i - 3) / static_cast<float>(SCORING_CACHE_SIZE - 3), cacheDecayPower);
+				}
+				valence[0] = 0.f;
+				for (uint32_t i = 1; i <= MAX_SCORED_VALENCE; i++)
+				{
+					valence[i] = valenceBoostScale * std::pow(static_cast<float>(i), -valenceBoostPower);
+				}
+			}
+
+			float score(int32_t cachePosition, uint32_t remaining) const
+			{
+				if (remaining == 0)
+				{
+					return -1.f;
+				}
+				float result = valence[std::min(remaining, MAX_SCORED_VALENCE)];
+				if (cachePosition >= 0)
+				{
+					result += cache[cachePosition];
+				}
+				return result;
+			}
+		};
+
+		glm::vec3 triangleCross(const std::vector<LdModel::Vertex>& vertices, const uint32_t* triangle)
+		{
+			const glm::vec3& a = vertices[triangle[0]].position;
+			const glm::vec3& b = vertices[triangle[1]].position;
+			const glm::vec3& c = vertices[triangle[2]].position;
+			return glm::cross(b - a, c - a);
+		}
+
+		glm::vec3 triangleCentroid(const std::vector<LdModel::Vertex>& vertices, const uint32_t* triangle)
+		{
+			return (vertices[triangle[0]].position + vertices[triangle[1]].position + vertices[triangle[2]].position) / 3.f;
+		}
+	}
+
+	LdMeshOptimizer::LdMeshOptimizer(Settings settings) : settings{ settings }
+	{
+	}
+
+	void LdMeshOptimizer::optimize(std::vector<LdModel::Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		stats = Stats{};
+		if (indices.empty())
+		{
+			return;
+		}
+		stats.before = analyzeVertexCache(indices, vertices.size(), settings.simulatedCacheSize);
+
+		optimizeVertexCache(indices, vertices.size());
+		if (settings.optimizeOverdraw)
+		{
+			stats.clusterCount = optimizeOverdraw(indices, vertices, settings.simulatedCacheSize, settings.overdrawThreshold);
+		}
+		if (settings.optimizeVertexFetch)
+		{
+			optimizeVertexFetch(vertices, indices);
+		}
+
+		stats.after = analyzeVertexCache(indices, vertices.size(), settings.simulatedCacheSize);
+		stats.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	LdMeshOptimizer::CacheStats LdMeshOptimizer::analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+	{
+		CacheStats result{};
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0)
+		{
+			return result;
+		}
+
+		FifoCache cache{ vertexCount, cacheSize };
+		std::vector<bool> referenced(vertexCount, false);
+		size_t misses = 0;
+		size_t referencedCount = 0;
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			misses += cache.access(&indices[t * 3]);
+			for (int k = 0; k < 3; k++)
+			{
+				if (!referenced[indices[t * 3 + k]])
+				{
+					referenced[indices[t * 3 + k]] = true;
+					referencedCount++;
+				}
+			}
+		}
+
+		result.acmr = static_cast<float>(misses) / triangleCount;
+		result.atvr = static_cast<float>(misses) / referencedCount;
+		return result;
+	}
+
+	void LdMeshOptimizer::optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount)
+	{
+		static const ForsythScores scores{};
+
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0)
+		{
+			return;
+		}
+
+		// per-vertex list of triangles that still have to be emitted, the first
+		// remaining[v] entries of a vertex's range are the live ones
+		std::vector<uint32_t> remaining(vertexCount, 0);
+		for (uint32_t index : indices)
+		{
+			remaining[index]++;
+		}
+		std::vector<uint32_t> offsets(vertexCount + 1, 0);
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			offsets[v + 1] = offsets[v] + remaining[v];
+		}
+		std::vector<uint32_t> adjacency(indices.size());
+		{
+			std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); i++)
+			{
+				adjacency[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+			}
+		}
+
+		std::vector<int32_t> cachePosition(vertexCount, -1);
+		std::vector<float> vertexScore(vertexCount);
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			vertexScore[v] = scores.score(-1, remaining[v]);
+		}
+		std::vector<float> triangleScore(triangleCount);
+		std::vector<bool> emitted(triangleCount, false);
+		uint32_t best = 0;
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+			if (triangleScore[t] > triangleScore[best])
+			{
+				best = static_cast<uint32_t>(t);
+			}
+		}
+
+		std::vector<uint32_t> result{};
+		result.reserve(indices.size());
+		uint32_t cache[SCORING_CACHE_SIZE + 3];
+		uint32_t cacheCount = 0;
+		size_t deadEndCursor = 0;
+
+		while (result.size() < indices.size())
+		{
+			const uint32_t* triangle = &indices[best * 3];
+			emitted[best] = true;
+			result.insert(result.end(), triangle, triangle + 3);
+
+			for (int k = 0; k < 3; k++)
+			{
+				uint32_t vertex = triangle[k];
+				uint32_t* begin = &adjacency[offsets[vertex]];
+				uint32_t* end = begin + remaining[vertex];
+				*std::find(begin, end, best) = *(end - 1);
+				remaining[vertex]--;
+			}
+
+			// LRU update, the emitted triangle's vertices move to the front
+			uint32_t newCache[SCORING_CACHE_SIZE + 3];
+			uint32_t newCount = 0;
+			for (int k = 0; k < 3; k++)
+			{
+				newCache[newCount++] = triangle[k];
+			}
+			for (uint32_t i = 0; i < cacheCount; i++)
+			{
+				uint32_t vertex = cache[i];
+				if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+				{
+					newCache[newCount++] = vertex;
+				}
+			}
+
+			for (uint32_t i = 0; i < newCount; i++)
+			{
+				uint32_t vertex = newCache[i];
+				cachePosition[vertex] = i < SCORING_CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+				vertexScore[vertex] = scores.score(cachePosition[vertex], remaining[vertex]);
+			}
+
+			// only triangles touching the cache are candidates, everything else keeps its score
+			float bestScore = -1.f;
+			bool found = false;
+			for (uint32_t i = 0; i < newCount; i++)
+			{
+				uint32_t vertex = newCache[i];
+				for (uint32_t a = offsets[vertex]; a < offsets[vertex] + remaining[vertex]; a++)
+				{
+					uint32_t t = adjacency[a];
+					float score = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+					triangleScore[t] = score;
+					if (i < SCORING_CACHE_SIZE && score > bestScore)
+					{
+						bestScore = score;
+						best = t;
+						found = true;
+					}
+				}
+			}
+
+			cacheCount = std::min(newCount, SCORING_CACHE_SIZE);
+			std::copy(newCache, newCache + cacheCount, cache);
+
+			if (!found)
+			{
+				// dead end, continue with the next unemitted triangle in input order
+				while (deadEndCursor < triangleCount && emitted[deadEndCursor])
+				{
+					deadEndCursor++;
+				}
+				best = static_cast<uint32_t>(deadEndCursor);
+			}
+		}
+
+		indices.swap(result);
+	}
+
+	uint32_t LdMeshOptimizer::optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<LdModel::Vertex>& vertices,
+		uint32_t cacheSize, float threshold)
+	{
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0)
+		{
+			return 0;
+		}
+
+		// hard boundaries: triangles that miss on all three vertices start a new strip of the cache order
+		std::vector<uint32_t> hardBoundaries{};
+		{
+			FifoCache cache{ vertices.size(), cacheSize };
+			for (size_t t = 0; t < triangleCount; t++)
+			{
+				if (cache.access(&indices[t * 3]) == 3)
+				{
+					hardBoundaries.push_back(static_cast<uint32_t>(t));
+				}
+			}
+			hardBoundaries.push_back(static_cast<uint32_t>(triangleCount));
+		}
+
+		// soft boundaries: split hard clusters as soon as a prefix reaches the cluster's ACMR within the
+		// threshold, so clusters stay small enough to sort without costing much cache efficiency
+		std::vector<uint32_t> clusters{};
+		FifoCache cache{ vertices.size(), cacheSize };
+		for (size_t h = 0; h + 1 < hardBoundaries.size(); h++)
+		{
+			uint32_t start = hardBoundaries[h];
+			uint32_t end = hardBoundaries[h + 1];
+
+			cache.flush();
+			uint32_t clusterMisses = 0;
+			for (uint32_t t = start; t < end; t++)
+			{
+				clusterMisses += cache.access(&indices[t * 3]);
+			}
+			float clusterThreshold = threshold * clusterMisses / static_cast<float>(end - start);
+
+			clusters.push_back(start);
+			cache.flush();
+			uint32_t runningMisses = 0;
+			uint32_t runningTriangles = 0;
+			for (uint32_t t = start; t < end; t++)
+			{
+				runningMisses += cache.access(&indices[t * 3]);
+				runningTriangles++;
+				if (runningMisses / static_cast<float>(runningTriangles) <= clusterThreshold)
+				{
+					clusters.push_back(t + 1);
+					cache.flush();
+					runningMisses = 0;
+					runningTriangles = 0;
+				}
+			}
+
+			// the tail after the last split is usually a poor cluster on its own, merge it into the previous one
+			if (clusters.back() != start)
+			{
+				clusters.pop_back();
+			}
+		}
+		uint32_t clusterCount = static_cast<uint32_t>(clusters.size());
+		clusters.push_back(static_cast<uint32_t>(triangleCount));
+
+		// area weighted centroid of the whole mesh
+		glm::vec3 meshCentroid{ 0.f };
+		float meshArea = 0.f;
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			float area = glm::length(triangleCross(vertices, &indices[t * 3]));
+			meshCentroid += triangleCentroid(vertices, &indices[t * 3]) * area;
+			meshArea += area;
+		}
+		meshCentroid = meshArea > 0.f ? meshCentroid / meshArea : glm::vec3{ 0.f };
+
+		// clusters facing away from the center are likely to occlude the rest, draw them first
+		std::vector<float> sortKeys(clusterCount);
+		for (uint32_t c = 0; c < clusterCount; c++)
+		{
+			glm::vec3 centroid{ 0.f };
+			glm::vec3 normal{ 0.f };
+			float area = 0.f;
+			for (uint32_t t = clusters[c]; t < clusters[c + 1]; t++)
+			{
+				glm::vec3 cross = triangleCross(vertices, &indices[t * 3]);
+				float triangleArea = glm::length(cross);
+				centroid += triangleCentroid(vertices, &indices[t * 3]) * triangleArea;
+				normal += cross;
+				area += triangleArea;
+			}
+			centroid = area > 0.f ? centroid / area : centroid;
+			float normalLength = glm::length(normal);
+			normal = normalLength > 0.f ? normal / normalLength : normal;
+			sortKeys[c] = glm::dot(centroid - meshCentroid, normal);
+		}
+
+		std::vector<uint32_t> order(clusterCount);
+		for (uint32_t c = 0; c < clusterCount; c++)
+		{
+			order[c] = c;
+		}
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+		std::vector<uint32_t> result{};
+		result.reserve(indices.size());
+		for (uint32_t c : order)
+		{
+			result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+		}
+		indices.swap(result);
+		return clusterCount;
+	}
+
+	void LdMeshOptimizer::optimizeVertexFetch(std::vector<LdModel::Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		const uint32_t unused = ~0u;
+		std::vector<uint32_t> remap(vertices.size(), unused);
+		std::vector<LdModel::Vertex> result{};
+		result.reserve(vertices.size());
+		for (auto& index : indices)
+		{
+			if (remap[index] == unused)
+			{
+				remap[index] = static_cast<uint32_t>(result.size());
+				result.push_back(vertices[index]);
+			}
+			index = remap[index];
+		}
+		vertices.swap(result);
+	}
+}
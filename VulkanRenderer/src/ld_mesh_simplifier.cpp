@@ -0,0 +1,397 @@
+#include "ld_mesh_simplifier.hpp"
+
+#include "ld_mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace ld {
+	namespace {
+		uint64_t edgeKey(uint32_t a, uint32_t b)
+		{
+			return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+		}
+	}
+
+	void LdMeshSimplifier::Quadric::addPlane(const glm::vec3& normal, float distance, double planeWeight)
+	{
+		double x = normal.x, y = normal.y, z = normal.z, d = distance;
+		a00 += planeWeight * x * x; a01 += planeWeight * x * y; a02 += planeWeight * x * z; a03 += planeWeight * x * d;
+		a11 += planeWeight * y * y; a12 += planeWeight * y * z; a13 += planeWeight * y * d;
+		a22 += planeWeight * z * z; a23 += planeWeight * z * d;
+		a33 += planeWeight * d * d;
+		weight += planeWeight;
+	}
+
+	void LdMeshSimplifier::Quadric::add(const Quadric& other)
+	{
+		a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+		a11 += other.a11; a12 += other.a12; a13 += other.a13;
+		a22 += other.a22; a23 += other.a23;
+		a33 += other.a33;
+		weight += other.weight;
+	}
+
+	double LdMeshSimplifier::Quadric::error(const glm::vec3& position) const
+	{
+		double x = position.x, y = position.y, z = position.z;
+		return a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z + 2.0 * a03 * x
+			+ a11 * y * y + 2.0 * a12 * y * z + 2.0 * a13 * y
+			+ a22 * z * z + 2.0 * a23 * z
+			+ a33;
+	}
+
+	LdMeshSimplifier::LdMeshSimplifier(const std::vector<LdModel::Vertex>& vertices, const std::vector<uint32_t>& indices, Settings settings)
+		: vertices{ vertices }, settings{ settings }, triangles{ indices }
+	{
+		buildGroups();
+		buildQuadrics();
+	}
+
+	float LdMeshSimplifier::simplify(size_t targetIndexCount, float maxError, std::vector<uint32_t>& out)
+	{
+		double costLimit = static_cast<double>(maxError) * maxError;
+		while (triangles.size() > targetIndexCount)
+		{
+			if (collapsePass(targetIndexCount, costLimit) == 0)
+			{
+				break;
+			}
+		}
+		out = triangles;
+		return getError();
+	}
+
+	float LdMeshSimplifier::getError() const
+	{
+		return static_cast<float>(std::sqrt(maxCost));
+	}
+
+	void LdMeshSimplifier::buildLodChain(const std::vector<LdModel::Vertex>& vertices, std::vector<uint32_t>& indices,
+		std::vector<LdModel::Lod>& lods)
+	{
+		lods.clear();
+		lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.f });
+		if (indices.empty() || vertices.empty())
+		{
+			return;
+		}
+
+		glm::vec3 boundsMin{ std::numeric_limits<float>::max() };
+		glm::vec3 boundsMax{ std::numeric_limits<float>::lowest() };
+		for (const auto& vertex : vertices)
+		{
+			boundsMin = glm::min(boundsMin, vertex.position);
+			boundsMax = glm::max(boundsMax, vertex.position);
+		}
+		float maxError = glm::length(boundsMax - boundsMin) * 0.5f * MAX_LOD_ERROR;
+
+		LdMeshSimplifier simplifier{ vertices, indices };
+		std::vector<uint32_t> lodIndices{};
+		while (lods.size() < LdModel::MAX_LODS)
+		{
+			uint32_t previousCount = lods.back().indexCount;
+			float error = simplifier.simplify(previousCount / 6 * 3, maxError, lodIndices);
+			// a level that saves less than a quarter is not worth switching to
+			if (lodIndices.empty() || lodIndices.size() > previousCount * 3 / 4)
+			{
+				break;
+			}
+			LdMeshOptimizer::optimizeVertexCache(lodIndices, vertices.size());
+			lods.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(lodIndices.size()), error });
+			indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+		}
+	}
+
+	void LdMeshSimplifier::buildGroups()
+	{
+		std::vector<uint32_t> order(vertices.size());
+		std::iota(order.begin(), order.end(), 0);
+		auto less = [&](uint32_t a, uint32_t b) {
+			const glm::vec3& pa = vertices[a].position;
+			const glm::vec3& pb = vertices[b].position;
+			if (pa.x != pb.x) return pa.x < pb.x;
+			if (pa.y != pb.y) return pa.y < pb.y;
+			return pa.z < pb.z;
+		};
+		std::sort(order.begin(), order.end(), less);
+
+		vertexGroup.resize(vertices.size());
+		groupVertices = order;
+		groupFirstVertex.clear();
+		groupPositions.clear();
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			if (i == 0 || less(order[i - 1], order[i]))
+			{
+				groupFirstVertex.push_back(static_cast<uint32_t>(i));
+				groupPositions.push_back(vertices[order[i]].position);
+			}
+			vertexGroup[order[i]] = static_cast<uint32_t>(groupPositions.size() - 1);
+		}
+		groupFirstVertex.push_back(static_cast<uint32_t>(order.size()));
+	}
+
+	void LdMeshSimplifier::buildQuadrics()
+	{
+		quadrics.assign(groupPositions.size(), Quadric{});
+
+		std::vector<uint64_t> edges{};
+		edges.reserve(triangles.size());
+		for (size_t i = 0; i < triangles.size(); i += 3)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				edges.push_back(edgeKey(vertexGroup[triangles[i + k]], vertexGroup[triangles[i + (k + 1) % 3]]));
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+		auto isBorder = [&](uint32_t a, uint32_t b) {
+			auto range = std::equal_range(edges.begin(), edges.end(), edgeKey(a, b));
+			return range.second - range.first == 1;
+		};
+
+		for (size_t i = 0; i < triangles.size(); i += 3)
+		{
+			uint32_t groups[3] = { vertexGroup[triangles[i]], vertexGroup[triangles[i + 1]], vertexGroup[triangles[i + 2]] };
+			const glm::vec3& a = groupPositions[groups[0]];
+			glm::vec3 normal = glm::cross(groupPositions[groups[1]] - a, groupPositions[groups[2]] - a);
+			float length = glm::length(normal);
+			if (length <= 0.f)
+			{
+				continue;
+			}
+			normal /= length;
+			double area = length * 0.5;
+			for (int k = 0; k < 3; k++)
+			{
+				quadrics[groups[k]].addPlane(normal, -glm::dot(normal, a), area);
+			}
+
+			// a plane through each open edge, perpendicular to the triangle, keeps the border from shrinking
+			for (int k = 0; k < 3; k++)
+			{
+				uint32_t from = groups[k];
+				uint32_t to = groups[(k + 1) % 3];
+				if (!isBorder(from, to))
+				{
+					continue;
+				}
+				glm::vec3 edge = groupPositions[to] - groupPositions[from];
+				glm::vec3 borderNormal = glm::cross(edge, normal);
+				float borderLength = glm::length(borderNormal);
+				if (borderLength <= 0.f)
+				{
+					continue;
+				}
+				borderNormal /= borderLength;
+				double weight = static_cast<double>(glm::dot(edge, edge)) * settings.borderWeight;
+				float distance = -glm::dot(borderNormal, groupPositions[from]);
+				quadrics[from].addPlane(borderNormal, distance, weight);
+				quadrics[to].addPlane(borderNormal, distance, weight);
+			}
+		}
+	}
+
+	uint32_t LdMeshSimplifier::collapsePass(size_t targetIndexCount, double costLimit)
+	{
+		size_t groupCount = groupPositions.size();
+		size_t triangleCount = triangles.size() / 3;
+
+		// triangles around every group
+		std::vector<uint32_t> adjacencyOffsets(groupCount + 1, 0);
+		std::vector<uint32_t> adjacency(triangleCount * 3);
+		for (uint32_t index : triangles)
+		{
+			adjacencyOffsets[vertexGroup[index] + 1]++;
+		}
+		std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+		{
+			std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (uint32_t t = 0; t < triangleCount; t++)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					adjacency[fill[vertexGroup[triangles[t * 3 + k]]]++] = t;
+				}
+			}
+		}
+
+		std::vector<uint64_t> edges{};
+		edges.reserve(triangles.size());
+		for (size_t i = 0; i < triangles.size(); i += 3)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				edges.push_back(edgeKey(vertexGroup[triangles[i + k]], vertexGroup[triangles[i + (k + 1) % 3]]));
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+
+		std::vector<uint8_t> border(groupCount, 0);
+		for (size_t i = 0; i < edges.size();)
+		{
+			size_t end = i + 1;
+			while (end < edges.size() && edges[end] == edges[i]) end++;
+			if (end - i == 1)
+			{
+				border[edges[i] >> 32] = 1;
+				border[edges[i] & 0xffffffffu] = 1;
+			}
+			i = end;
+		}
+
+		std::vector<Collapse> collapses{};
+		for (size_t i = 0; i < edges.size();)
+		{
+			size_t end = i + 1;
+			while (end < edges.size() && edges[end] == edges[i]) end++;
+			size_t faces = end - i;
+			uint32_t a = static_cast<uint32_t>(edges[i] >> 32);
+			uint32_t b = static_cast<uint32_t>(edges[i] & 0xffffffffu);
+			i = end;
+			if (faces > 2 || a == b)
+			{
+				continue; // non-manifold
+			}
+
+			for (int direction = 0; direction < 2; direction++)
+			{
+				uint32_t from = direction == 0 ? a : b;
+				uint32_t to = direction == 0 ? b : a;
+				// border vertices only slide along the border, seam vertices only onto vertices with as many wedges
+				if (border[from] && faces != 1) continue;
+				if (groupVertexCount(from) > 1 && groupVertexCount(to) < groupVertexCount(from)) continue;
+
+				Quadric quadric = quadrics[from];
+				quadric.add(quadrics[to]);
+				double cost = quadric.weight > 0.0 ? std::max(quadric.error(groupPositions[to]), 0.0) / quadric.weight : 0.0;
+				if (cost <= costLimit)
+				{
+					collapses.push_back({ cost, from, to });
+				}
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+		std::vector<uint8_t> locked(groupCount, 0);
+		std::vector<uint32_t> remap(vertices.size());
+		std::iota(remap.begin(), remap.end(), 0);
+
+		size_t trianglesToRemove = (triangles.size() - std::min(triangles.size(), targetIndexCount) + 2) / 3;
+		size_t trianglesRemoved = 0;
+		uint32_t collapseCount = 0;
+		for (const auto& collapse : collapses)
+		{
+			if (trianglesRemoved >= trianglesToRemove)
+			{
+				break;
+			}
+			if (locked[collapse.from] || locked[collapse.to])
+			{
+				continue;
+			}
+			if (flipsTriangle(collapse.from, collapse.to, adjacencyOffsets, adjacency))
+			{
+				continue;
+			}
+
+			for (uint32_t i = groupFirstVertex[collapse.from]; i < groupFirstVertex[collapse.from + 1]; i++)
+			{
+				remap[groupVertices[i]] = closestVertex(groupVertices[i], collapse.to);
+			}
+			quadrics[collapse.to].add(quadrics[collapse.from]);
+			maxCost = std::max(maxCost, collapse.cost);
+
+			// everything around the moved vertex changes shape, leave it alone until the next pass
+			for (uint32_t i = adjacencyOffsets[collapse.from]; i < adjacencyOffsets[collapse.from + 1]; i++)
+			{
+				const uint32_t* triangle = &triangles[adjacency[i] * 3];
+				for (int k = 0; k < 3; k++)
+				{
+					locked[vertexGroup[triangle[k]]] = 1;
+				}
+			}
+			trianglesRemoved += border[collapse.from] ? 1 : 2;
+			collapseCount++;
+		}
+
+		if (collapseCount == 0)
+		{
+			return 0;
+		}
+
+		size_t kept = 0;
+		for (size_t i = 0; i < triangles.size(); i += 3)
+		{
+			uint32_t a = remap[triangles[i]];
+			uint32_t b = remap[triangles[i + 1]];
+			uint32_t c = remap[triangles[i + 2]];
+			if (vertexGroup[a] == vertexGroup[b] || vertexGroup[b] == vertexGroup[c] || vertexGroup[c] == vertexGroup[a])
+			{
+				continue;
+			}
+			triangles[kept++] = a;
+			triangles[kept++] = b;
+			triangles[kept++] = c;
+		}
+		triangles.resize(kept);
+		return collapseCount;
+	}
+
+	bool LdMeshSimplifier::flipsTriangle(uint32_t from, uint32_t to, const std::vector<uint32_t>& adjacencyOffsets,
+		const std::vector<uint32_t>& adjacency) const
+	{
+		for (uint32_t i = adjacencyOffsets[from]; i < adjacencyOffsets[from + 1]; i++)
+		{
+			const uint32_t* triangle = &triangles[adjacency[i] * 3];
+			uint32_t groups[3] = { vertexGroup[triangle[0]], vertexGroup[triangle[1]], vertexGroup[triangle[2]] };
+			if (groups[0] == to || groups[1] == to || groups[2] == to)
+			{
+				continue; // collapses away
+			}
+
+			glm::vec3 before[3]{};
+			glm::vec3 after[3]{};
+			for (int k = 0; k < 3; k++)
+			{
+				before[k] = groupPositions[groups[k]];
+				after[k] = groups[k] == from ? groupPositions[to] : before[k];
+			}
+			glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+			glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+			float lengthBefore = glm::length(normalBefore);
+			if (lengthBefore <= 0.f)
+			{
+				continue;
+			}
+			if (glm::dot(normalBefore, normalAfter) <= settings.minNormalDot * lengthBefore * glm::length(normalAfter))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	uint32_t LdMeshSimplifier::closestVertex(uint32_t vertex, uint32_t group) const
+	{
+		// on seams pick the wedge whose attributes match best, so uvs and hard edges stay on their side
+		const LdModel::Vertex& source = vertices[vertex];
+		uint32_t best = groupVertices[groupFirstVertex[group]];
+		float bestScore = std::numeric_limits<float>::lowest();
+		for (uint32_t i = groupFirstVertex[group]; i < groupFirstVertex[group + 1]; i++)
+		{
+			const LdModel::Vertex& candidate = vertices[groupVertices[i]];
+			float score = glm::dot(source.normal, candidate.normal)
+				- glm::length(source.uv - candidate.uv) - glm::length(source.color - candidate.color);
+			if (score > bestScore)
+			{
+				bestScore = score;
+				best = groupVertices[i];
+			}
+		}
+		return best;
+	}
+}
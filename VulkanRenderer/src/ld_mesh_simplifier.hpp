@@ -0,0 +1,84 @@
+#pragma once
+
+#include "ld_model.hpp"
+
+#include <vector>
+
+namespace ld {
+	// Quadric error edge collapse (Garland and Heckbert) that only rewrites indices. Every collapse
+	// moves a vertex onto a neighbour that already exists, so all levels of detail can keep using
+	// the original vertex buffer. Vertices sharing a position (uv seams, flat shading) collapse as
+	// one, which keeps the surface closed, and open borders may only slide along themselves.
+	class LdMeshSimplifier {
+	public:
+		struct Settings {
+			// weight of the planes that hold open borders in place, relative to the surface planes
+			float borderWeight = 10.f;
+			// collapses that turn any triangle normal by more than acos(minNormalDot) are rejected
+			float minNormalDot = 0.2f;
+		};
+
+		LdMeshSimplifier(const std::vector<LdModel::Vertex>& vertices, const std::vector<uint32_t>& indices)
+			: LdMeshSimplifier(vertices, indices, Settings{}) {}
+		LdMeshSimplifier(const std::vector<LdModel::Vertex>& vertices, const std::vector<uint32_t>& indices, Settings settings);
+
+		LdMeshSimplifier(const LdMeshSimplifier&) = delete;
+		LdMeshSimplifier& operator=(const LdMeshSimplifier&) = delete;
+
+	private:
+		// symmetric 4x4 error matrix, plus the area it was accumulated from so errors stay distances
+		struct Quadric {
+			double a00, a01, a02, a03, a11, a12, a13, a22, a23, a33;
+			double weight;
+
+			void addPlane(const glm::vec3& normal, float distance, double planeWeight);
+			void add(const Quadric& other);
+			double error(const glm::vec3& position) const;
+		};
+
+		struct Collapse {
+			double cost;
+			uint32_t from;
+			uint32_t to;
+		};
+
+		const std::vector<LdModel::Vertex>& vertices;
+		Settings settings;
+
+		// vertices with identical positions share a position group, collapses happen between groups
+		std::vector<uint32_t> vertexGroup{};
+		std::vector<uint32_t> groupFirstVertex{};
+		std::vector<uint32_t> groupVertices{};
+		std::vector<glm::vec3> groupPositions{};
+		std::vector<Quadric> quadrics{};
+
+		std::vector<uint32_t> triangles{};
+		double maxCost = 0.0;
+
+	public:
+		// keeps collapsing from where the previous call stopped until at most targetIndexCount indices
+		// are left or the next collapse would move the surface by more than maxError, and copies the
+		// result into out. Returns the error of the result in model space units.
+		float simplify(size_t targetIndexCount, float maxError, std::vector<uint32_t>& out);
+
+		size_t getIndexCount() const { return triangles.size(); }
+		float getError() const;
+
+		// Fills lods with up to LdModel::MAX_LODS levels, each about half the triangles of the one before,
+		// and appends their cache optimized indices to indices. Stops once a level would stray further than
+		// MAX_LOD_ERROR times the bounding radius, or stops getting smaller.
+		static void buildLodChain(const std::vector<LdModel::Vertex>& vertices, std::vector<uint32_t>& indices,
+			std::vector<LdModel::Lod>& lods);
+		static constexpr float MAX_LOD_ERROR = 0.1f;
+
+	private:
+		void buildGroups();
+		void buildQuadrics();
+		// one round of independent collapses, returns how many were done
+		uint32_t collapsePass(size_t targetIndexCount, double costLimit);
+		bool flipsTriangle(uint32_t from, uint32_t to, const std::vector<uint32_t>& adjacencyOffsets,
+			const std::vector<uint32_t>& adjacency) const;
+		uint32_t closestVertex(uint32_t vertex, uint32_t group) const;
+		uint32_t groupVertexCount(uint32_t group) const { return groupFirstVertex[group + 1] - groupFirstVertex[group]; }
+	};
+}
@@ -0,0 +1,146 @@
+#include "ld_meshlet_builder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace ld {
+	void LdMeshletBuilder::build(const std::vector<LdModel::Vertex>& vertices, const std::vector<uint32_t>& indices,
+		std::vector<LdModel::Meshlet>& meshlets)
+	{
+		meshlets.clear();
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0)
+		{
+			return;
+		}
+
+		// meshlet that last used each vertex, so counting a triangle's new vertices is O(1)
+		const uint32_t none = ~0u;
+		std::vector<uint32_t> lastMeshlet(vertices.size(), none);
+		uint32_t current = 0;
+		uint32_t firstTriangle = 0;
+		uint32_t meshletVertices = 0;
+
+		auto countNew = [&](const uint32_t* triangle) {
+			uint32_t count = 0;
+			for (int k = 0; k < 3; k++)
+			{
+				bool duplicate = (k > 0 && triangle[k] == triangle[0]) || (k > 1 && triangle[k] == triangle[1]);
+				if (!duplicate && lastMeshlet[triangle[k]] != current)
+				{
+					count++;
+				}
+			}
+			return count;
+		};
+
+		for (uint32_t t = 0; t < triangleCount; t++)
+		{
+			const uint32_t* triangle = &indices[t * 3];
+			uint32_t newVertices = countNew(triangle);
+			if (meshletVertices + newVertices > MAX_VERTICES || t - firstTriangle >= MAX_TRIANGLES)
+			{
+				meshlets.push_back(computeBounds(vertices, indices, firstTriangle * 3, (t - firstTriangle) * 3));
+				current++;
+				firstTriangle = t;
+				meshletVertices = 0;
+				newVertices = countNew(triangle);
+			}
+			for (int k = 0; k < 3; k++)
+			{
+				lastMeshlet[triangle[k]] = current;
+			}
+			meshletVertices += newVertices;
+		}
+		meshlets.push_back(computeBounds(vertices, indices, firstTriangle * 3, static_cast<uint32_t>(triangleCount - firstTriangle) * 3));
+	}
+
+	LdModel::Meshlet LdMeshletBuilder::computeBounds(const std::vector<LdModel::Vertex>& vertices, const std::vector<uint32_t>& indices,
+		uint32_t firstIndex, uint32_t indexCount)
+	{
+		LdModel::Meshlet meshlet{};
+		meshlet.firstIndex = firstIndex;
+		meshlet.indexCount = indexCount;
+
+		// sphere around the box center, loose but cheap and stable
+		glm::vec3 boundsMin{ std::numeric_limits<float>::max() };
+		glm::vec3 boundsMax{ std::numeric_limits<float>::lowest() };
+		for (uint32_t i = firstIndex; i < firstIndex + indexCount; i++)
+		{
+			boundsMin = glm::min(boundsMin, vertices[indices[i]].position);
+			boundsMax = glm::max(boundsMax, vertices[indices[i]].position);
+		}
+		meshlet.center = (boundsMin + boundsMax) * 0.5f;
+		float radiusSquared = 0.f;
+		for (uint32_t i = firstIndex; i < firstIndex + indexCount; i++)
+		{
+			glm::vec3 offset = vertices[indices[i]].position - meshlet.center;
+			radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+		}
+		meshlet.radius = std::sqrt(radiusSquared);
+
+		// normal cone, the axis is the average face normal and the cutoff is set by the widest deviation
+		std::vector<glm::vec3> normals{};
+		normals.reserve(indexCount / 3);
+		glm::vec3 axis{ 0.f };
+		for (uint32_t i = firstIndex; i < firstIndex + indexCount; i += 3)
+		{
+			const glm::vec3& a = vertices[indices[i]].position;
+			const glm::vec3& b = vertices[indices[i + 1]].position;
+			const glm::vec3& c = vertices[indices[i + 2]].position;
+			glm::vec3 normal = glm::cross(b - a, c - a);
+			float length = glm::length(normal);
+			if (length > 0.f)
+			{
+				normals.push_back(normal / length);
+				axis += normal / length;
+			}
+		}
+
+		meshlet.coneApex = meshlet.center;
+		meshlet.coneAxis = glm::vec3{ 0.f, 0.f, 1.f };
+		meshlet.coneCutoff = 1.f;
+		float axisLength = glm::length(axis);
+		if (normals.empty() || axisLength <= 0.f)
+		{
+			return meshlet;
+		}
+		axis /= axisLength;
+
+		float minDot = 1.f;
+		for (const auto& normal : normals)
+		{
+			minDot = std::min(minDot, glm::dot(normal, axis));
+		}
+		// cones wider than ~84 degrees would hardly ever cull, keep them disabled
+		if (minDot <= 0.1f)
+		{
+			meshlet.coneAxis = axis;
+			return meshlet;
+		}
+
+		// move the apex back until every triangle plane is in front of it, so the test stays
+		// conservative for cameras close to the meshlet
+		float maxT = 0.f;
+		uint32_t n = 0;
+		for (uint32_t i = firstIndex; i < firstIndex + indexCount; i += 3)
+		{
+			const glm::vec3& a = vertices[indices[i]].position;
+			const glm::vec3& b = vertices[indices[i + 1]].position;
+			const glm::vec3& c = vertices[indices[i + 2]].position;
+			if (glm::length(glm::cross(b - a, c - a)) <= 0.f)
+			{
+				continue;
+			}
+			const glm::vec3& normal = normals[n++];
+			float t = glm::dot(meshlet.center - a, normal) / glm::dot(axis, normal);
+			maxT = std::max(maxT, t);
+		}
+
+		meshlet.coneApex = meshlet.center - axis * maxT;
+		meshlet.coneAxis = axis;
+		meshlet.coneCutoff = std::sqrt(1.f - minDot * minDot);
+		return meshlet;
+	}
+}
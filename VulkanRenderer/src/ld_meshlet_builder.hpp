@@ -0,0 +1,23 @@
+#pragma once
+
+#include "ld_model.hpp"
+
+#include <vector>
+
+namespace ld {
+	// Splits an indexed triangle list into LdModel::Meshlets. Triangles are taken greedily in index
+	// buffer order, so every meshlet is a contiguous index range and the buffer is left untouched.
+	// Run it after LdMeshOptimizer, whose cache friendly order keeps meshlets spatially compact.
+	class LdMeshletBuilder {
+	public:
+		static constexpr uint32_t MAX_VERTICES = 64;
+		static constexpr uint32_t MAX_TRIANGLES = 124;
+
+		static void build(const std::vector<LdModel::Vertex>& vertices, const std::vector<uint32_t>& indices,
+			std::vector<LdModel::Meshlet>& meshlets);
+
+	private:
+		static LdModel::Meshlet computeBounds(const std::vector<LdModel::Vertex>& vertices, const std::vector<uint32_t>& indices,
+			uint32_t firstIndex, uint32_t indexCount);
+	};
+}
@@ -0,0 +1,73 @@
+#include "ld_meshlet_culler.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ld {
+	void LdMeshletCuller::Stats::add(const Stats& other)
+	{
+		meshlets += other.meshlets;
+		frustumCulled += other.frustumCulled;
+		coneCulled += other.coneCulled;
+		triangles += other.triangles;
+		trianglesDrawn += other.trianglesDrawn;
+		drawCalls += other.drawCalls;
+	}
+
+	void LdMeshletCuller::begin(const LdCamera& camera, bool coneCulling)
+	{
+		frustum = LdFrustum{ camera.getProjection() * camera.getView() };
+		cameraPosition = camera.getPosition();
+		this->coneCulling = coneCulling;
+		stats = Stats{};
+	}
+
+	void LdMeshletCuller::cull(const std::vector<LdModel::Meshlet>& meshlets, const glm::mat4& modelMatrix, std::vector<DrawRange>& ranges)
+	{
+		ranges.clear();
+
+		glm::vec3 axisScale{ glm::length(glm::vec3{ modelMatrix[0] }), glm::length(glm::vec3{ modelMatrix[1] }), glm::length(glm::vec3{ modelMatrix[2] }) };
+		float maxScale = std::max(axisScale.x, std::max(axisScale.y, axisScale.z));
+		float minScale = std::min(axisScale.x, std::min(axisScale.y, axisScale.z));
+		// non-uniform scale bends the cone, only test it when the transform keeps angles
+		bool coneTest = coneCulling && maxScale - minScale <= maxScale * 1e-4f;
+		glm::mat3 rotation{ modelMatrix };
+
+		for (const auto& meshlet : meshlets)
+		{
+			stats.meshlets++;
+			stats.triangles += meshlet.indexCount / 3;
+
+			glm::vec3 center = glm::vec3{ modelMatrix * glm::vec4{ meshlet.center, 1.f } };
+			if (!frustum.intersectsSphere(center, meshlet.radius * maxScale))
+			{
+				stats.frustumCulled++;
+				continue;
+			}
+
+			if (coneTest && meshlet.coneCutoff < 1.f)
+			{
+				glm::vec3 apex = glm::vec3{ modelMatrix * glm::vec4{ meshlet.coneApex, 1.f } };
+				glm::vec3 axis = glm::normalize(rotation * meshlet.coneAxis);
+				glm::vec3 view = apex - cameraPosition;
+				float distance = glm::length(view);
+				if (distance > 0.f && glm::dot(view / distance, axis) > meshlet.coneCutoff)
+				{
+					stats.coneCulled++;
+					continue;
+				}
+			}
+
+			stats.trianglesDrawn += meshlet.indexCount / 3;
+			if (!ranges.empty() && ranges.back().firstIndex + ranges.back().indexCount == meshlet.firstIndex)
+			{
+				ranges.back().indexCount += meshlet.indexCount;
+			}
+			else
+			{
+				ranges.push_back({ meshlet.firstIndex, meshlet.indexCount });
+			}
+		}
+		stats.drawCalls += static_cast<uint32_t>(ranges.size());
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "ld_camera.hpp"
+#include "ld_frustum.hpp"
+#include "ld_model.hpp"
+
+#include <vector>
+
+namespace ld {
+	// Culls a model's meshlets on the cpu against the camera frustum and their normal cones, and
+	// merges the survivors into as few index ranges as possible. It only needs the meshlet data,
+	// so reject rates can be measured without a device. A meshlet whose cone faces away from the camera
+	// is only invisible when back faces are culled, the cone test is for such pipelines only.
+	class LdMeshletCuller {
+	public:
+		struct DrawRange {
+			uint32_t firstIndex;
+			uint32_t indexCount;
+		};
+
+		struct Stats {
+			uint32_t meshlets = 0;
+			uint32_t frustumCulled = 0;
+			uint32_t coneCulled = 0;
+			uint64_t triangles = 0;
+			uint64_t trianglesDrawn = 0;
+			uint32_t drawCalls = 0;
+
+			void add(const Stats& other);
+			float rejectRate() const { return meshlets ? (frustumCulled + coneCulled) / static_cast<float>(meshlets) : 0.f; }
+		};
+
+	private:
+		LdFrustum frustum{};
+		glm::vec3 cameraPosition{};
+		bool coneCulling = false;
+		Stats stats{};
+
+	public:
+		// call once per frame before cull(), resets the statistics. Pass coneCulling only when the
+		// meshlets are drawn with back face culling, otherwise just the frustum is tested.
+		void begin(const LdCamera& camera, bool coneCulling);
+		void cull(const std::vector<LdModel::Meshlet>& meshlets, const glm::mat4& modelMatrix, std::vector<DrawRange>& ranges);
+
+		const Stats& getStats() const { return stats; }
+	};
+}
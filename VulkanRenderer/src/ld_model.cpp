@@ -1,94 +1,366 @@
 #include "ld_model.hpp"
 
+#include "ld_geometry_arena.hpp"
+#include "ld_mesh_cache.hpp"
+#include "ld_mesh_optimizer.hpp"
+#include "ld_mesh_simplifier.hpp"
+#include "ld_meshlet_builder.hpp"
+#include "ld_obj_loader.hpp"
+#include "ld_upload_queue.hpp"
 #include "ld_utils.hpp"
+#include "ld_vertex_packer.hpp"
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/hash.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
 #include <unordered_map>
 
-namespace std {
-	template<>
-	struct hash<ld::LdModel::Vertex> {
-		size_t operator()(ld::LdModel::Vertex const& vertex) const {
-			size_t seed = 0;
-			ld::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
-			return seed;
-		}
-	};
+size_t std::hash<ld::LdModel::Vertex>::operator()(ld::LdModel::Vertex const& vertex) const
+{
+	size_t seed = 0;
+	ld::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
+	return seed;
 }
 
 namespace ld {
-	LdModel::LdModel(LdDevice& device, const LdModel::Builder& builder) : ldDevice{ device }
+	static_assert(sizeof(LdModel::PackedVertex) == 20, "PackedVertex must stay tightly packed");
+
+	LdModel::LdModel(LdDevice& device, const LdModel::Builder& builder) : LdModel(device, builder.view(), builder.vertexFormat)
+	{
+	}
+
+	LdModel::LdModel(LdDevice& device, const MeshView& mesh, VertexFormat vertexFormat) : ldDevice{ device }, vertexFormat{ vertexFormat }
+	{
+		create(mesh, nullptr, false);
+	}
+
+	LdModel::LdModel(LdDevice& device, LdGeometryArena* geometryArena) : ldDevice{ device }, geometryArena{ geometryArena }
 	{
-		createVertexBuffers(builder.vertices);
-		createIndexBuffers(builder.indices);
+	}
+
+	void LdModel::create(const MeshView& mesh, LdUploadQueue* uploadQueue, bool occluder)
+	{
+		bounds = mesh.bounds != nullptr ? *mesh.bounds : Bounds::compute(mesh.vertices, mesh.vertexCount);
+		// known up front so the arena can pick the index pool
+		if (mesh.vertexCount <= std::numeric_limits<uint16_t>::max())
+		{
+			indexType = VK_INDEX_TYPE_UINT16;
+		}
+		if (geometryArena != nullptr)
+		{
+			geometry = geometryArena->allocate(vertexFormat, mesh.vertexCount, indexType, mesh.indexCount);
+		}
+		createVertexBuffers(mesh.vertices, mesh.vertexCount, uploadQueue);
+		createIndexBuffers(mesh.indices, mesh.indexCount, uploadQueue);
+		meshlets.assign(mesh.meshlets, mesh.meshlets + mesh.meshletCount);
+		lods.assign(mesh.lods, mesh.lods + mesh.lodCount);
+		if (lods.empty() && hasIndexBuffer)
+		{
+			lods.push_back({ 0, indexCount, 0.f });
+		}
+		if (occluder)
+		{
+			createOccluderMesh(mesh);
+		}
+		if (uploadQueue == nullptr)
+		{
+			markResident();
+		}
 	}
 
 	LdModel::~LdModel()
 	{
+		if (geometry)
+		{
+			geometryArena->free(*geometry);
+		}
+	}
+
+	void LdModel::markResident()
+	{
+		if (geometry)
+		{
+			geometry->ready.store(true, std::memory_order_release);
+		}
+		resident.store(true, std::memory_order_release);
 	}
 
 	void LdModel::bind(VkCommandBuffer commandBuffer)
 	{
-		VkBuffer buffers[] = { vertexBuffer->getBuffer()};
+		// arena ranges are addressed through vertexOffset / firstIndex, so every model binds at 0
+		VkBuffer buffers[] = { getVertexBuffer() };
 		VkDeviceSize offsets[] = { 0 };
 		vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
 		if (hasIndexBuffer)
 		{
-			// optimize for smaller models?
-			vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+			vkCmdBindIndexBuffer(commandBuffer, getIndexBuffer(), 0, indexType);
+		}
+	}
+
+	VkBuffer LdModel::getVertexBuffer() const
+	{
+		if (geometry)
+		{
+			return geometry->vertexBuffer;
 		}
+		return vertexBuffer ? vertexBuffer->getBuffer() : VK_NULL_HANDLE;
 	}
 
-	void LdModel::draw(VkCommandBuffer commandBuffer)
+	VkBuffer LdModel::getIndexBuffer() const
+	{
+		if (geometry)
+		{
+			return geometry->indexBuffer;
+		}
+		return indexBuffer ? indexBuffer->getBuffer() : VK_NULL_HANDLE;
+	}
+
+	int32_t LdModel::baseVertex() const
+	{
+		return geometry ? static_cast<int32_t>(geometry->vertexOffset) : 0;
+	}
+
+	uint32_t LdModel::baseIndex() const
+	{
+		return geometry ? geometry->firstIndex : 0;
+	}
+
+	void LdModel::draw(VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance)
 	{
 		if (hasIndexBuffer)
 		{
-			vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+			// the index buffer may hold coarser levels after the full mesh
+			vkCmdDrawIndexed(commandBuffer, lods[0].indexCount, instanceCount, baseIndex(), baseVertex(), firstInstance);
 		}
 		else {
-			vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+			vkCmdDraw(commandBuffer, vertexCount, instanceCount, static_cast<uint32_t>(baseVertex()), firstInstance);
 		}
 	}
 
-	std::unique_ptr<LdModel> LdModel::createModelFromFile(LdDevice& device, const std::string& filepath)
+	void LdModel::drawRange(VkCommandBuffer commandBuffer, uint32_t firstIndex, uint32_t indexCount,
+		uint32_t instanceCount, uint32_t firstInstance)
 	{
+		assert(hasIndexBuffer && "Ranges can only be drawn from an index buffer");
+		vkCmdDrawIndexed(commandBuffer, indexCount, instanceCount, baseIndex() + firstIndex, baseVertex(), firstInstance);
+	}
+
+	void LdModel::drawLod(VkCommandBuffer commandBuffer, uint32_t lod, uint32_t instanceCount, uint32_t firstInstance)
+	{
+		if (!hasIndexBuffer)
+		{
+			draw(commandBuffer, instanceCount, firstInstance);
+			return;
+		}
+		assert(lod < lods.size() && "Lod out of range");
+		vkCmdDrawIndexed(commandBuffer, lods[lod].indexCount, instanceCount, baseIndex() + lods[lod].firstIndex, baseVertex(), firstInstance);
+	}
+
+	VkDrawIndexedIndirectCommand LdModel::getIndirectCommand(uint32_t lod, uint32_t instanceCount, uint32_t firstInstance) const
+	{
+		assert(hasIndexBuffer && "Indirect commands can only be built for an index buffer");
+		assert(lod < lods.size() && "Lod out of range");
+		VkDrawIndexedIndirectCommand command{};
+		command.indexCount = lods[lod].indexCount;
+		command.instanceCount = instanceCount;
+		command.firstIndex = baseIndex() + lods[lod].firstIndex;
+		command.vertexOffset = baseVertex();
+		command.firstInstance = firstInstance;
+		return command;
+	}
+
+	uint32_t LdModel::getTriangleCount(uint32_t lod) const
+	{
+		return lods.empty() ? vertexCount / 3 : lods[std::min<size_t>(lod, lods.size() - 1)].indexCount / 3;
+	}
+
+	std::unique_ptr<LdModel> LdModel::createModelFromFile(LdDevice& device, const std::string& filepath, VertexFormat vertexFormat)
+	{
+		auto model = std::make_unique<LdModel>(device);
+		model->loadFromFile(filepath, vertexFormat);
+		return model;
+	}
+
+	void LdModel::loadFromFile(const std::string& filepath, VertexFormat vertexFormat, LdUploadQueue* uploadQueue,
+		const ImportSettings& importSettings)
+	{
+		this->vertexFormat = vertexFormat;
+		auto loadStart = std::chrono::high_resolution_clock::now();
+
+		// warm path: upload straight out of the mapped cache file
+		LdMeshCache cache{ filepath, importSettings.optimize };
+		if (cache.isValid())
+		{
+			create(cache.view(), uploadQueue, importSettings.occluder);
+			if (importSettings.verbose)
+			{
+				double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count();
+				std::cout << "loaded " << filepath << " from " << cache.getCachePath() << " (warm): "
+					<< cache.getIndexCount() / 3 << " triangles in " << milliseconds << " ms" << std::endl;
+				logVertexFormat(filepath);
+			}
+			return;
+		}
+
 		Builder builder{};
+		builder.vertexFormat = vertexFormat;
 		builder.loadModel(filepath);
-		return std::make_unique<LdModel>(device, builder);
+		if (importSettings.optimize)
+		{
+			builder.optimize();
+		}
+		builder.buildMeshlets();
+		builder.buildLods();
+		if (!cache.write(builder))
+		{
+			std::cout << "could not write mesh cache " << cache.getCachePath() << std::endl;
+		}
+
+		create(builder.view(), uploadQueue, importSettings.occluder);
+		if (!importSettings.verbose)
+		{
+			return;
+		}
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count();
+
+		const auto& stats = builder.importStats;
+		double seconds = stats.seconds > 0.0 ? stats.seconds : 1e-9;
+		std::cout << "imported " << filepath << " (cold): " << stats.triangleCount << " triangles in " << milliseconds << " ms, "
+			<< stats.fileBytes / (1024.0 * 1024.0) / seconds << " MB/s, "
+			<< stats.triangleCount / seconds / 1e6 << " Mtris/s" << std::endl;
+		if (stats.optimized)
+		{
+			std::cout << "optimized " << filepath << " in " << stats.optimizeSeconds * 1000.0 << " ms: ACMR "
+				<< stats.acmrBefore << " -> " << stats.acmrAfter << ", ATVR " << stats.atvrBefore << " -> " << stats.atvrAfter << std::endl;
+		}
+		std::cout << "meshlets " << filepath << ": " << builder.meshlets.size() << std::endl;
+		std::cout << "lods " << filepath << ":";
+		for (const auto& lod : builder.lods)
+		{
+			std::cout << ' ' << lod.indexCount / 3 << " (" << lod.error << ')';
+		}
+		std::cout << " triangles (error)" << std::endl;
+		logVertexFormat(filepath);
 	}
 
-	void LdModel::createVertexBuffers(const std::vector<Vertex>& vertices)
+	void LdModel::logVertexFormat(const std::string& filepath) const
 	{
-		vertexCount = static_cast<uint32_t>(vertices.size());
-		assert(vertexCount >= 3 && "Vertex count must be at least 3");
-		VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
-		uint32_t vertexSize = sizeof(vertices[0]);
+		if (vertexFormat == VertexFormat::Float32)
+		{
+			return;
+		}
+		std::cout << "packed " << filepath << " as " << vertexFormatName(vertexFormat) << ": "
+			<< sizeof(PackedVertex) << " bytes/vertex (was " << sizeof(Vertex) << "), max error position "
+			<< quantizationError.position << " (" << quantizationError.positionRelative * 100.f << "% of extent), normal "
+			<< quantizationError.normalDegrees << " deg, color " << quantizationError.color
+			<< ", uv " << quantizationError.uv << std::endl;
+	}
 
-		//stage to device memory
-		LdBuffer stagingBuffer{
-			ldDevice,
-			vertexSize,
-			vertexCount,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		};
-		stagingBuffer.map();
-		stagingBuffer.writeToBuffer((void*)vertices.data());
+	LdModel::Bounds LdModel::Bounds::compute(const Vertex* vertices, uint32_t count)
+	{
+		Bounds bounds{};
+		if (count == 0)
+		{
+			return bounds;
+		}
+		bounds.min = glm::vec3{ std::numeric_limits<float>::max() };
+		bounds.max = glm::vec3{ std::numeric_limits<float>::lowest() };
+		for (uint32_t i = 0; i < count; i++)
+		{
+			bounds.min = glm::min(bounds.min, vertices[i].position);
+			bounds.max = glm::max(bounds.max, vertices[i].position);
+		}
+		bounds.center = (bounds.min + bounds.max) * 0.5f;
+		float radiusSquared = 0.f;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			glm::vec3 offset = vertices[i].position - bounds.center;
+			radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+		}
+		bounds.radius = std::sqrt(radiusSquared);
+		return bounds;
+	}
 
-		vertexBuffer = std::make_unique<LdBuffer>(ldDevice, vertexSize, vertexCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	void LdModel::createOccluderMesh(const MeshView& mesh)
+	{
+		if (mesh.indexCount == 0)
+		{
+			if (mesh.vertexCount / 3 > MAX_OCCLUDER_TRIANGLES)
+			{
+				return;
+			}
+			for (uint32_t i = 0; i < mesh.vertexCount; i++)
+			{
+				occluderMesh.positions.push_back(mesh.vertices[i].position);
+				occluderMesh.indices.push_back(i);
+			}
+			return;
+		}
+
+		// only the full mesh is conservative, simplified levels can bulge past its silhouette and
+		// hide objects that are visible
+		uint32_t firstIndex = mesh.lodCount > 0 ? mesh.lods[0].firstIndex : 0;
+		uint32_t count = mesh.lodCount > 0 ? mesh.lods[0].indexCount : mesh.indexCount;
+		if (count / 3 > MAX_OCCLUDER_TRIANGLES)
+		{
+			return;
+		}
+
+		std::unordered_map<uint32_t, uint32_t> remap{};
+		occluderMesh.indices.reserve(count);
+		for (uint32_t i = firstIndex; i < firstIndex + count; i++)
+		{
+			uint32_t index = mesh.indices[i];
+			auto inserted = remap.try_emplace(index, static_cast<uint32_t>(occluderMesh.positions.size()));
+			if (inserted.second)
+			{
+				occluderMesh.positions.push_back(mesh.vertices[index].position);
+			}
+			occluderMesh.indices.push_back(inserted.first->second);
+		}
+	}
 
+	void LdModel::createVertexBuffers(const Vertex* vertices, uint32_t count, LdUploadQueue* uploadQueue)
+	{
+		vertexCount = count;
+		assert(vertexCount >= 3 && "Vertex count must be at least 3");
 
-		ldDevice.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), bufferSize);
+		const void* vertexData = vertices;
+		uint32_t vertexSize = sizeof(Vertex);
+		std::vector<PackedVertex> packedVertices{};
+		if (vertexFormat != VertexFormat::Float32)
+		{
+			LdVertexPacker packer{ vertexFormat };
+			packer.pack(vertices, vertexCount, packedVertices);
+			vertexData = packedVertices.data();
+			vertexSize = sizeof(PackedVertex);
+			positionTransform = packer.getPositionTransform();
+			quantizationError = packer.getError();
+		}
 
+		if (geometry)
+		{
+			uploadBuffer(vertexData, vertexSize, vertexCount, geometry->vertexBuffer, geometryArena->getVertexByteOffset(*geometry),
+				geometryArena->getMappedVertexData(*geometry), uploadQueue);
+			return;
+		}
+		vertexBuffer = std::make_unique<LdBuffer>(ldDevice, vertexSize, vertexCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, ldDevice.staticBufferMemoryProperties());
+		if (vertexBuffer->getMemoryPropertyFlags() & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+		{
+			vertexBuffer->map();
+		}
+		uploadBuffer(vertexData, vertexSize, vertexCount, vertexBuffer->getBuffer(), 0, vertexBuffer->getMappedMemory(), uploadQueue);
 	}
-	void LdModel::createIndexBuffers(const std::vector<uint32_t>& indices)
+
+	void LdModel::createIndexBuffers(const uint32_t* indices, uint32_t count, LdUploadQueue* uploadQueue)
 	{
-		indexCount = static_cast<uint32_t>(indices.size());
+		indexCount = count;
 		hasIndexBuffer = indexCount > 0;
 
 		if (!hasIndexBuffer)
@@ -96,17 +368,78 @@ namespace ld {
 			return;
 		}
 
-		VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
-		uint32_t indexSize = sizeof(indices[0]);
-		LdBuffer stagingBuffer{ ldDevice, indexSize, indexCount, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
+		// create() picked the index type from the vertex count
+		const void* indexData = indices;
+		uint32_t indexSize = sizeof(uint32_t);
+		std::vector<uint16_t> shortIndices{};
+		if (indexType == VK_INDEX_TYPE_UINT16)
+		{
+			shortIndices.assign(indices, indices + indexCount);
+			indexData = shortIndices.data();
+			indexSize = sizeof(uint16_t);
+		}
+
+		if (geometry)
+		{
+			uploadBuffer(indexData, indexSize, indexCount, geometry->indexBuffer, geometryArena->getIndexByteOffset(*geometry),
+				geometryArena->getMappedIndexData(*geometry), uploadQueue);
+			return;
+		}
+		indexBuffer = std::make_unique<LdBuffer>(ldDevice, indexSize, indexCount, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, ldDevice.staticBufferMemoryProperties());
+		if (indexBuffer->getMemoryPropertyFlags() & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+		{
+			indexBuffer->map();
+		}
+		uploadBuffer(indexData, indexSize, indexCount, indexBuffer->getBuffer(), 0, indexBuffer->getMappedMemory(), uploadQueue);
+	}
+
+	void LdModel::uploadBuffer(const void* data, uint32_t instanceSize, uint32_t instanceCount, VkBuffer destination,
+		VkDeviceSize dstOffset, void* mapped, LdUploadQueue* uploadQueue)
+	{
+		VkDeviceSize bufferSize = static_cast<VkDeviceSize>(instanceSize) * instanceCount;
+		if (mapped != nullptr)
+		{
+			// host coherent, the next queue submit makes the write visible to the gpu
+			std::memcpy(mapped, data, static_cast<size_t>(bufferSize));
+			return;
+		}
+		if (uploadQueue != nullptr)
+		{
+			uploadBatch = std::max(uploadBatch, uploadQueue->enqueueBuffer(data, bufferSize, destination, dstOffset));
+			return;
+		}
+
 		//stage to device memory
+		auto stagingBuffer = std::make_unique<LdBuffer>(
+			ldDevice,
+			instanceSize,
+			instanceCount,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+		);
+		stagingBuffer->map();
+		stagingBuffer->writeToBuffer(const_cast<void*>(data));
+		ldDevice.copyBuffer(stagingBuffer->getBuffer(), destination, bufferSize, dstOffset);
+	}
 
-		stagingBuffer.map();
-		stagingBuffer.writeToBuffer((void*)indices.data());
+	VkDeviceSize LdModel::getIndexBufferSize() const
+	{
+		return hasIndexBuffer ? static_cast<VkDeviceSize>(indexCount) * (indexType == VK_INDEX_TYPE_UINT16 ? 2 : 4) : 0;
+	}
 
-		indexBuffer = std::make_unique<LdBuffer>(ldDevice, indexSize, indexCount, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	VkDeviceSize LdModel::getMemorySize() const
+	{
+		if (geometry)
+		{
+			VkDeviceSize vertexSize = vertexFormat == VertexFormat::Float32 ? sizeof(Vertex) : sizeof(PackedVertex);
+			return vertexSize * vertexCount + getIndexBufferSize();
+		}
+		return (vertexBuffer ? vertexBuffer->getBufferSize() : 0) + (indexBuffer ? indexBuffer->getBufferSize() : 0);
+	}
 
-		ldDevice.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), bufferSize);
+	VkDeviceSize LdModel::getIndexBytesSaved() const
+	{
+		return hasIndexBuffer ? static_cast<VkDeviceSize>(indexCount) * 4 - getIndexBufferSize() : 0;
 	}
 
 	std::vector<VkVertexInputBindingDescription> LdModel::Vertex::getBindingDescriptions()
@@ -140,70 +473,89 @@ namespace ld {
 	}
 
 
-	void LdModel::Builder::loadModel(const std::string& filepath)
+	std::vector<VkVertexInputBindingDescription> LdModel::PackedVertex::getBindingDescriptions()
+	{
+		std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+		bindingDescriptions[0].binding = 0;
+		bindingDescriptions[0].stride = sizeof(PackedVertex);
+		bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		return bindingDescriptions;
+	}
+
+	std::vector<VkVertexInputAttributeDescription> LdModel::PackedVertex::getAttributeDescriptions(VertexFormat format)
 	{
-		tinyobj::attrib_t attrib;
-		std::vector<tinyobj::shape_t> shapes;
-		std::vector<tinyobj::material_t> materials;
-		std::string warn, err;
+		assert(format != VertexFormat::Float32 && "Float32 models use Vertex::getAttributeDescriptions");
+		VkFormat positionFormat = format == VertexFormat::Quantized16 ? VK_FORMAT_R16G16B16A16_UNORM : VK_FORMAT_R16G16B16A16_SFLOAT;
 
-		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filepath.c_str()))
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
+		attributeDescriptions.push_back({ 0, 0, positionFormat, offsetof(PackedVertex, position) });
+		attributeDescriptions.push_back({ 1, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(PackedVertex, color) });
+		attributeDescriptions.push_back({ 2, 0, VK_FORMAT_R16G16_SNORM, offsetof(PackedVertex, normal) });
+		attributeDescriptions.push_back({ 3, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(PackedVertex, uv) });
+		return attributeDescriptions;
+	}
+
+	const char* LdModel::vertexFormatName(VertexFormat format)
+	{
+		switch (format)
 		{
-			throw std::runtime_error(warn + err);
+		case VertexFormat::Float32: return "float32";
+		case VertexFormat::Quantized16: return "quantized16";
+		case VertexFormat::Half16: return "half16";
+		default: return "unknown";
 		}
+	}
 
-		vertices.clear();
-		indices.clear();
+	void LdModel::Builder::loadModel(const std::string& filepath)
+	{
+		LdObjLoader loader{};
+		loader.load(filepath, vertices, indices);
+
+		const auto& stats = loader.getStats();
+		importStats.fileBytes = stats.fileBytes;
+		importStats.triangleCount = stats.triangleCount;
+		importStats.seconds = stats.totalSeconds();
+		bounds = Bounds::compute(vertices.data(), static_cast<uint32_t>(vertices.size()));
+	}
+
+	void LdModel::Builder::optimize()
+	{
+		LdMeshOptimizer optimizer{};
+		optimizer.optimize(vertices, indices);
+
+		const auto& stats = optimizer.getStats();
+		importStats.optimized = true;
+		importStats.acmrBefore = stats.before.acmr;
+		importStats.acmrAfter = stats.after.acmr;
+		importStats.atvrBefore = stats.before.atvr;
+		importStats.atvrAfter = stats.after.atvr;
+		importStats.optimizeSeconds = stats.seconds;
+	}
 
-		std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+	void LdModel::Builder::buildMeshlets()
+	{
+		LdMeshletBuilder::build(vertices, indices, meshlets);
+	}
 
+	void LdModel::Builder::buildLods()
+	{
+		LdMeshSimplifier::buildLodChain(vertices, indices, lods);
+	}
 
-		for (const auto& shape : shapes)
-		{
-			for (const auto& index : shape.mesh.indices)
-			{
-				Vertex vertex{};
-				if (index.vertex_index >= 0)
-				{
-					vertex.position =
-					{
-						attrib.vertices[3 * index.vertex_index + 0],
-						attrib.vertices[3 * index.vertex_index + 1],
-						attrib.vertices[3 * index.vertex_index + 2],
-					};
-
-					vertex.color =
-					{
-						attrib.colors[3 * index.vertex_index + 0],
-						attrib.colors[3 * index.vertex_index + 1],
-						attrib.colors[3 * index.vertex_index + 2],
-					};
-
-				}
-				if (index.normal_index >= 0)
-				{
-					vertex.normal =
-					{
-						attrib.normals[3 * index.normal_index + 0],
-						attrib.normals[3 * index.normal_index + 1],
-						attrib.normals[3 * index.normal_index + 2],
-					};
-				}
-				if (index.texcoord_index >= 0)
-				{
-					vertex.uv =
-					{
-						attrib.texcoords[2 * index.texcoord_index + 0],
-						attrib.texcoords[2 * index.texcoord_index + 1],
-					};
-				}
-				if (uniqueVertices.count(vertex) == 0)
-				{
-					uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-					vertices.push_back(vertex);
-				}
-				indices.push_back(uniqueVertices[vertex]);
-			}
-		}
+	LdModel::MeshView LdModel::Builder::view() const
+	{
+		MeshView mesh{};
+		mesh.vertices = vertices.data();
+		mesh.vertexCount = static_cast<uint32_t>(vertices.size());
+		mesh.indices = indices.data();
+		mesh.indexCount = static_cast<uint32_t>(indices.size());
+		mesh.meshlets = meshlets.data();
+		mesh.meshletCount = static_cast<uint32_t>(meshlets.size());
+		mesh.lods = lods.data();
+		mesh.lodCount = static_cast<uint32_t>(lods.size());
+		// left at their defaults by builders filled by hand, create() computes them from the vertices then
+		bool boundsSet = bounds.radius > 0.f || bounds.min != bounds.max || bounds.center != glm::vec3{ 0.f };
+		mesh.bounds = boundsSet ? &bounds : nullptr;
+		return mesh;
 	}
-}
+}
\ No newline at end of file
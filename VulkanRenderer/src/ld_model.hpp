@@ -7,19 +7,38 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
+#include <atomic>
 #include <memory>
 #include <vector>
 
 namespace ld
 {
+	class LdGeometryArena;
+	struct LdGeometryAllocation;
+	class LdUploadQueue;
+
 	class LdModel {
 	public:
 
+		// Layout of the vertex buffer on the GPU. Builders and caches always hold full precision
+		// Vertex data, packing happens on upload. Packed positions are stored relative to the
+		// model bounds and expanded again by getPositionTransform().
+		enum class VertexFormat : uint32_t {
+			Float32,     // Vertex as is, 44 bytes
+			Quantized16, // unorm16 positions, oct16 normals, unorm8 colors, half uvs, 20 bytes
+			Half16,      // half positions, oct16 normals, unorm8 colors, half uvs, 20 bytes
+			Count
+		};
+
 		struct Vertex {
 			glm::vec3 position{};
 			glm::vec3 color{};
 			glm::vec3 normal{};
 			glm::vec2 uv{};
+
+			// bump whenever the members above change so stale mesh caches are rejected
+			static constexpr uint32_t LAYOUT_VERSION = 1;
+
 			static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
 			static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
 
@@ -28,14 +47,134 @@ namespace ld
 			}
 		};
 
+		struct PackedVertex {
+			uint16_t position[4];
+			int16_t normal[2];
+			uint8_t color[4];
+			uint16_t uv[2];
+
+			static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
+			static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions(VertexFormat format);
+		};
+
+		// Contiguous run of triangles in the index buffer with bounds for culling.
+		// Skip it if the camera is outside the frustum, or if
+		// dot(normalize(coneApex - cameraPosition), coneAxis) > coneCutoff, i.e. all triangles face away.
+		struct Meshlet {
+			uint32_t firstIndex;
+			uint32_t indexCount;
+			glm::vec3 center;
+			float radius;
+			glm::vec3 coneApex;
+			glm::vec3 coneAxis;
+			float coneCutoff; // 1 when the triangles face too many directions to ever be cone culled
+		};
+
+		// Range of the index buffer holding one level of detail. Every level indexes the same vertex
+		// buffer, level 0 is the full mesh and error is how far a level strays from it in model units.
+		struct Lod {
+			uint32_t firstIndex;
+			uint32_t indexCount;
+			float error;
+		};
+
+		static constexpr uint32_t MAX_LODS = 6;
+
+		// model space bounds of the vertex positions. The sphere is centered on the box and just reaches
+		// the furthest vertex, which is tighter than the sphere around the box.
+		struct Bounds {
+			glm::vec3 min{ 0.f };
+			glm::vec3 max{ 0.f };
+			glm::vec3 center{ 0.f };
+			float radius = 0.f;
+
+			static Bounds compute(const Vertex* vertices, uint32_t count);
+		};
+
+		// Model space triangles kept on the cpu for software occlusion culling, see LdOcclusionCuller.
+		// The full mesh with only the vertices it uses, only built for models loaded with
+		// ImportSettings::occluder and left empty when it has more than MAX_OCCLUDER_TRIANGLES.
+		struct OccluderMesh {
+			std::vector<glm::vec3> positions{};
+			std::vector<uint32_t> indices{};
+		};
+
+		static constexpr uint32_t MAX_OCCLUDER_TRIANGLES = 512;
+
+		// non-owning view of mesh data, either from a Builder or straight out of a mapped cache file
+		struct MeshView {
+			const Vertex* vertices = nullptr;
+			uint32_t vertexCount = 0;
+			const uint32_t* indices = nullptr;
+			uint32_t indexCount = 0;
+			const Meshlet* meshlets = nullptr;
+			uint32_t meshletCount = 0;
+			const Lod* lods = nullptr;
+			uint32_t lodCount = 0;
+			// computed from the vertices when missing, e.g. for cached meshes
+			const Bounds* bounds = nullptr;
+		};
+
+		// largest difference between the uploaded and the original attributes
+		struct QuantizationError {
+			float position = 0.f;       // model space units
+			float positionRelative = 0.f; // fraction of the largest bounds extent
+			float normalDegrees = 0.f;
+			float color = 0.f;
+			float uv = 0.f;
+		};
+
+		struct ImportStats {
+			size_t fileBytes = 0;
+			size_t triangleCount = 0;
+			double seconds = 0.0;
+
+			// simulated vertex cache efficiency, filled in by optimize()
+			bool optimized = false;
+			float acmrBefore = 0.f;
+			float acmrAfter = 0.f;
+			float atvrBefore = 0.f;
+			float atvrAfter = 0.f;
+			double optimizeSeconds = 0.0;
+		};
+
+		// optional steps of loadFromFile(), meshes imported with different settings are cached apart
+		struct ImportSettings {
+			// reorder for vertex cache, overdraw and fetch efficiency on a cold import, see Builder::optimize()
+			bool optimize = true;
+			// print the import, optimization, lod and packing statistics of every load
+			bool verbose = false;
+			// keep the full mesh as getOccluderMesh(), for models drawn as occluders. Does not affect the cache
+			bool occluder = false;
+		};
+
 		struct Builder {
 			std::vector<Vertex> vertices{};
 			std::vector<uint32_t> indices{};
+			std::vector<Meshlet> meshlets{};
+			std::vector<Lod> lods{};
+			// filled in by loadModel(), the later steps never move a vertex. Left unset, the model computes
+			// them from the vertices, set them again after moving vertices of a loaded mesh
+			Bounds bounds{};
+			ImportStats importStats{};
+			VertexFormat vertexFormat = VertexFormat::Float32;
 
 			void loadModel(const std::string& filepath);
+			// reorders triangles and vertices for vertex cache, overdraw and fetch efficiency
+			void optimize();
+			// splits the index buffer into meshlets, call after optimize() so they stay compact
+			void buildMeshlets();
+			// appends simplified levels of detail to indices, call last as the other steps expect a single level
+			void buildLods();
+
+			MeshView view() const;
 		};
 		
 		LdModel(LdDevice& device, const LdModel::Builder &builder);
+		LdModel(LdDevice& device, const MeshView& mesh, VertexFormat vertexFormat = VertexFormat::Float32);
+		// empty model for loadFromFile(), it does not draw until it is resident. With an arena the
+		// geometry is suballocated from its shared buffers instead of owning a buffer pair.
+		explicit LdModel(LdDevice& device, LdGeometryArena* geometryArena = nullptr);
 		~LdModel();
 
 		LdModel(const LdModel&) = delete;
@@ -44,21 +183,107 @@ namespace ld
 	private:
 		LdDevice& ldDevice;
 
+		LdGeometryArena* geometryArena = nullptr;
+		// set instead of vertexBuffer / indexBuffer when the model lives in geometryArena
+		std::unique_ptr<LdGeometryAllocation> geometry{};
+
 		std::unique_ptr<LdBuffer> vertexBuffer;
-		uint32_t vertexCount;
+		uint32_t vertexCount = 0;
+		VertexFormat vertexFormat = VertexFormat::Float32;
+		glm::mat4 positionTransform{ 1.f };
+		QuantizationError quantizationError{};
 
 		bool hasIndexBuffer = false;
 		std::unique_ptr<LdBuffer> indexBuffer;
-		uint32_t indexCount;
+		uint32_t indexCount = 0;
+		// 16 bit whenever every vertex can be addressed with it, callers always hand in 32 bit indices
+		VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+
+		std::vector<Meshlet> meshlets{};
+		// empty for models without an index buffer
+		std::vector<Lod> lods{};
+		Bounds bounds{};
+		OccluderMesh occluderMesh{};
+
+		// LdUploadQueue batch carrying the last of the model's copies, 0 when uploaded synchronously
+		uint64_t uploadBatch = 0;
+		// set once the buffers hold their data, everything above is written before and only read after
+		std::atomic<bool> resident{ false };
+		// set instead when loading threw, the model never becomes resident
+		std::atomic<bool> failed{ false };
 
 	public:
+		// Loads through the mesh cache, importing and caching the source on a miss. With an upload queue the
+		// copies are only enqueued and the model stays non-resident until the caller sees getUploadBatch()
+		// complete and calls markResident(). Without one every buffer is copied and waited for right away.
+		void loadFromFile(const std::string& filepath, VertexFormat vertexFormat, LdUploadQueue* uploadQueue,
+			const ImportSettings& importSettings);
+		void loadFromFile(const std::string& filepath, VertexFormat vertexFormat, LdUploadQueue* uploadQueue = nullptr)
+		{
+			loadFromFile(filepath, vertexFormat, uploadQueue, ImportSettings{});
+		}
+		uint64_t getUploadBatch() const { return uploadBatch; }
+		bool isResident() const { return resident.load(std::memory_order_acquire); }
+		void markResident();
+		bool hasFailed() const { return failed.load(std::memory_order_acquire); }
+		void markFailed() { failed.store(true, std::memory_order_release); }
+
 		void bind(VkCommandBuffer commandBuffer);
-		void draw(VkCommandBuffer commandBuffer);
+		// models sharing both buffers can be drawn after a single bind()
+		VkBuffer getVertexBuffer() const;
+		VkBuffer getIndexBuffer() const;
+		// firstInstance offsets gl_InstanceIndex, instanced shaders index their per instance data with it
+		void draw(VkCommandBuffer commandBuffer, uint32_t instanceCount = 1, uint32_t firstInstance = 0);
+		// draws part of the index buffer, e.g. a run of visible meshlets
+		void drawRange(VkCommandBuffer commandBuffer, uint32_t firstIndex, uint32_t indexCount,
+			uint32_t instanceCount = 1, uint32_t firstInstance = 0);
+		void drawLod(VkCommandBuffer commandBuffer, uint32_t lod, uint32_t instanceCount = 1, uint32_t firstInstance = 0);
+		// what drawLod() would record, for draws the gpu writes or picks, only for models with an index buffer
+		VkDrawIndexedIndirectCommand getIndirectCommand(uint32_t lod, uint32_t instanceCount = 1, uint32_t firstInstance = 0) const;
+		bool hasIndices() const { return hasIndexBuffer; }
+
+		const std::vector<Meshlet>& getMeshlets() const { return meshlets; }
+		const std::vector<Lod>& getLods() const { return lods; }
+		uint32_t getTriangleCount(uint32_t lod = 0) const;
+		// bounding sphere in model space
+		const glm::vec3& getBoundsCenter() const { return bounds.center; }
+		float getBoundsRadius() const { return bounds.radius; }
+		const Bounds& getBounds() const { return bounds; }
+		const OccluderMesh& getOccluderMesh() const { return occluderMesh; }
+		VertexFormat getVertexFormat() const { return vertexFormat; }
+		// maps packed vertex positions back to model space, multiply into the model matrix
+		const glm::mat4& getPositionTransform() const { return positionTransform; }
+		const QuantizationError& getQuantizationError() const { return quantizationError; }
+		VkIndexType getIndexType() const { return indexType; }
+		VkDeviceSize getIndexBufferSize() const;
+		// vertex and index buffer bytes, only meaningful once resident
+		VkDeviceSize getMemorySize() const;
+		// bytes a 32 bit index buffer would have needed on top of the actual one
+		VkDeviceSize getIndexBytesSaved() const;
 
-		static std::unique_ptr<LdModel> createModelFromFile(LdDevice& device, const std::string& filepath);
+		static std::unique_ptr<LdModel> createModelFromFile(LdDevice& device, const std::string& filepath,
+			VertexFormat vertexFormat = VertexFormat::Float32);
+		static const char* vertexFormatName(VertexFormat format);
 	private:
-		void createVertexBuffers(const std::vector<Vertex>& vertices);
-		void createIndexBuffers(const std::vector<uint32_t>& indices);
+		void logVertexFormat(const std::string& filepath) const;
+		void create(const MeshView& mesh, LdUploadQueue* uploadQueue, bool occluder);
+		void createOccluderMesh(const MeshView& mesh);
+		void createVertexBuffers(const Vertex* vertices, uint32_t count, LdUploadQueue* uploadQueue);
+		void createIndexBuffers(const uint32_t* indices, uint32_t count, LdUploadQueue* uploadQueue);
+		// writes data through mapped when the destination is host visible, otherwise copies it into
+		// destination now, or enqueues the copy on uploadQueue
+		void uploadBuffer(const void* data, uint32_t instanceSize, uint32_t instanceCount, VkBuffer destination,
+			VkDeviceSize dstOffset, void* mapped, LdUploadQueue* uploadQueue);
+		// where this model's range starts in shared buffers, 0 for models owning their buffers
+		int32_t baseVertex() const;
+		uint32_t baseIndex() const;
+
+	};
+}
 
+namespace std {
+	template<>
+	struct hash<ld::LdModel::Vertex> {
+		size_t operator()(ld::LdModel::Vertex const& vertex) const;
 	};
 }
\ No newline at end of file
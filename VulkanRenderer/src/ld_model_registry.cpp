@@ -0,0 +1,125 @@
+#include "ld_model_registry.hpp"
+
+#include "ld_swapchain.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace ld {
+	LdModelRegistry::LdModelRegistry(LdAssetStreamer& streamer, Settings settings) : streamer{ streamer }, settings{ settings }
+	{
+	}
+
+	std::shared_ptr<LdModel> LdModelRegistry::get(const std::string& filepath, LdModel::VertexFormat vertexFormat, bool occluder)
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		Entry& entry = entries[keyFor(filepath, vertexFormat, occluder)];
+		entry.lastUsed = frame;
+		if (entry.model)
+		{
+			stats.hits++;
+			return entry.model;
+		}
+
+		stats.misses++;
+		entry.model = streamer.requestModel(filepath, vertexFormat, occluder);
+		return entry.model;
+	}
+
+	void LdModelRegistry::update()
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		frame++;
+		VkDeviceSize budget = settings.memoryBudget;
+		VkDeviceSize overshoot = streamer.getMemoryAllocator().getBudgetOvershoot(settings.budgetPressure);
+		if (overshoot > 0)
+		{
+			// resident bytes are last frame's, close enough as eviction runs every frame
+			VkDeviceSize pressured = stats.residentBytes > overshoot ? stats.residentBytes - overshoot : 0;
+			if (pressured < budget)
+			{
+				budget = pressured;
+				stats.pressureUpdates++;
+			}
+		}
+		evict(budget);
+	}
+
+	void LdModelRegistry::evictUnused()
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		evict(0);
+	}
+
+	LdModelRegistry::Stats LdModelRegistry::getStats() const
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		return stats;
+	}
+
+	std::string LdModelRegistry::keyFor(const std::string& filepath, LdModel::VertexFormat vertexFormat, bool occluder)
+	{
+		return filepath + '#' + LdModel::vertexFormatName(vertexFormat) + (occluder ? "#occluder" : "");
+	}
+
+	void LdModelRegistry::evict(VkDeviceSize budget)
+	{
+		for (auto it = entries.begin(); it != entries.end();)
+		{
+			// users still holding a failed model keep it, it just never draws
+			if (it->second.model->hasFailed())
+			{
+				it = entries.erase(it);
+				stats.failures++;
+			}
+			else
+			{
+				++it;
+			}
+		}
+
+		VkDeviceSize residentBytes = 0;
+		std::vector<std::pair<uint64_t, const std::string*>> unused{};
+		for (auto& kv : entries)
+		{
+			Entry& entry = kv.second;
+			if (entry.model.use_count() > 1)
+			{
+				entry.lastUsed = frame;
+			}
+			if (!entry.model->isResident())
+			{
+				continue;
+			}
+			residentBytes += entry.model->getMemorySize();
+			// only the registry holds it, and the frames that may have drawn it have finished
+			if (entry.model.use_count() == 1 && frame - entry.lastUsed > static_cast<uint64_t>(LdSwapChain::MAX_FRAMES_IN_FLIGHT))
+			{
+				unused.push_back({ entry.lastUsed, &kv.first });
+			}
+		}
+
+		if (residentBytes > budget)
+		{
+			std::sort(unused.begin(), unused.end());
+			std::vector<std::string> evicted{};
+			for (const auto& candidate : unused)
+			{
+				if (residentBytes <= budget)
+				{
+					break;
+				}
+				residentBytes -= entries[*candidate.second].model->getMemorySize();
+				evicted.push_back(*candidate.second);
+			}
+			for (const auto& key : evicted)
+			{
+				entries.erase(key);
+			}
+			stats.evictions += evicted.size();
+		}
+
+		stats.models = static_cast<uint32_t>(entries.size());
+		stats.residentBytes = residentBytes;
+	}
+}
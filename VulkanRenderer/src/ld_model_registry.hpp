@@ -0,0 +1,80 @@
+#pragma once
+
+#include "ld_asset_streamer.hpp"
+#include "ld_model.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace ld {
+	// Hands out one shared LdModel per asset path, vertex format and occluder use, streamed in through an
+	// LdAssetStreamer. A model still loading is shared as well, so repeated requests never load twice.
+	// The registry keeps models alive after their last user lets go, until the resident models go over
+	// the memory budget, then the least recently used unreferenced ones are dropped first. A model is
+	// only dropped once no frame in flight can still be drawing it. When a device local heap runs past
+	// budgetPressure of the driver's budget, unused models are dropped until the overshoot is covered,
+	// however far below memoryBudget that ends up. Models that failed to load are dropped on the next
+	// update(), so the next get() for their path loads them again.
+	class LdModelRegistry {
+	public:
+		struct Settings {
+			VkDeviceSize memoryBudget = 256ull * 1024 * 1024;
+			// share of a device local heap's budget past which the registry evicts to make room
+			float budgetPressure = 0.9f;
+		};
+
+		struct Stats {
+			uint64_t hits = 0;
+			uint64_t misses = 0;
+			uint64_t evictions = 0;
+			// entries dropped because their model failed to load
+			uint64_t failures = 0;
+			// updates that evicted below memoryBudget because the heap budget ran short
+			uint64_t pressureUpdates = 0;
+			uint32_t models = 0;
+			VkDeviceSize residentBytes = 0;
+		};
+
+		explicit LdModelRegistry(LdAssetStreamer& streamer) : LdModelRegistry(streamer, Settings{}) {}
+		LdModelRegistry(LdAssetStreamer& streamer, Settings settings);
+
+		LdModelRegistry(const LdModelRegistry&) = delete;
+		LdModelRegistry& operator=(const LdModelRegistry&) = delete;
+
+	private:
+		struct Entry {
+			std::shared_ptr<LdModel> model;
+			// last update() that saw the model requested or held outside the registry
+			uint64_t lastUsed = 0;
+		};
+
+		LdAssetStreamer& streamer;
+		Settings settings;
+
+		// requests may come from any thread, streamer.requestModel() only runs under this lock
+		mutable std::mutex mutex{};
+		std::unordered_map<std::string, Entry> entries{};
+		uint64_t frame = 0;
+		Stats stats{};
+
+	public:
+		// models for LdGameObject::occluder have to be requested with occluder, only they keep an occluder mesh
+		std::shared_ptr<LdModel> get(const std::string& filepath,
+			LdModel::VertexFormat vertexFormat = LdModel::VertexFormat::Float32, bool occluder = false);
+		// call once per frame after LdMemoryAllocator::updateBudget(), recounts resident bytes and
+		// evicts over the budget
+		void update();
+		// drops every model nobody else holds, regardless of the budget
+		void evictUnused();
+
+		Stats getStats() const;
+		Settings& getSettings() { return settings; }
+
+	private:
+		static std::string keyFor(const std::string& filepath, LdModel::VertexFormat vertexFormat, bool occluder);
+		void evict(VkDeviceSize budget);
+	};
+}
@@ -0,0 +1,397 @@
+#include "ld_obj_loader.hpp"
+
+#include "ld_mapped_file.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+
+namespace ld {
+	namespace {
+		constexpr uint32_t RELATIVE_POSITION = 1 << 0;
+		constexpr uint32_t RELATIVE_NORMAL = 1 << 1;
+		constexpr uint32_t RELATIVE_TEXCOORD = 1 << 2;
+
+		inline bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+		inline const char* skipBlank(const char* p, const char* end)
+		{
+			while (p < end && isBlank(*p)) ++p;
+			return p;
+		}
+
+		inline const char* nextLine(const char* p, const char* end)
+		{
+			const void* nl = memchr(p, '\n', static_cast<size_t>(end - p));
+			return nl ? static_cast<const char*>(nl) + 1 : end;
+		}
+
+		// parsed as double and narrowed, the same way tinyobj does it
+		inline bool parseFloat(const char*& p, const char* end, float& out)
+		{
+			p = skipBlank(p, end);
+			if (p < end && *p == '+') ++p;
+			double value = 0.0;
+			auto result = std::from_chars(p, end, value);
+			if (result.ec != std::errc{})
+			{
+				return false;
+			}
+			out = static_cast<float>(value);
+			p = result.ptr;
+			return true;
+		}
+
+		inline bool parseInt(const char*& p, const char* end, int32_t& out)
+		{
+			if (p < end && *p == '+') ++p;
+			auto result = std::from_chars(p, end, out);
+			if (result.ec != std::errc{})
+			{
+				return false;
+			}
+			p = result.ptr;
+			return true;
+		}
+
+		// obj indices are 1-based, negative values count back from the most recent element
+		inline void encodeIndex(int32_t objIndex, size_t localCount, uint32_t relativeBit, int32_t& index, uint32_t& flags)
+		{
+			if (objIndex > 0)
+			{
+				index = objIndex - 1;
+			}
+			else if (objIndex < 0)
+			{
+				index = static_cast<int32_t>(localCount) + objIndex;
+				flags |= relativeBit;
+			}
+			else
+			{
+				throw std::runtime_error("obj face index of 0 is invalid");
+			}
+		}
+
+		inline int64_t resolveIndex(int32_t index, uint32_t flags, uint32_t relativeBit, size_t base, size_t count)
+		{
+			if (index == -1 && !(flags & relativeBit)) return -1;
+			int64_t resolved = (flags & relativeBit) ? static_cast<int64_t>(base) + index : index;
+			if (resolved < 0 || resolved >= static_cast<int64_t>(count))
+			{
+				throw std::runtime_error("obj face index out of range");
+			}
+			return resolved;
+		}
+	}
+
+	double LdObjLoader::Stats::megabytesPerSecond() const
+	{
+		double seconds = totalSeconds();
+		return seconds > 0.0 ? (fileBytes / (1024.0 * 1024.0)) / seconds : 0.0;
+	}
+
+	double LdObjLoader::Stats::trianglesPerSecond() const
+	{
+		double seconds = totalSeconds();
+		return seconds > 0.0 ? triangleCount / seconds : 0.0;
+	}
+
+	LdObjLoader::LdObjLoader(uint32_t threadCount, LdVertexWelder::Settings weldSettings) : threadCount{ threadCount }, weldSettings{ weldSettings }
+	{
+		if (this->threadCount == 0)
+		{
+			this->threadCount = std::max(1u, std::thread::hardware_concurrency());
+		}
+	}
+
+	template<typename Fn>
+	void LdObjLoader::parallelFor(size_t count, Fn&& fn) const
+	{
+		size_t workerCount = std::min<size_t>(threadCount, count);
+		if (workerCount <= 1)
+		{
+			for (size_t i = 0; i < count; i++) fn(i);
+			return;
+		}
+
+		std::atomic<size_t> next{ 0 };
+		std::vector<std::exception_ptr> errors(workerCount);
+		std::vector<std::thread> workers;
+		workers.reserve(workerCount);
+		for (size_t w = 0; w < workerCount; w++)
+		{
+			workers.emplace_back([&, w]() {
+				try
+				{
+					for (size_t i = next++; i < count; i = next++) fn(i);
+				}
+				catch (...)
+				{
+					errors[w] = std::current_exception();
+				}
+			});
+		}
+		for (auto& worker : workers) worker.join();
+		for (auto& error : errors)
+		{
+			if (error) std::rethrow_exception(error);
+		}
+	}
+
+	void LdObjLoader::load(const std::string& filepath, std::vector<LdModel::Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		auto readStart = std::chrono::high_resolution_clock::now();
+
+		LdMappedFile file{ filepath };
+		if (!file.isOpen())
+		{
+			throw std::runtime_error("failed to open file: " + filepath);
+		}
+
+		double readSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - readStart).count();
+		loadFromMemory(file.data(), file.size(), vertices, indices);
+		stats.readSeconds = readSeconds;
+	}
+
+	void LdObjLoader::loadFromMemory(const char* data, size_t size, std::vector<LdModel::Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		stats = Stats{};
+		stats.fileBytes = size;
+
+		auto parseStart = std::chrono::high_resolution_clock::now();
+
+		std::vector<Chunk> chunks = splitChunks(data, size);
+		stats.chunkCount = static_cast<uint32_t>(chunks.size());
+		stats.threadCount = static_cast<uint32_t>(std::min<size_t>(threadCount, chunks.size()));
+
+		parallelFor(chunks.size(), [&](size_t i) { parseChunk(chunks[i]); });
+
+		// stitch attribute streams together in file order
+		size_t positionCount = 0, normalCount = 0, texcoordCount = 0, cornerCount = 0;
+		for (auto& chunk : chunks)
+		{
+			chunk.positionBase = positionCount;
+			chunk.normalBase = normalCount;
+			chunk.texcoordBase = texcoordCount;
+			chunk.cornerBase = cornerCount;
+			positionCount += chunk.positions.size() / 3;
+			normalCount += chunk.normals.size() / 3;
+			texcoordCount += chunk.texcoords.size() / 2;
+			cornerCount += chunk.corners.size();
+		}
+
+		std::vector<float> positions(positionCount * 3);
+		std::vector<float> colors(positionCount * 3);
+		std::vector<float> normals(normalCount * 3);
+		std::vector<float> texcoords(texcoordCount * 2);
+		parallelFor(chunks.size(), [&](size_t i) {
+			auto& chunk = chunks[i];
+			std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + chunk.positionBase * 3);
+			std::copy(chunk.colors.begin(), chunk.colors.end(), colors.begin() + chunk.positionBase * 3);
+			std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + chunk.normalBase * 3);
+			std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), texcoords.begin() + chunk.texcoordBase * 2);
+		});
+
+		auto buildStart = std::chrono::high_resolution_clock::now();
+		stats.parseSeconds = std::chrono::duration<double>(buildStart - parseStart).count();
+
+		parallelFor(chunks.size(), [&](size_t i) {
+			buildChunkVertices(chunks[i], positions, colors, normals, texcoords, weldSettings);
+		});
+
+		// merging the per-chunk unique lists in chunk order keeps first-occurrence order,
+		// so the result is identical to a single pass over the whole file
+		size_t localVertexCount = 0;
+		for (const auto& chunk : chunks)
+		{
+			localVertexCount += chunk.localVertices.size();
+		}
+		LdVertexWelder welder{ weldSettings, localVertexCount };
+		for (auto& chunk : chunks)
+		{
+			chunk.remap.resize(chunk.localVertices.size());
+			for (size_t v = 0; v < chunk.localVertices.size(); v++)
+			{
+				chunk.remap[v] = welder.weld(chunk.localVertices[v]);
+			}
+		}
+		vertices = welder.takeVertices();
+		indices.clear();
+
+		indices.resize(cornerCount);
+		parallelFor(chunks.size(), [&](size_t i) {
+			auto& chunk = chunks[i];
+			for (size_t c = 0; c < chunk.localIndices.size(); c++)
+			{
+				indices[chunk.cornerBase + c] = chunk.remap[chunk.localIndices[c]];
+			}
+		});
+
+		stats.buildSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - buildStart).count();
+		stats.triangleCount = indices.size() / 3;
+		stats.uniqueVertexCount = vertices.size();
+	}
+
+	std::vector<LdObjLoader::Chunk> LdObjLoader::splitChunks(const char* data, size_t size) const
+	{
+		// a few chunks per thread so one slow chunk does not hold up the rest
+		size_t target = std::max(MIN_CHUNK_BYTES, size / (static_cast<size_t>(threadCount) * 4) + 1);
+
+		std::vector<Chunk> chunks{};
+		const char* end = data + size;
+		const char* p = data;
+		while (p < end)
+		{
+			const char* chunkEnd = (static_cast<size_t>(end - p) <= target) ? end : nextLine(p + target, end);
+			Chunk chunk{};
+			chunk.begin = p;
+			chunk.end = chunkEnd;
+			chunks.push_back(std::move(chunk));
+			p = chunkEnd;
+		}
+		return chunks;
+	}
+
+	void LdObjLoader::parseChunk(Chunk& chunk)
+	{
+		const char* end = chunk.end;
+		std::vector<Corner> polygon{};
+		auto& corners = chunk.corners;
+		corners.reserve(static_cast<size_t>(end - chunk.begin) / 32);
+
+		for (const char* line = chunk.begin; line < end;)
+		{
+			const char* lineEnd = nextLine(line, end);
+			const char* p = skipBlank(line, lineEnd);
+			if (lineEnd - p < 2)
+			{
+				line = lineEnd;
+				continue;
+			}
+
+			if (p[0] == 'v' && isBlank(p[1]))
+			{
+				p += 2;
+				float x = 0.f, y = 0.f, z = 0.f;
+				parseFloat(p, lineEnd, x);
+				parseFloat(p, lineEnd, y);
+				parseFloat(p, lineEnd, z);
+				chunk.positions.push_back(x);
+				chunk.positions.push_back(y);
+				chunk.positions.push_back(z);
+
+				// optional vertex colors, white when absent
+				float r = 1.f, g = 1.f, b = 1.f;
+				if (parseFloat(p, lineEnd, r))
+				{
+					parseFloat(p, lineEnd, g);
+					parseFloat(p, lineEnd, b);
+				}
+				chunk.colors.push_back(r);
+				chunk.colors.push_back(g);
+				chunk.colors.push_back(b);
+			}
+			else if (p[0] == 'v' && p[1] == 'n' && lineEnd - p > 2 && isBlank(p[2]))
+			{
+				p += 3;
+				float x = 0.f, y = 0.f, z = 0.f;
+				parseFloat(p, lineEnd, x);
+				parseFloat(p, lineEnd, y);
+				parseFloat(p, lineEnd, z);
+				chunk.normals.push_back(x);
+				chunk.normals.push_back(y);
+				chunk.normals.push_back(z);
+			}
+			else if (p[0] == 'v' && p[1] == 't' && lineEnd - p > 2 && isBlank(p[2]))
+			{
+				p += 3;
+				float u = 0.f, v = 0.f;
+				parseFloat(p, lineEnd, u);
+				parseFloat(p, lineEnd, v);
+				chunk.texcoords.push_back(u);
+				chunk.texcoords.push_back(v);
+			}
+			else if (p[0] == 'f' && isBlank(p[1]))
+			{
+				p += 2;
+				polygon.clear();
+				while (true)
+				{
+					p = skipBlank(p, lineEnd);
+					if (p >= lineEnd || *p == '\n' || *p == '#') break;
+
+					Corner corner{ -1, -1, -1, 0 };
+					int32_t value = 0;
+					if (!parseInt(p, lineEnd, value))
+					{
+						throw std::runtime_error("malformed obj face: " + std::string(line, lineEnd));
+					}
+					encodeIndex(value, chunk.positions.size() / 3, RELATIVE_POSITION, corner.position, corner.relativeFlags);
+					if (p < lineEnd && *p == '/')
+					{
+						++p;
+						if (p < lineEnd && *p != '/' && parseInt(p, lineEnd, value))
+						{
+							encodeIndex(value, chunk.texcoords.size() / 2, RELATIVE_TEXCOORD, corner.texcoord, corner.relativeFlags);
+						}
+						if (p < lineEnd && *p == '/')
+						{
+							++p;
+							if (parseInt(p, lineEnd, value))
+							{
+								encodeIndex(value, chunk.normals.size() / 3, RELATIVE_NORMAL, corner.normal, corner.relativeFlags);
+							}
+						}
+					}
+					polygon.push_back(corner);
+				}
+
+				// fan triangulation
+				for (size_t k = 2; k < polygon.size(); k++)
+				{
+					corners.push_back(polygon[0]);
+					corners.push_back(polygon[k - 1]);
+					corners.push_back(polygon[k]);
+				}
+			}
+			line = lineEnd;
+		}
+	}
+
+	void LdObjLoader::buildChunkVertices(Chunk& chunk, const std::vector<float>& positions, const std::vector<float>& colors,
+		const std::vector<float>& normals, const std::vector<float>& texcoords, LdVertexWelder::Settings weldSettings)
+	{
+		size_t positionCount = positions.size() / 3;
+		size_t normalCount = normals.size() / 3;
+		size_t texcoordCount = texcoords.size() / 2;
+
+		LdVertexWelder welder{ weldSettings, chunk.corners.size() / 4 };
+		chunk.localIndices.reserve(chunk.corners.size());
+		for (const auto& corner : chunk.corners)
+		{
+			int64_t vi = resolveIndex(corner.position, corner.relativeFlags, RELATIVE_POSITION, chunk.positionBase, positionCount);
+			int64_t ni = resolveIndex(corner.normal, corner.relativeFlags, RELATIVE_NORMAL, chunk.normalBase, normalCount);
+			int64_t ti = resolveIndex(corner.texcoord, corner.relativeFlags, RELATIVE_TEXCOORD, chunk.texcoordBase, texcoordCount);
+
+			LdModel::Vertex vertex{};
+			vertex.position = { positions[3 * vi + 0], positions[3 * vi + 1], positions[3 * vi + 2] };
+			vertex.color = { colors[3 * vi + 0], colors[3 * vi + 1], colors[3 * vi + 2] };
+			if (ni >= 0)
+			{
+				vertex.normal = { normals[3 * ni + 0], normals[3 * ni + 1], normals[3 * ni + 2] };
+			}
+			if (ti >= 0)
+			{
+				vertex.uv = { texcoords[2 * ti + 0], texcoords[2 * ti + 1] };
+			}
+
+			chunk.localIndices.push_back(welder.weld(vertex));
+		}
+		chunk.localVertices = welder.takeVertices();
+	}
+}
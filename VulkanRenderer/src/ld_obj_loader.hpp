@@ -0,0 +1,89 @@
+#pragma once
+
+#include "ld_model.hpp"
+#include "ld_vertex_welder.hpp"
+
+#include <string>
+#include <vector>
+
+namespace ld {
+	// Multithreaded wavefront .obj reader.
+	// The file is split into line aligned chunks which are parsed on all cores, the per-chunk
+	// attribute arrays are then stitched together and faces are resolved into the same
+	// deduplicated vertex/index layout that LdModel::Builder has always produced.
+	class LdObjLoader {
+	public:
+		struct Stats {
+			size_t fileBytes = 0;
+			size_t triangleCount = 0;
+			size_t uniqueVertexCount = 0;
+			uint32_t chunkCount = 0;
+			uint32_t threadCount = 0;
+			double readSeconds = 0.0;
+			double parseSeconds = 0.0;
+			double buildSeconds = 0.0;
+
+			double totalSeconds() const { return readSeconds + parseSeconds + buildSeconds; }
+			double megabytesPerSecond() const;
+			double trianglesPerSecond() const;
+		};
+
+		// threadCount == 0 uses every hardware thread
+		explicit LdObjLoader(uint32_t threadCount = 0, LdVertexWelder::Settings weldSettings = {});
+
+		LdObjLoader(const LdObjLoader&) = delete;
+		LdObjLoader& operator=(const LdObjLoader&) = delete;
+
+	private:
+		// chunks smaller than this are not worth a thread
+		static constexpr size_t MIN_CHUNK_BYTES = 256 * 1024;
+
+		struct Corner {
+			// 0-based indices, -1 when absent. A set relative bit means the index was written
+			// as a negative obj index and is still relative to the chunk's first element.
+			int32_t position;
+			int32_t normal;
+			int32_t texcoord;
+			uint32_t relativeFlags;
+		};
+
+		struct Chunk {
+			const char* begin = nullptr;
+			const char* end = nullptr;
+
+			std::vector<float> positions{};
+			std::vector<float> colors{};
+			std::vector<float> normals{};
+			std::vector<float> texcoords{};
+			std::vector<Corner> corners{}; // 3 per triangle
+
+			// filled in after all chunks are parsed
+			size_t positionBase = 0;
+			size_t normalBase = 0;
+			size_t texcoordBase = 0;
+			size_t cornerBase = 0;
+
+			std::vector<LdModel::Vertex> localVertices{};
+			std::vector<uint32_t> localIndices{};
+			std::vector<uint32_t> remap{};
+		};
+
+		uint32_t threadCount;
+		LdVertexWelder::Settings weldSettings;
+		Stats stats{};
+
+	public:
+		void load(const std::string& filepath, std::vector<LdModel::Vertex>& vertices, std::vector<uint32_t>& indices);
+		void loadFromMemory(const char* data, size_t size, std::vector<LdModel::Vertex>& vertices, std::vector<uint32_t>& indices);
+		const Stats& getStats() const { return stats; }
+
+	private:
+		std::vector<Chunk> splitChunks(const char* data, size_t size) const;
+		static void parseChunk(Chunk& chunk);
+		static void buildChunkVertices(Chunk& chunk, const std::vector<float>& positions, const std::vector<float>& colors,
+			const std::vector<float>& normals, const std::vector<float>& texcoords, LdVertexWelder::Settings weldSettings);
+
+		template<typename Fn>
+		void parallelFor(size_t count, Fn&& fn) const;
+	};
+}
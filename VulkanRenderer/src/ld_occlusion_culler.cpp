@@ -0,0 +1,379 @@
+#include "ld_occlusion_culler.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <utility>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define LD_CULLER_X86 1
+#include <emmintrin.h>
+#endif
+
+namespace ld {
+	namespace {
+		using Clock = std::chrono::high_resolution_clock;
+
+		// a * x + b * y + c is positive left of the edge from p to q, in a y down space
+		struct Edge {
+			float a;
+			float b;
+			float c;
+
+			Edge(const glm::vec3& p, const glm::vec3& q)
+				: a{ p.y - q.y }, b{ q.x - p.x }, c{ p.x * q.y - p.y * q.x }
+			{
+			}
+		};
+	}
+
+	LdOcclusionCuller::LdOcclusionCuller(uint32_t width, uint32_t height)
+		: instructionSet{ std::min(LdFrustumCuller::bestInstructionSet(), LdFrustumCuller::InstructionSet::Sse) },
+		width{ (width + 3) / 4 * 4 },
+		height{ height }
+	{
+		depth.assign(static_cast<size_t>(this->width) * height, 1.f);
+		worker = std::thread{ &LdOcclusionCuller::workerLoop, this };
+	}
+
+	LdOcclusionCuller::~LdOcclusionCuller()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			stopping = true;
+		}
+		workAdded.notify_all();
+		worker.join();
+	}
+
+	void LdOcclusionCuller::setInstructionSet(LdFrustumCuller::InstructionSet requested)
+	{
+		wait();
+		instructionSet = std::min({ requested, LdFrustumCuller::bestInstructionSet(), LdFrustumCuller::InstructionSet::Sse });
+	}
+
+	void LdOcclusionCuller::begin(const LdCamera& camera)
+	{
+		begin(camera.getProjection() * camera.getView());
+	}
+
+	void LdOcclusionCuller::begin(const glm::mat4& viewProjection)
+	{
+		wait();
+		this->viewProjection = viewProjection;
+		occluders.clear();
+		stats = Stats{};
+		rasterized = false;
+	}
+
+	void LdOcclusionCuller::addOccluder(const LdModel::OccluderMesh& mesh, const glm::mat4& modelMatrix)
+	{
+		assert(!pending && "Occluders have to be added before rasterize()");
+		occluders.push_back({ &mesh, modelMatrix });
+		stats.occluders++;
+	}
+
+	void LdOcclusionCuller::rasterize()
+	{
+		if (occluders.empty())
+		{
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			rasterizing = true;
+		}
+		workAdded.notify_one();
+		pending = true;
+		rasterized = true;
+	}
+
+	void LdOcclusionCuller::wait()
+	{
+		if (!pending)
+		{
+			return;
+		}
+		{
+			std::unique_lock<std::mutex> lock{ mutex };
+			workDone.wait(lock, [this] { return !rasterizing; });
+		}
+		pending = false;
+		stats.triangles = rasterStats.triangles;
+		stats.trianglesRasterized = rasterStats.trianglesRasterized;
+		stats.rasterizeMilliseconds = rasterStats.rasterizeMilliseconds;
+	}
+
+	void LdOcclusionCuller::workerLoop()
+	{
+		std::unique_lock<std::mutex> lock{ mutex };
+		while (true)
+		{
+			workAdded.wait(lock, [this] { return rasterizing || stopping; });
+			if (stopping)
+			{
+				return;
+			}
+			lock.unlock();
+			rasterizeOccluders();
+			lock.lock();
+			rasterizing = false;
+			workDone.notify_all();
+		}
+	}
+
+	void LdOcclusionCuller::rasterizeOccluders()
+	{
+		auto start = Clock::now();
+		rasterStats = Stats{};
+		std::fill(depth.begin(), depth.end(), 1.f);
+		for (const Occluder& occluder : occluders)
+		{
+			const LdModel::OccluderMesh& mesh = *occluder.mesh;
+			glm::mat4 modelViewProjection = viewProjection * occluder.modelMatrix;
+			clipPositions.resize(mesh.positions.size());
+			for (size_t i = 0; i < mesh.positions.size(); i++)
+			{
+				clipPositions[i] = modelViewProjection * glm::vec4{ mesh.positions[i], 1.f };
+			}
+			for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+			{
+				rasterizeTriangle(clipPositions[mesh.indices[i]], clipPositions[mesh.indices[i + 1]], clipPositions[mesh.indices[i + 2]]);
+			}
+			rasterStats.triangles += static_cast<uint32_t>(mesh.indices.size() / 3);
+		}
+		rasterStats.rasterizeMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	void LdOcclusionCuller::rasterizeTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c)
+	{
+		// fully outside one side of the frustum, depth runs from 0 at the near plane to w at the far one
+		if ((a.x < -a.w && b.x < -b.w && c.x < -c.w) || (a.x > a.w && b.x > b.w && c.x > c.w)
+			|| (a.y < -a.w && b.y < -b.w && c.y < -c.w) || (a.y > a.w && b.y > b.w && c.y > c.w)
+			|| (a.z < 0.f && b.z < 0.f && c.z < 0.f) || (a.z > a.w && b.z > b.w && c.z > c.w))
+		{
+			return;
+		}
+
+		// Sutherland-Hodgman against the near plane, one triangle clips to at most a quad
+		const glm::vec4 corners[3] = { a, b, c };
+		glm::vec4 polygon[4];
+		int count = 0;
+		for (int i = 0; i < 3; i++)
+		{
+			const glm::vec4& current = corners[i];
+			const glm::vec4& next = corners[(i + 1) % 3];
+			if (current.z >= 0.f)
+			{
+				polygon[count++] = current;
+			}
+			if ((current.z >= 0.f) != (next.z >= 0.f))
+			{
+				polygon[count++] = current + (next - current) * (current.z / (current.z - next.z));
+			}
+		}
+
+		glm::vec3 screen[4];
+		for (int i = 0; i < count; i++)
+		{
+			if (polygon[i].w <= 0.f)
+			{
+				return;
+			}
+			glm::vec3 ndc = glm::vec3{ polygon[i] } / polygon[i].w;
+			screen[i] = { (ndc.x * .5f + .5f) * width, (ndc.y * .5f + .5f) * height, ndc.z };
+		}
+		for (int i = 2; i < count; i++)
+		{
+			fillTriangle(screen[0], screen[i - 1], screen[i]);
+		}
+	}
+
+	void LdOcclusionCuller::fillTriangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+	{
+		glm::vec3 v0 = a;
+		glm::vec3 v1 = b;
+		glm::vec3 v2 = c;
+		float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+		// both windings are filled, occluders need not be closed
+		if (area < 0.f)
+		{
+			std::swap(v1, v2);
+			area = -area;
+		}
+		if (area <= 1e-6f)
+		{
+			return;
+		}
+
+		// pixels whose centers lie inside the triangle's bounds, clamped before the conversion to int
+		float left = std::max(std::min({ v0.x, v1.x, v2.x }) - .5f, 0.f);
+		float right = std::min(std::max({ v0.x, v1.x, v2.x }) - .5f, static_cast<float>(width - 1));
+		float top = std::max(std::min({ v0.y, v1.y, v2.y }) - .5f, 0.f);
+		float bottom = std::min(std::max({ v0.y, v1.y, v2.y }) - .5f, static_cast<float>(height - 1));
+		if (left > right || top > bottom)
+		{
+			return;
+		}
+		int minX = static_cast<int>(std::ceil(left));
+		int maxX = static_cast<int>(std::floor(right));
+		int minY = static_cast<int>(std::ceil(top));
+		int maxY = static_cast<int>(std::floor(bottom));
+		if (minX > maxX || minY > maxY)
+		{
+			return;
+		}
+		rasterStats.trianglesRasterized++;
+
+		// every edge is positive inside and weighs the corner opposite it
+		Edge e0{ v1, v2 };
+		Edge e1{ v2, v0 };
+		Edge e2{ v0, v1 };
+		float zA = (e0.a * v0.z + e1.a * v1.z + e2.a * v2.z) / area;
+		float zB = (e0.b * v0.z + e1.b * v1.z + e2.b * v2.z) / area;
+		float zC = (e0.c * v0.z + e1.c * v1.z + e2.c * v2.z) / area;
+
+#if defined(LD_CULLER_X86)
+		if (instructionSet != LdFrustumCuller::InstructionSet::Scalar)
+		{
+			// groups start on a multiple of four, the width is one, so no group runs past a row. Lanes
+			// outside the bounds fail an edge test.
+			const __m128 laneCenters = _mm_setr_ps(.5f, 1.5f, 2.5f, 3.5f);
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 a0 = _mm_set1_ps(e0.a), a1 = _mm_set1_ps(e1.a), a2 = _mm_set1_ps(e2.a);
+			const __m128 za = _mm_set1_ps(zA);
+			int startX = minX & ~3;
+			for (int y = minY; y <= maxY; y++)
+			{
+				float centerY = y + .5f;
+				__m128 row0 = _mm_set1_ps(e0.b * centerY + e0.c);
+				__m128 row1 = _mm_set1_ps(e1.b * centerY + e1.c);
+				__m128 row2 = _mm_set1_ps(e2.b * centerY + e2.c);
+				__m128 rowZ = _mm_set1_ps(zB * centerY + zC);
+				float* row = depth.data() + static_cast<size_t>(y) * width;
+				for (int x = startX; x <= maxX; x += 4)
+				{
+					__m128 centerX = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneCenters);
+					__m128 inside = _mm_and_ps(
+						_mm_and_ps(_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a0, centerX), row0), zero),
+							_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a1, centerX), row1), zero)),
+						_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a2, centerX), row2), zero));
+					if (_mm_movemask_ps(inside) == 0)
+					{
+						continue;
+					}
+					__m128 z = _mm_add_ps(_mm_mul_ps(za, centerX), rowZ);
+					__m128 stored = _mm_loadu_ps(row + x);
+					__m128 nearer = _mm_min_ps(stored, z);
+					_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, stored)));
+				}
+			}
+			return;
+		}
+#endif
+		for (int y = minY; y <= maxY; y++)
+		{
+			float centerY = y + .5f;
+			float* row = depth.data() + static_cast<size_t>(y) * width;
+			for (int x = minX; x <= maxX; x++)
+			{
+				float centerX = x + .5f;
+				if (e0.a * centerX + e0.b * centerY + e0.c >= 0.f
+					&& e1.a * centerX + e1.b * centerY + e1.c >= 0.f
+					&& e2.a * centerX + e2.b * centerY + e2.c >= 0.f)
+				{
+					row[x] = std::min(row[x], zA * centerX + zB * centerY + zC);
+				}
+			}
+		}
+	}
+
+	bool LdOcclusionCuller::isOccluded(const LdModel::Bounds& bounds, const glm::mat4& modelMatrix)
+	{
+		wait();
+		stats.tested++;
+		if (!rasterized)
+		{
+			return false;
+		}
+
+		glm::mat4 modelViewProjection = viewProjection * modelMatrix;
+		glm::vec2 minScreen{ static_cast<float>(width), static_cast<float>(height) };
+		glm::vec2 maxScreen{ 0.f };
+		float nearest = 1.f;
+		for (int i = 0; i < 8; i++)
+		{
+			glm::vec3 corner{ i & 1 ? bounds.max.x : bounds.min.x, i & 2 ? bounds.max.y : bounds.min.y, i & 4 ? bounds.max.z : bounds.min.z };
+			glm::vec4 clip = modelViewProjection * glm::vec4{ corner, 1.f };
+			// reaches in front of the near plane, the rectangle would be unbounded
+			if (clip.z < 0.f || clip.w <= 0.f)
+			{
+				return false;
+			}
+			glm::vec3 ndc = glm::vec3{ clip } / clip.w;
+			glm::vec2 point{ (ndc.x * .5f + .5f) * width, (ndc.y * .5f + .5f) * height };
+			minScreen = glm::min(minScreen, point);
+			maxScreen = glm::max(maxScreen, point);
+			nearest = std::min(nearest, ndc.z);
+		}
+		// off screen, the frustum culler's call
+		if (maxScreen.x <= 0.f || maxScreen.y <= 0.f || minScreen.x >= width || minScreen.y >= height)
+		{
+			return false;
+		}
+
+		// every pixel the rectangle touches
+		int minX = static_cast<int>(std::max(minScreen.x, 0.f));
+		int minY = static_cast<int>(std::max(minScreen.y, 0.f));
+		int maxX = std::max(minX, std::min(static_cast<int>(std::ceil(maxScreen.x)) - 1, static_cast<int>(width) - 1));
+		int maxY = std::max(minY, std::min(static_cast<int>(std::ceil(maxScreen.y)) - 1, static_cast<int>(height) - 1));
+		if (anyVisible(minX, minY, maxX, maxY, nearest))
+		{
+			return false;
+		}
+		stats.occluded++;
+		return true;
+	}
+
+	bool LdOcclusionCuller::anyVisible(int minX, int minY, int maxX, int maxY, float nearest) const
+	{
+#if defined(LD_CULLER_X86)
+		if (instructionSet != LdFrustumCuller::InstructionSet::Scalar)
+		{
+			const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+			const __m128i first = _mm_set1_epi32(minX - 1);
+			const __m128i last = _mm_set1_epi32(maxX + 1);
+			const __m128 nearestDepth = _mm_set1_ps(nearest);
+			int startX = minX & ~3;
+			for (int y = minY; y <= maxY; y++)
+			{
+				const float* row = depth.data() + static_cast<size_t>(y) * width;
+				for (int x = startX; x <= maxX; x += 4)
+				{
+					__m128i columns = _mm_add_epi32(_mm_set1_epi32(x), lanes);
+					__m128i inRect = _mm_and_si128(_mm_cmpgt_epi32(columns, first), _mm_cmplt_epi32(columns, last));
+					__m128 behind = _mm_cmpge_ps(_mm_loadu_ps(row + x), nearestDepth);
+					if (_mm_movemask_ps(_mm_and_ps(behind, _mm_castsi128_ps(inRect))) != 0)
+					{
+						return true;
+					}
+				}
+			}
+			return false;
+		}
+#endif
+		for (int y = minY; y <= maxY; y++)
+		{
+			const float* row = depth.data() + static_cast<size_t>(y) * width;
+			for (int x = minX; x <= maxX; x++)
+			{
+				if (row[x] >= nearest)
+				{
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+}
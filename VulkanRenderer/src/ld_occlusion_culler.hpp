@@ -0,0 +1,102 @@
+#pragma once
+
+#include "ld_camera.hpp"
+#include "ld_frustum_culler.hpp"
+#include "ld_model.hpp"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ld {
+	// Software occlusion culling for devices where a compute pass costs more than it saves. A few
+	// designated occluders are rasterized into a small cpu depth buffer on a worker thread, four pixels
+	// at a time with SSE, while the render thread gathers and frustum culls its objects. isOccluded()
+	// then projects an object's bounding box and reports it hidden when its nearest corner lies behind
+	// every depth under its screen rectangle. Occluders cover the pixels whose centers they contain, so
+	// they may leak at their silhouettes but never grow.
+	class LdOcclusionCuller {
+	public:
+		static constexpr uint32_t DEFAULT_WIDTH = 320;
+		static constexpr uint32_t DEFAULT_HEIGHT = 180;
+
+		struct Stats {
+			uint32_t occluders = 0;
+			// occluder triangles handed to the rasterizer, and those left after rejecting and clipping
+			uint32_t triangles = 0;
+			uint32_t trianglesRasterized = 0;
+			double rasterizeMilliseconds = 0.0;
+			uint32_t tested = 0;
+			uint32_t occluded = 0;
+		};
+
+		// width is rounded up to a multiple of four, the rasterizer's pixel group
+		LdOcclusionCuller(uint32_t width = DEFAULT_WIDTH, uint32_t height = DEFAULT_HEIGHT);
+		~LdOcclusionCuller();
+
+		LdOcclusionCuller(const LdOcclusionCuller&) = delete;
+		LdOcclusionCuller& operator=(const LdOcclusionCuller&) = delete;
+
+	private:
+		struct Occluder {
+			const LdModel::OccluderMesh* mesh;
+			glm::mat4 modelMatrix;
+		};
+
+		LdFrustumCuller::InstructionSet instructionSet;
+		uint32_t width;
+		uint32_t height;
+		// row major, 1 is the far plane
+		std::vector<float> depth{};
+		glm::mat4 viewProjection{ 1.f };
+		std::vector<Occluder> occluders{};
+		Stats stats{};
+
+		// render thread only, set between rasterize() and wait()
+		bool pending = false;
+		bool rasterized = false;
+
+		std::thread worker{};
+		std::mutex mutex{};
+		std::condition_variable workAdded{};
+		std::condition_variable workDone{};
+		bool rasterizing = false;
+		bool stopping = false;
+		// worker only until workDone, wait() copies them into stats
+		std::vector<glm::vec4> clipPositions{};
+		Stats rasterStats{};
+
+	public:
+		// Avx selects the SSE rasterizer as well, falls back to scalar on cpus without SSE
+		void setInstructionSet(LdFrustumCuller::InstructionSet requested);
+		LdFrustumCuller::InstructionSet getInstructionSet() const { return instructionSet; }
+
+		// call once per frame before addOccluder(), waits for the last frame's rasterization
+		void begin(const LdCamera& camera);
+		void begin(const glm::mat4& viewProjection);
+		// mesh has to stay alive until the next begin()
+		void addOccluder(const LdModel::OccluderMesh& mesh, const glm::mat4& modelMatrix);
+		bool hasOccluders() const { return !occluders.empty(); }
+		// hands the occluders to the worker thread and returns at once, does nothing without occluders
+		void rasterize();
+		// the first call after rasterize() waits for the worker. Objects are never occluded in frames
+		// without a rasterize(), or when their box crosses the near plane or leaves the screen.
+		bool isOccluded(const LdModel::Bounds& bounds, const glm::mat4& modelMatrix);
+
+		uint32_t getWidth() const { return width; }
+		uint32_t getHeight() const { return height; }
+		// the rasterizer's numbers are in once the frame waited for it
+		const Stats& getStats() const { return stats; }
+
+	private:
+		void workerLoop();
+		void wait();
+		void rasterizeOccluders();
+		// clips against the near plane, then fills the one or two triangles left
+		void rasterizeTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+		void fillTriangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c);
+		// true when any depth in the inclusive pixel rectangle is at or behind nearest, so the object may show
+		bool anyVisible(int minX, int minY, int maxX, int maxY, float nearest) const;
+	};
+}
@@ -0,0 +1,198 @@
+#include "ld_parallel_recorder.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace ld {
+	uint32_t LdParallelRecorder::defaultWorkerCount()
+	{
+		uint32_t threads = std::thread::hardware_concurrency();
+		return threads > 1 ? threads - 1 : 0;
+	}
+
+	LdParallelRecorder::LdParallelRecorder(LdDevice& device, uint32_t workerCount)
+	{
+		for (uint32_t i = 0; i <= workerCount; i++)
+		{
+			pools.push_back(std::make_unique<LdFrameCommandPool>(device));
+		}
+		for (uint32_t i = 0; i < workerCount; i++)
+		{
+			workers.emplace_back(&LdParallelRecorder::workerLoop, this, i);
+		}
+	}
+
+	LdParallelRecorder::~LdParallelRecorder()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			stopping = true;
+		}
+		jobAdded.notify_all();
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+	}
+
+	void LdParallelRecorder::beginFrame(int frameIndex)
+	{
+		recorded.clear();
+		for (auto& pool : pools)
+		{
+			pool->reset(frameIndex);
+		}
+	}
+
+	const std::vector<VkCommandBuffer>& LdParallelRecorder::record(const Target& target, uint32_t itemCount, const RecordSlice& recordSlice)
+	{
+		recorded.clear();
+		if (itemCount == 0)
+		{
+			return recorded;
+		}
+		uint32_t sliceCount = std::min(getMaxSlices(), (itemCount + MIN_SLICE_SIZE - 1) / MIN_SLICE_SIZE);
+		recorded.assign(sliceCount, VK_NULL_HANDLE);
+
+		if (sliceCount > 1)
+		{
+			{
+				std::lock_guard<std::mutex> lock{ mutex };
+				job = &recordSlice;
+				jobTarget = target;
+				jobItems = itemCount;
+				jobSlices = sliceCount;
+				remaining = sliceCount - 1;
+				jobError = nullptr;
+				generation++;
+			}
+			jobAdded.notify_all();
+		}
+
+		std::exception_ptr error{};
+		try
+		{
+			this->recordSlice(0, target, itemCount, sliceCount, recordSlice);
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+
+		if (sliceCount > 1)
+		{
+			std::unique_lock<std::mutex> lock{ mutex };
+			jobDone.wait(lock, [this] { return remaining == 0; });
+			if (!error)
+			{
+				error = jobError;
+			}
+			jobError = nullptr;
+			job = nullptr;
+		}
+		if (error)
+		{
+			std::rethrow_exception(error);
+		}
+		return recorded;
+	}
+
+	VkCommandBuffer LdParallelRecorder::beginSecondary(const Target& target)
+	{
+		VkCommandBuffer commandBuffer = pools.back()->acquire(VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+		beginCommandBuffer(commandBuffer, target, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+		return commandBuffer;
+	}
+
+	void LdParallelRecorder::workerLoop(uint32_t worker)
+	{
+		uint64_t seen = 0;
+		std::unique_lock<std::mutex> lock{ mutex };
+		while (true)
+		{
+			jobAdded.wait(lock, [this, seen] { return stopping || generation != seen; });
+			if (stopping)
+			{
+				return;
+			}
+			seen = generation;
+			uint32_t slice = worker + 1;
+			if (slice >= jobSlices)
+			{
+				continue;
+			}
+			const RecordSlice& current = *job;
+			Target target = jobTarget;
+			uint32_t itemCount = jobItems;
+			uint32_t sliceCount = jobSlices;
+			lock.unlock();
+
+			std::exception_ptr error{};
+			try
+			{
+				recordSlice(slice, target, itemCount, sliceCount, current);
+			}
+			catch (...)
+			{
+				error = std::current_exception();
+			}
+
+			lock.lock();
+			if (error && !jobError)
+			{
+				jobError = error;
+			}
+			if (--remaining == 0)
+			{
+				jobDone.notify_one();
+			}
+		}
+	}
+
+	void LdParallelRecorder::recordSlice(uint32_t slice, const Target& target, uint32_t itemCount, uint32_t sliceCount, const RecordSlice& recordSlice)
+	{
+		// slice 0 belongs to the calling thread, worker i records slice i + 1
+		LdFrameCommandPool& pool = slice == 0 ? *pools.back() : *pools[slice - 1];
+		uint32_t first = static_cast<uint32_t>(static_cast<uint64_t>(itemCount) * slice / sliceCount);
+		uint32_t end = static_cast<uint32_t>(static_cast<uint64_t>(itemCount) * (slice + 1) / sliceCount);
+
+		VkCommandBuffer commandBuffer = pool.acquire(VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+		beginCommandBuffer(commandBuffer, target, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+		recordSlice(commandBuffer, slice, first, end - first);
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to record secondary command buffer!");
+		}
+		recorded[slice] = commandBuffer;
+	}
+
+	void LdParallelRecorder::beginCommandBuffer(VkCommandBuffer commandBuffer, const Target& target, VkCommandBufferUsageFlags flags)
+	{
+		VkCommandBufferInheritanceInfo inheritanceInfo{};
+		inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritanceInfo.renderPass = target.renderPass;
+		inheritanceInfo.subpass = 0;
+		inheritanceInfo.framebuffer = target.framebuffer;
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | flags;
+		beginInfo.pInheritanceInfo = &inheritanceInfo;
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to begin recording secondary command buffer!");
+		}
+
+		// dynamic state is not inherited from the primary buffer
+		VkViewport viewport{};
+		viewport.x = 0.0f;
+		viewport.y = 0.0f;
+		viewport.width = static_cast<float>(target.extent.width);
+		viewport.height = static_cast<float>(target.extent.height);
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+		VkRect2D scissor{ {0, 0}, target.extent };
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+	}
+}
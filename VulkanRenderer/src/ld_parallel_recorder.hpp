@@ -0,0 +1,82 @@
+#pragma once
+
+#include "ld_device.hpp"
+#include "ld_frame_command_pool.hpp"
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ld {
+	// Records the draws of a render pass on several threads. record() splits a list of items into
+	// contiguous slices, the calling thread records the first and worker threads the others, each into a
+	// secondary command buffer from a pool of its own. The buffers come back in slice order for
+	// vkCmdExecuteCommands() inside a pass begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+	// Every thread has an LdFrameCommandPool of its own, beginFrame() resets the frame's pools.
+	class LdParallelRecorder {
+	public:
+		// The pass and framebuffer the secondary buffers continue, they set the viewport to extent.
+		// framebuffer may be VK_NULL_HANDLE for buffers executed with any compatible framebuffer.
+		struct Target {
+			VkRenderPass renderPass;
+			VkFramebuffer framebuffer;
+			VkExtent2D extent;
+		};
+
+		// records count items starting at first into commandBuffer, slice is below getMaxSlices()
+		using RecordSlice = std::function<void(VkCommandBuffer commandBuffer, uint32_t slice, uint32_t first, uint32_t count)>;
+
+		// fewer items per thread do not pay for the handoff
+		static constexpr uint32_t MIN_SLICE_SIZE = 512;
+
+		// one less than the hardware threads, the calling thread records too
+		static uint32_t defaultWorkerCount();
+		// begins a secondary buffer that continues target's subpass 0 and sets its viewport and scissor
+		static void beginCommandBuffer(VkCommandBuffer commandBuffer, const Target& target, VkCommandBufferUsageFlags flags);
+
+		LdParallelRecorder(LdDevice& device, uint32_t workerCount = defaultWorkerCount());
+		~LdParallelRecorder();
+
+		LdParallelRecorder(const LdParallelRecorder&) = delete;
+		LdParallelRecorder& operator=(const LdParallelRecorder&) = delete;
+
+	private:
+		// indexed by thread, the calling thread's pool comes last
+		std::vector<std::unique_ptr<LdFrameCommandPool>> pools{};
+		std::vector<VkCommandBuffer> recorded{};
+
+		std::vector<std::thread> workers{};
+		std::mutex mutex{};
+		std::condition_variable jobAdded{};
+		std::condition_variable jobDone{};
+		// the job workers pick up when generation changes, only valid while remaining is non zero
+		uint64_t generation = 0;
+		const RecordSlice* job = nullptr;
+		Target jobTarget{};
+		uint32_t jobItems = 0;
+		uint32_t jobSlices = 0;
+		uint32_t remaining = 0;
+		std::exception_ptr jobError{};
+		bool stopping = false;
+
+	public:
+		// call once the frame's fence has signaled, before anything records for it
+		void beginFrame(int frameIndex);
+		// Records itemCount items on up to getMaxSlices() threads and returns one secondary buffer per
+		// non empty slice, valid until the next record() or beginFrame(). Rethrows what recordSlice threw.
+		const std::vector<VkCommandBuffer>& record(const Target& target, uint32_t itemCount, const RecordSlice& recordSlice);
+		// a secondary buffer for the calling thread, begun for target, end it with vkEndCommandBuffer()
+		VkCommandBuffer beginSecondary(const Target& target);
+
+		uint32_t getWorkerCount() const { return static_cast<uint32_t>(workers.size()); }
+		uint32_t getMaxSlices() const { return getWorkerCount() + 1; }
+
+	private:
+		void workerLoop(uint32_t worker);
+		void recordSlice(uint32_t slice, const Target& target, uint32_t itemCount, uint32_t sliceCount, const RecordSlice& recordSlice);
+	};
+}
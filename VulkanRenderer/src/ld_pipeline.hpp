@@ -38,10 +38,10 @@ namespace ld {
 		void bind(VkCommandBuffer commandBuffer);
 		static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
 		static void enableAlphaBlending(PipelineConfigInfo& configInfo);
-
-	private:
+		// whole file, e.g. SPIR-V, shared with LdComputePipeline
 		static std::vector<char> readFile(const std::string& filepath);
 
+	private:
 		void createGraphicsPipeline(const std::string& vertFilepath, const std::string& fragFilepath, const PipelineConfigInfo& configInfo);
 
 		void createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule);
@@ -0,0 +1,88 @@
+#include "ld_range_allocator.hpp"
+
+#include <cassert>
+#include <iterator>
+
+namespace ld {
+	LdRangeAllocator::LdRangeAllocator(uint64_t size) : size{ size }
+	{
+		if (size > 0)
+		{
+			insertFree(0, size);
+		}
+	}
+
+	uint64_t LdRangeAllocator::allocate(uint64_t count)
+	{
+		if (count == 0)
+		{
+			return 0;
+		}
+		auto best = freeBySize.lower_bound(count);
+		if (best == freeBySize.end())
+		{
+			return INVALID_OFFSET;
+		}
+
+		uint64_t offset = best->second;
+		uint64_t rangeSize = best->first;
+		eraseFree(freeByOffset.find(offset));
+		if (rangeSize > count)
+		{
+			insertFree(offset + count, rangeSize - count);
+		}
+		used += count;
+		return offset;
+	}
+
+	void LdRangeAllocator::free(uint64_t offset, uint64_t count)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+		assert(offset + count <= size && "Range outside of the allocator");
+		used -= count;
+
+		auto next = freeByOffset.lower_bound(offset);
+		assert((next == freeByOffset.end() || offset + count <= next->first) && "Range freed twice");
+		if (next != freeByOffset.end() && next->first == offset + count)
+		{
+			count += next->second;
+			auto merged = next++;
+			eraseFree(merged);
+		}
+		if (next != freeByOffset.begin())
+		{
+			auto previous = std::prev(next);
+			assert(previous->first + previous->second <= offset && "Range freed twice");
+			if (previous->first + previous->second == offset)
+			{
+				offset = previous->first;
+				count += previous->second;
+				eraseFree(previous);
+			}
+		}
+		insertFree(offset, count);
+	}
+
+	void LdRangeAllocator::insertFree(uint64_t offset, uint64_t count)
+	{
+		freeByOffset.emplace(offset, count);
+		freeBySize.emplace(count, offset);
+	}
+
+	void LdRangeAllocator::eraseFree(std::map<uint64_t, uint64_t>::iterator range)
+	{
+		auto sized = freeBySize.equal_range(range->second);
+		for (auto it = sized.first; it != sized.second; ++it)
+		{
+			if (it->second == range->first)
+			{
+				freeBySize.erase(it);
+				break;
+			}
+		}
+		freeByOffset.erase(range);
+	}
+}
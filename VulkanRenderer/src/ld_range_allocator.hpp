@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+
+namespace ld {
+	// Best fit free list over [0, size) in arbitrary units. Freed ranges merge with their neighbours,
+	// so the list only holds as many entries as there are holes.
+	class LdRangeAllocator {
+	public:
+		static constexpr uint64_t INVALID_OFFSET = ~0ull;
+
+		explicit LdRangeAllocator(uint64_t size);
+
+	private:
+		uint64_t size;
+		uint64_t used = 0;
+		std::map<uint64_t, uint64_t> freeByOffset{};
+		std::multimap<uint64_t, uint64_t> freeBySize{};
+
+	public:
+		// returns INVALID_OFFSET if no free range is large enough
+		uint64_t allocate(uint64_t count);
+		void free(uint64_t offset, uint64_t count);
+
+		uint64_t getSize() const { return size; }
+		uint64_t getUsed() const { return used; }
+		uint64_t getLargestFree() const { return freeBySize.empty() ? 0 : freeBySize.rbegin()->first; }
+		size_t getFreeRangeCount() const { return freeByOffset.size(); }
+
+	private:
+		void insertFree(uint64_t offset, uint64_t count);
+		void eraseFree(std::map<uint64_t, uint64_t>::iterator range);
+	};
+}
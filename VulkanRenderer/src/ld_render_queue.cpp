@@ -0,0 +1,114 @@
+#include "ld_render_queue.hpp"
+
+#include <array>
+#include <cstring>
+
+namespace ld {
+	namespace {
+		constexpr uint32_t BUFFERS_SHIFT = LdRenderQueue::DEPTH_BITS + LdRenderQueue::MODEL_BITS;
+		constexpr uint32_t MATERIAL_SHIFT = BUFFERS_SHIFT + LdRenderQueue::BUFFERS_BITS;
+		constexpr uint32_t PIPELINE_SHIFT = MATERIAL_SHIFT + LdRenderQueue::MATERIAL_BITS;
+		static_assert(PIPELINE_SHIFT + LdRenderQueue::PIPELINE_BITS + LdRenderQueue::PASS_BITS == 64, "sort key fields have to fill 64 bits");
+
+		constexpr uint32_t RADIX_BITS = 8;
+		constexpr uint32_t RADIX_PASSES = 64 / RADIX_BITS;
+		constexpr uint32_t BUCKETS = 1u << RADIX_BITS;
+
+		uint64_t mask(uint32_t bits)
+		{
+			return (1ull << bits) - 1;
+		}
+	}
+
+	uint64_t LdRenderQueue::makeKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t buffers, uint32_t model, float depth)
+	{
+		// the bits of a positive float order like the float, the sign bit is 0 and dropped
+		float clamped = depth > 0.f ? depth : 0.f;
+		uint32_t depthBits;
+		std::memcpy(&depthBits, &clamped, sizeof(depthBits));
+		depthBits >>= 31 - DEPTH_BITS;
+
+		uint64_t key = pass & mask(PASS_BITS);
+		key = (key << PIPELINE_BITS) | (pipeline & mask(PIPELINE_BITS));
+		key = (key << MATERIAL_BITS) | (material & mask(MATERIAL_BITS));
+		key = (key << BUFFERS_BITS) | (buffers & mask(BUFFERS_BITS));
+		key = (key << MODEL_BITS) | (model & mask(MODEL_BITS));
+		key = (key << DEPTH_BITS) | (depthBits & mask(DEPTH_BITS));
+		return key;
+	}
+
+	void LdRenderQueue::begin()
+	{
+		packets.clear();
+		stats = Stats{};
+	}
+
+	void LdRenderQueue::sort()
+	{
+		stats.packets = static_cast<uint32_t>(packets.size());
+		stats.submitted = countStateChanges(packets);
+
+		// least significant byte first, every pass is a stable counting sort. One sweep fills the
+		// histograms of all passes, passes where a single bucket holds every packet change nothing.
+		std::array<std::array<uint32_t, BUCKETS>, RADIX_PASSES> histograms{};
+		for (const Packet& packet : packets)
+		{
+			for (uint32_t pass = 0; pass < RADIX_PASSES; pass++)
+			{
+				histograms[pass][(packet.key >> (pass * RADIX_BITS)) & (BUCKETS - 1)]++;
+			}
+		}
+
+		scratch.resize(packets.size());
+		for (uint32_t pass = 0; pass < RADIX_PASSES; pass++)
+		{
+			auto& histogram = histograms[pass];
+			uint32_t shift = pass * RADIX_BITS;
+			if (packets.empty() || histogram[(packets[0].key >> shift) & (BUCKETS - 1)] == packets.size())
+			{
+				stats.skippedPasses++;
+				continue;
+			}
+
+			uint32_t offset = 0;
+			for (uint32_t& count : histogram)
+			{
+				uint32_t bucketSize = count;
+				count = offset;
+				offset += bucketSize;
+			}
+			for (const Packet& packet : packets)
+			{
+				scratch[histogram[(packet.key >> shift) & (BUCKETS - 1)]++] = packet;
+			}
+			packets.swap(scratch);
+		}
+
+		stats.sorted = countStateChanges(packets);
+	}
+
+	LdRenderQueue::StateChanges LdRenderQueue::countStateChanges(const std::vector<Packet>& packets)
+	{
+		StateChanges changes{};
+		for (size_t i = 0; i < packets.size(); i++)
+		{
+			uint64_t key = packets[i].key;
+			// the first packet binds everything
+			uint64_t previous = i > 0 ? packets[i - 1].key : ~key;
+			if ((key >> PIPELINE_SHIFT) != (previous >> PIPELINE_SHIFT))
+			{
+				changes.pipelines++;
+			}
+			if ((key >> MATERIAL_SHIFT) != (previous >> MATERIAL_SHIFT))
+			{
+				changes.descriptorSets++;
+			}
+			// buffers stay bound across pipeline and descriptor set binds
+			if (((key >> BUFFERS_SHIFT) & mask(BUFFERS_BITS)) != ((previous >> BUFFERS_SHIFT) & mask(BUFFERS_BITS)))
+			{
+				changes.buffers++;
+			}
+		}
+		return changes;
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace ld {
+	// Orders a frame's draws by the state they need. Systems submit one packet per draw with a 64 bit
+	// key, sort() radix sorts them so draws sharing a pass, pipeline, material and buffers end up next
+	// to each other, then nearest first within the same state. The payload is the submitter's own index
+	// of the draw. Key fields from the most significant bit down:
+	//
+	//   pass 4 | pipeline 6 | material 10 | buffers 8 | model 16 | depth 20
+	//
+	// buffers is the vertex and index buffer pair a model binds, models sharing an arena block share it.
+	// Values wider than their field are masked, which only costs grouping.
+	class LdRenderQueue {
+	public:
+		struct Packet {
+			uint64_t key;
+			uint32_t payload;
+		};
+
+		// binds a pass needs when recording the packets in order and skipping redundant ones
+		struct StateChanges {
+			uint32_t pipelines = 0;
+			// material sets are rebound whenever the pipeline or material changes
+			uint32_t descriptorSets = 0;
+			uint32_t buffers = 0;
+		};
+
+		struct Stats {
+			uint32_t packets = 0;
+			// in submission order and after sort()
+			StateChanges submitted{};
+			StateChanges sorted{};
+			// byte passes skipped because every key had the same byte
+			uint32_t skippedPasses = 0;
+		};
+
+		static constexpr uint32_t PASS_BITS = 4;
+		static constexpr uint32_t PIPELINE_BITS = 6;
+		static constexpr uint32_t MATERIAL_BITS = 10;
+		static constexpr uint32_t BUFFERS_BITS = 8;
+		static constexpr uint32_t MODEL_BITS = 16;
+		static constexpr uint32_t DEPTH_BITS = 20;
+
+		// depth is a view distance, larger values sort later and negative ones count as 0
+		static uint64_t makeKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t buffers, uint32_t model, float depth);
+
+	private:
+		std::vector<Packet> packets{};
+		std::vector<Packet> scratch{};
+		Stats stats{};
+
+	public:
+		// forgets the last frame, keeps the capacity
+		void begin();
+		void submit(uint64_t key, uint32_t payload) { packets.push_back({ key, payload }); }
+		// stable, packets with equal keys keep their submission order
+		void sort();
+
+		const std::vector<Packet>& getPackets() const { return packets; }
+		const Stats& getStats() const { return stats; }
+
+		static StateChanges countStateChanges(const std::vector<Packet>& packets);
+	};
+}
@@ -7,15 +7,13 @@
 namespace ld {
 
 
-	LdRenderer::LdRenderer(LdWindow &window, LdDevice & device) : ldWindow{window}, ldDevice{device}
+	LdRenderer::LdRenderer(LdWindow &window, LdDevice & device) : ldWindow{window}, ldDevice{device}, commandPool{device}
 	{
 		recreateSwapChain();
-		createCommandBuffers();
 	}
 
 	LdRenderer::~LdRenderer()
 	{
-		freeCommandBuffers();
 	}
 
 	VkCommandBuffer LdRenderer::beginFrame()
@@ -36,7 +34,10 @@ namespace ld {
 		}
 
 		isFrameStarted = true;
-		 
+
+		// the frame's fence has signaled in acquireNextImage, nothing reads its command buffers anymore
+		commandPool.reset(currentFrameIndex);
+		currentCommandBuffer = commandPool.acquire();
 		auto commandBuffer = getCurrentCommandBuffer();
 		VkCommandBufferBeginInfo beginInfo{};
 		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -72,7 +73,7 @@ namespace ld {
 		currentFrameIndex = (currentFrameIndex + 1) % LdSwapChain::MAX_FRAMES_IN_FLIGHT;
 	}
 
-	void LdRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer)
+	void LdRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer, LdSwapChain::RenderPassPart part, VkSubpassContents contents)
 	{
 		assert(isFrameStarted && "Can't call beginSwapChainREnderPass if frame is not in progress");
 		assert(commandBuffer == getCurrentCommandBuffer() &&
@@ -80,7 +81,9 @@ namespace ld {
 
 		VkRenderPassBeginInfo renderPassInfo{};
 		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassInfo.renderPass = ldSwapChain->getRenderPass();
+		assert((part == LdSwapChain::RenderPassPart::Whole || ldSwapChain->canSplitRenderPass()) &&
+			"Can't split the render pass without sampled depth");
+		renderPassInfo.renderPass = ldSwapChain->getRenderPass(part);
 		renderPassInfo.framebuffer = ldSwapChain->getFrameBuffer(currentImageIndex);
 
 		renderPassInfo.renderArea.offset = { 0, 0 };
@@ -92,7 +95,11 @@ namespace ld {
 		renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
 		renderPassInfo.pClearValues = clearValues.data();
 
-		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+		if (contents != VK_SUBPASS_CONTENTS_INLINE)
+		{
+			return;
+		}
 
 		VkViewport viewport{};
 		viewport.x = 0.0f;
@@ -115,30 +122,6 @@ namespace ld {
 		vkCmdEndRenderPass(commandBuffer);
 	}
 
-	void LdRenderer::createCommandBuffers()
-	{
-		commandBuffers.resize(LdSwapChain::MAX_FRAMES_IN_FLIGHT);
-		VkCommandBufferAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		allocInfo.commandPool = ldDevice.getCommandPool();
-		allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
-
-		if (vkAllocateCommandBuffers(ldDevice.device(), &allocInfo, commandBuffers.data()) != VK_SUCCESS)
-		{
-			throw std::runtime_error("failed to allocate command buffers");
-		}
-	}
-
-
-	void LdRenderer::freeCommandBuffers()
-	{
-		vkFreeCommandBuffers(ldDevice.device(), ldDevice.getCommandPool(), static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
-		commandBuffers.clear();
-	}
-
-
-
 	void LdRenderer::recreateSwapChain()
 	{
 		auto extent = ldWindow.getExtent();
@@ -164,6 +147,7 @@ namespace ld {
 			}
 
 		}
+		swapChainGeneration++;
 		// if render pass compatible, do nothing.
 	}
 
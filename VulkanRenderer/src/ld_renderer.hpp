@@ -2,6 +2,7 @@
 
 #include "ld_window.hpp"
 #include "ld_device.hpp"
+#include "ld_frame_command_pool.hpp"
 #include "ld_swapchain.hpp"
 #include "ld_model.hpp"
 
@@ -21,20 +22,39 @@ namespace ld {
 		LdWindow& ldWindow;
 		LdDevice& ldDevice;
 		std::unique_ptr<LdSwapChain> ldSwapChain;
-		std::vector<VkCommandBuffer> commandBuffers;
+		// the primary buffer is taken from the frame's pool again every frame
+		LdFrameCommandPool commandPool;
+		VkCommandBuffer currentCommandBuffer = VK_NULL_HANDLE;
 
 
 		uint32_t currentImageIndex;
-		int currentFrameIndex; // from 0 - max_frames_in_flight
-		bool isFrameStarted;
+		int currentFrameIndex = 0; // from 0 - max_frames_in_flight
+		bool isFrameStarted = false;
+		uint32_t swapChainGeneration = 0;
 
 	public:
 		VkRenderPass getSwapChainRenderPass() const { return ldSwapChain->getRenderPass(); }
+		VkRenderPass getSwapChainRenderPass(LdSwapChain::RenderPassPart part) const { return ldSwapChain->getRenderPass(part); }
+		bool canSplitSwapChainRenderPass() const { return ldSwapChain->canSplitRenderPass(); }
+		// changes whenever the swap chain, its render passes and framebuffers are recreated
+		uint32_t getSwapChainGeneration() const { return swapChainGeneration; }
+		// depth attachment of the image being rendered, readable between the early and late part
+		VkImageView getCurrentDepthImageView() const 
+		{
+			assert(isFrameStarted && "Cannot get depth image view when frame not in progress");
+			return ldSwapChain->getDepthImageView(static_cast<int>(currentImageIndex));
+		}
+		// framebuffer of the image being rendered, for secondary command buffers continuing its pass
+		VkFramebuffer getCurrentFramebuffer() const
+		{
+			assert(isFrameStarted && "Cannot get framebuffer when frame not in progress");
+			return ldSwapChain->getFrameBuffer(static_cast<int>(currentImageIndex));
+		}
 		bool isFrameInProgress() const { return isFrameStarted; }
 		VkCommandBuffer getCurrentCommandBuffer() const 
 		{
 			assert(isFrameStarted && "Cannot get command buffer when frame not i n progress");
-			return commandBuffers[currentFrameIndex];
+			return currentCommandBuffer;
 		}
 		int getFrameIndex() const 
 		{
@@ -42,14 +62,16 @@ namespace ld {
 			return currentFrameIndex;
 		}
 		float getAspectRatio() const { return ldSwapChain->extentAspectRatio(); }
+		VkExtent2D getSwapChainExtent() const { return ldSwapChain->getSwapChainExtent(); }
 		VkCommandBuffer beginFrame();
 		void endFrame();
-		void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
+		// with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS everything in the pass, viewport and scissor
+		// included, has to come from secondary command buffers, see LdParallelRecorder
+		void beginSwapChainRenderPass(VkCommandBuffer commandBuffer, LdSwapChain::RenderPassPart part = LdSwapChain::RenderPassPart::Whole,
+			VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
 		void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
 
 	private:
-		void createCommandBuffers();
-		void freeCommandBuffers();
 		void recreateSwapChain();
 	};
 }
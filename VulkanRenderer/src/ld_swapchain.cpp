@@ -44,7 +44,7 @@ namespace ld
         {
             vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
             vkDestroyImage(device.device(), depthImages[i], nullptr);
-            vkFreeMemory(device.device(), depthImageMemorys[i], nullptr);
+            device.memoryAllocator().free(depthImageMemorys[i]);
         }
 
         for (auto framebuffer : swapChainFramebuffers) 
@@ -53,6 +53,11 @@ namespace ld
         }
 
         vkDestroyRenderPass(device.device(), renderPass, nullptr);
+        if (depthSampled)
+        {
+            vkDestroyRenderPass(device.device(), earlyRenderPass, nullptr);
+            vkDestroyRenderPass(device.device(), lateRenderPass, nullptr);
+        }
 
         // cleanup synchronization objects
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) 
@@ -236,15 +241,31 @@ namespace ld
 
     void LdSwapChain::createRenderPass() 
     {
+        renderPass = createRenderPass(RenderPassPart::Whole);
+        if (depthSampled)
+        {
+            earlyRenderPass = createRenderPass(RenderPassPart::Early);
+            lateRenderPass = createRenderPass(RenderPassPart::Late);
+        }
+    }
+
+    VkRenderPass LdSwapChain::createRenderPass(RenderPassPart part) 
+    {
+        // the parts only differ in load / store ops and layouts, so all of them stay compatible
+        // with the same framebuffers and pipelines
+        bool early = part == RenderPassPart::Early;
+        bool late = part == RenderPassPart::Late;
+
         VkAttachmentDescription depthAttachment{};
         depthAttachment.format = findDepthFormat();
         depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-        depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.loadOp = late ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depthAttachment.storeOp = early ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
         depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        // compute reads the depth between the parts
+        depthAttachment.initialLayout = late ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+        depthAttachment.finalLayout = early ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
         VkAttachmentReference depthAttachmentRef{};
         depthAttachmentRef.attachment = 1;
@@ -253,12 +274,12 @@ namespace ld
         VkAttachmentDescription colorAttachment = {};
         colorAttachment.format = getSwapChainImageFormat();
         colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.loadOp = late ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
         colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
         colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        colorAttachment.initialLayout = late ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+        colorAttachment.finalLayout = early ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
         VkAttachmentReference colorAttachmentRef = {};
         colorAttachmentRef.attachment = 0;
@@ -270,6 +291,7 @@ namespace ld
         subpass.pColorAttachments = &colorAttachmentRef;
         subpass.pDepthStencilAttachment = &depthAttachmentRef;
 
+        std::vector<VkSubpassDependency> dependencies{};
         VkSubpassDependency dependency = {};
         dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
         dependency.srcAccessMask = 0;
@@ -277,6 +299,25 @@ namespace ld
         dependency.dstSubpass = 0;
         dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
         dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        if (late)
+        {
+            // continue on the early part's color and depth once compute is done reading the depth
+            dependency.srcStageMask |= VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+            dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+            dependency.dstAccessMask |= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+        }
+        dependencies.push_back(dependency);
+        if (early)
+        {
+            VkSubpassDependency depthRead = {};
+            depthRead.srcSubpass = 0;
+            depthRead.srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+            depthRead.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+            depthRead.dstSubpass = VK_SUBPASS_EXTERNAL;
+            depthRead.dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+            depthRead.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            dependencies.push_back(depthRead);
+        }
 
         std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
         VkRenderPassCreateInfo renderPassInfo = {};
@@ -285,13 +326,15 @@ namespace ld
         renderPassInfo.pAttachments = attachments.data();
         renderPassInfo.subpassCount = 1;
         renderPassInfo.pSubpasses = &subpass;
-        renderPassInfo.dependencyCount = 1;
-        renderPassInfo.pDependencies = &dependency;
+        renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+        renderPassInfo.pDependencies = dependencies.data();
 
-        if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) 
+        VkRenderPass createdRenderPass;
+        if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &createdRenderPass) != VK_SUCCESS) 
         {
             throw std::runtime_error("failed to create render pass!");
         }
+        return createdRenderPass;
     }
 
     void LdSwapChain::createFramebuffers() 
@@ -345,7 +388,12 @@ namespace ld
             imageInfo.format = depthFormat;
             imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
             imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-            imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+            VkImageUsageFlags usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+            if (depthSampled)
+            {
+                usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+            }
+            imageInfo.usage = usage;
             imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
             imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
             imageInfo.flags = 0;
@@ -459,10 +507,20 @@ namespace ld
 
     VkFormat LdSwapChain::findDepthFormat() 
     {
-        return device.findSupportedFormat(
-            { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
-            VK_IMAGE_TILING_OPTIMAL,
-            VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+        std::vector<VkFormat> candidates{ VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT };
+        try
+        {
+            // sampled depth allows the split render pass, see getRenderPass(RenderPassPart)
+            VkFormat format = device.findSupportedFormat(candidates, VK_IMAGE_TILING_OPTIMAL,
+                VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+            depthSampled = true;
+            return format;
+        }
+        catch (const std::runtime_error&)
+        {
+            depthSampled = false;
+        }
+        return device.findSupportedFormat(candidates, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
     }
 
 }  // namespace lve
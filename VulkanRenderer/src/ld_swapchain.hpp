@@ -16,6 +16,10 @@ namespace ld {
     public:
         static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
 
+        // The frame's pass can be split in two, e.g. to build a depth pyramid in between. The early
+        // part leaves the depth readable by compute shaders, the late part loads color and depth again.
+        enum class RenderPassPart { Whole, Early, Late };
+
         LdSwapChain(LdDevice& deviceRef, VkExtent2D windowExtent);
         LdSwapChain(LdDevice& deviceRef, VkExtent2D windowExtent, std::shared_ptr<LdSwapChain> previous);
         ~LdSwapChain();
@@ -30,9 +34,13 @@ namespace ld {
 
         std::vector<VkFramebuffer> swapChainFramebuffers;
         VkRenderPass renderPass;
+        VkRenderPass earlyRenderPass = VK_NULL_HANDLE;
+        VkRenderPass lateRenderPass = VK_NULL_HANDLE;
+        // depth images can be sampled, only then the render pass can be split
+        bool depthSampled = false;
 
         std::vector<VkImage> depthImages;
-        std::vector<VkDeviceMemory> depthImageMemorys;
+        std::vector<LdMemoryAllocation> depthImageMemorys;
         std::vector<VkImageView> depthImageViews;
         std::vector<VkImage> swapChainImages;
         std::vector<VkImageView> swapChainImageViews;
@@ -52,6 +60,11 @@ namespace ld {
     public:
         VkFramebuffer getFrameBuffer(int index) { return swapChainFramebuffers[index]; }
         VkRenderPass getRenderPass() { return renderPass; }
+        VkRenderPass getRenderPass(RenderPassPart part) {
+            return part == RenderPassPart::Early ? earlyRenderPass : part == RenderPassPart::Late ? lateRenderPass : renderPass;
+        }
+        bool canSplitRenderPass() const { return depthSampled; }
+        VkImageView getDepthImageView(int index) { return depthImageViews[index]; }
         VkImageView getImageView(int index) { return swapChainImageViews[index]; }
         size_t imageCount() { return swapChainImages.size(); }
         VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
@@ -78,6 +91,7 @@ namespace ld {
         void createImageViews();
         void createDepthResources();
         void createRenderPass();
+        VkRenderPass createRenderPass(RenderPassPart part);
         void createFramebuffers();
         void createSyncObjects();
 
@@ -0,0 +1,258 @@
+#include "ld_tlsf_allocator.hpp"
+
+#include <cassert>
+
+namespace ld {
+	namespace {
+		uint32_t highestBit(uint64_t value)
+		{
+			uint32_t bit = 0;
+			while (value >>= 1)
+			{
+				bit++;
+			}
+			return bit;
+		}
+
+		uint32_t lowestBit(uint64_t value)
+		{
+			uint32_t bit = 0;
+			while (!(value & 1))
+			{
+				value >>= 1;
+				bit++;
+			}
+			return bit;
+		}
+
+		// splitting off anything smaller only adds nodes nobody can use
+		constexpr uint64_t MIN_RANGE_SIZE = 16;
+	}
+
+	LdTlsfAllocator::LdTlsfAllocator(uint64_t size) : size{ size }
+	{
+		for (auto& lists : freeLists)
+		{
+			lists.fill(INVALID_NODE);
+		}
+		insertFree(createNode(0, size));
+	}
+
+	bool LdTlsfAllocator::allocate(uint64_t size, uint64_t alignment, Range& range)
+	{
+		assert(size > 0 && (alignment & (alignment - 1)) == 0 && "Alignment must be a power of two");
+		uint64_t requested = size;
+		// keeps the remainder after the padding large enough to split off below
+		size = size < MIN_RANGE_SIZE ? MIN_RANGE_SIZE : size;
+
+		// the worst case front padding, so any range found can take the aligned size
+		uint32_t node = findFree(size + alignment - 1);
+		if (node == INVALID_NODE)
+		{
+			return false;
+		}
+		removeFree(node);
+
+		uint64_t alignedOffset = (nodes[node].offset + alignment - 1) & ~(alignment - 1);
+		uint64_t padding = alignedOffset - nodes[node].offset;
+		if (padding > 0)
+		{
+			// the padding goes back to the free lists, or to the used range before it if it is tiny
+			uint32_t prev = nodes[node].prevPhysical;
+			if (padding < MIN_RANGE_SIZE && prev != INVALID_NODE && !nodes[prev].free)
+			{
+				nodes[prev].size += padding;
+				used += padding;
+				nodes[node].offset += padding;
+				nodes[node].size -= padding;
+			}
+			else
+			{
+				uint32_t front = node;
+				splitTail(front, padding);
+				node = nodes[front].nextPhysical;
+				removeFree(node);
+				insertFree(front);
+			}
+		}
+		splitTail(node, size);
+
+		nodes[node].free = false;
+		used += nodes[node].size;
+		allocationCount++;
+		range.offset = nodes[node].offset;
+		range.size = requested;
+		range.node = node;
+		return true;
+	}
+
+	void LdTlsfAllocator::free(uint32_t node)
+	{
+		assert(node < nodes.size() && !nodes[node].free && "Freeing a range that is not allocated");
+		used -= nodes[node].size;
+		allocationCount--;
+		nodes[node].free = true;
+
+		uint32_t next = nodes[node].nextPhysical;
+		if (next != INVALID_NODE && nodes[next].free)
+		{
+			removeFree(next);
+			merge(node, next);
+		}
+		uint32_t prev = nodes[node].prevPhysical;
+		if (prev != INVALID_NODE && nodes[prev].free)
+		{
+			removeFree(prev);
+			merge(prev, node);
+			node = prev;
+		}
+		insertFree(node);
+	}
+
+	void LdTlsfAllocator::mapping(uint64_t size, uint32_t& fl, uint32_t& sl)
+	{
+		if (size < (1ull << FL_SHIFT))
+		{
+			fl = 0;
+			sl = static_cast<uint32_t>(size >> (FL_SHIFT - SL_BITS));
+			return;
+		}
+		uint32_t bit = highestBit(size);
+		sl = static_cast<uint32_t>((size >> (bit - SL_BITS)) ^ SL_COUNT);
+		fl = bit - FL_SHIFT + 1;
+	}
+
+	uint32_t LdTlsfAllocator::findFree(uint64_t size) const
+	{
+		// round up to the next bin so every range in the bin found is large enough
+		if (size >= (1ull << FL_SHIFT))
+		{
+			size += (1ull << (highestBit(size) - SL_BITS)) - 1;
+		}
+		else
+		{
+			size += (1ull << (FL_SHIFT - SL_BITS)) - 1;
+		}
+		uint32_t fl = 0;
+		uint32_t sl = 0;
+		mapping(size, fl, sl);
+		if (fl >= FL_COUNT)
+		{
+			return INVALID_NODE;
+		}
+
+		uint32_t slMap = sl < SL_COUNT ? slBitmaps[fl] & (~0u << sl) : 0;
+		if (slMap == 0)
+		{
+			uint64_t flMap = fl + 1 < 64 ? flBitmap & (~0ull << (fl + 1)) : 0;
+			if (flMap == 0)
+			{
+				return INVALID_NODE;
+			}
+			fl = lowestBit(flMap);
+			slMap = slBitmaps[fl];
+		}
+		return freeLists[fl][lowestBit(slMap)];
+	}
+
+	uint32_t LdTlsfAllocator::createNode(uint64_t offset, uint64_t size)
+	{
+		uint32_t node = 0;
+		if (!unusedNodes.empty())
+		{
+			node = unusedNodes.back();
+			unusedNodes.pop_back();
+			nodes[node] = Node{};
+		}
+		else
+		{
+			node = static_cast<uint32_t>(nodes.size());
+			nodes.push_back(Node{});
+		}
+		nodes[node].offset = offset;
+		nodes[node].size = size;
+		return node;
+	}
+
+	void LdTlsfAllocator::insertFree(uint32_t node)
+	{
+		uint32_t fl = 0;
+		uint32_t sl = 0;
+		mapping(nodes[node].size, fl, sl);
+
+		Node& entry = nodes[node];
+		entry.free = true;
+		entry.prevFree = INVALID_NODE;
+		entry.nextFree = freeLists[fl][sl];
+		if (entry.nextFree != INVALID_NODE)
+		{
+			nodes[entry.nextFree].prevFree = node;
+		}
+		freeLists[fl][sl] = node;
+		flBitmap |= 1ull << fl;
+		slBitmaps[fl] |= 1u << sl;
+	}
+
+	void LdTlsfAllocator::removeFree(uint32_t node)
+	{
+		uint32_t fl = 0;
+		uint32_t sl = 0;
+		mapping(nodes[node].size, fl, sl);
+
+		Node& entry = nodes[node];
+		if (entry.prevFree != INVALID_NODE)
+		{
+			nodes[entry.prevFree].nextFree = entry.nextFree;
+		}
+		else
+		{
+			freeLists[fl][sl] = entry.nextFree;
+		}
+		if (entry.nextFree != INVALID_NODE)
+		{
+			nodes[entry.nextFree].prevFree = entry.prevFree;
+		}
+		entry.prevFree = entry.nextFree = INVALID_NODE;
+		entry.free = false;
+
+		if (freeLists[fl][sl] == INVALID_NODE)
+		{
+			slBitmaps[fl] &= ~(1u << sl);
+			if (slBitmaps[fl] == 0)
+			{
+				flBitmap &= ~(1ull << fl);
+			}
+		}
+	}
+
+	void LdTlsfAllocator::splitTail(uint32_t node, uint64_t size)
+	{
+		if (nodes[node].size - size < MIN_RANGE_SIZE)
+		{
+			return;
+		}
+		uint32_t tail = createNode(nodes[node].offset + size, nodes[node].size - size);
+		// createNode may have grown the vector, index again
+		nodes[tail].prevPhysical = node;
+		nodes[tail].nextPhysical = nodes[node].nextPhysical;
+		if (nodes[tail].nextPhysical != INVALID_NODE)
+		{
+			nodes[nodes[tail].nextPhysical].prevPhysical = tail;
+		}
+		nodes[node].nextPhysical = tail;
+		nodes[node].size = size;
+		insertFree(tail);
+	}
+
+	void LdTlsfAllocator::merge(uint32_t node, uint32_t next)
+	{
+		assert(nodes[node].nextPhysical == next && "Only physical neighbours can merge");
+		nodes[node].size += nodes[next].size;
+		nodes[node].nextPhysical = nodes[next].nextPhysical;
+		if (nodes[node].nextPhysical != INVALID_NODE)
+		{
+			nodes[nodes[node].nextPhysical].prevPhysical = node;
+		}
+		unusedNodes.push_back(next);
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace ld {
+	// Two level segregated fit allocator over [0, size) bytes. Free ranges are binned by the position of
+	// their highest bit and 16 linear steps below it, two bitmaps find a fitting bin in constant time.
+	// Freed ranges merge with their physical neighbours.
+	class LdTlsfAllocator {
+	public:
+		static constexpr uint32_t INVALID_NODE = ~0u;
+
+		struct Range {
+			uint64_t offset = 0;
+			uint64_t size = 0;
+			// pass back to free()
+			uint32_t node = INVALID_NODE;
+		};
+
+		explicit LdTlsfAllocator(uint64_t size);
+
+	private:
+		static constexpr uint32_t SL_BITS = 4;
+		static constexpr uint32_t SL_COUNT = 1u << SL_BITS;
+		// ranges below 2^FL_SHIFT bytes all share the first level
+		static constexpr uint32_t FL_SHIFT = 8;
+		static constexpr uint32_t FL_COUNT = 64 - FL_SHIFT + 1;
+
+		struct Node {
+			uint64_t offset;
+			uint64_t size;
+			uint32_t prevPhysical = INVALID_NODE;
+			uint32_t nextPhysical = INVALID_NODE;
+			uint32_t prevFree = INVALID_NODE;
+			uint32_t nextFree = INVALID_NODE;
+			bool free = false;
+		};
+
+		uint64_t size;
+		uint64_t used = 0;
+		uint32_t allocationCount = 0;
+		std::vector<Node> nodes{};
+		std::vector<uint32_t> unusedNodes{};
+		uint64_t flBitmap = 0;
+		std::array<uint32_t, FL_COUNT> slBitmaps{};
+		std::array<std::array<uint32_t, SL_COUNT>, FL_COUNT> freeLists{};
+
+	public:
+		// false if no free range can hold size bytes at the alignment, which must be a power of two
+		bool allocate(uint64_t size, uint64_t alignment, Range& range);
+		void free(uint32_t node);
+
+		uint64_t getSize() const { return size; }
+		uint64_t getUsed() const { return used; }
+		uint32_t getAllocationCount() const { return allocationCount; }
+		bool isEmpty() const { return allocationCount == 0; }
+
+	private:
+		static void mapping(uint64_t size, uint32_t& fl, uint32_t& sl);
+		uint32_t findFree(uint64_t size) const;
+		uint32_t createNode(uint64_t offset, uint64_t size);
+		void insertFree(uint32_t node);
+		void removeFree(uint32_t node);
+		// splits the tail past size off node into a free node
+		void splitTail(uint32_t node, uint64_t size);
+		// absorbs next, which must follow node physically, into node
+		void merge(uint32_t node, uint32_t next);
+	};
+}
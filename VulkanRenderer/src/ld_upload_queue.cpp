@@ -0,0 +1,276 @@
+#include "ld_upload_queue.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+namespace ld {
+	namespace {
+		// covers bufferOffset rules for every texel size up to 16 bytes
+		constexpr uint64_t STAGING_ALIGNMENT = 16;
+	}
+
+	LdUploadQueue::LdUploadQueue(LdDevice& device, VkQueue queue, uint32_t queueFamily, Settings settings)
+		: ldDevice{ device }, queue{ queue }, settings{ settings }, ownerThread{ std::this_thread::get_id() },
+		stagingRing{ device, 1, static_cast<uint32_t>(settings.stagingSize), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT }
+	{
+		assert(settings.maxRingUpload <= settings.stagingSize && "Ring uploads must fit the staging ring");
+
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = queueFamily;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		if (vkCreateCommandPool(ldDevice.device(), &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create upload command pool!");
+		}
+
+		if (stagingRing.map() != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to map upload staging ring!");
+		}
+		ringMemory = static_cast<uint8_t*>(stagingRing.getMappedMemory());
+		openBatch.id = 1;
+	}
+
+	LdUploadQueue::~LdUploadQueue()
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		// copies still pending may target buffers that are gone already, only finish what was submitted
+		retireBatches(inFlight.size());
+		for (auto& batch : freeBatches)
+		{
+			vkDestroyFence(ldDevice.device(), batch.fence, nullptr);
+		}
+		if (openBatch.fence != VK_NULL_HANDLE)
+		{
+			vkDestroyFence(ldDevice.device(), openBatch.fence, nullptr);
+		}
+		// destroying the pool frees the command buffers
+		vkDestroyCommandPool(ldDevice.device(), commandPool, nullptr);
+	}
+
+	uint64_t LdUploadQueue::enqueueBuffer(const void* data, VkDeviceSize size, VkBuffer destination, VkDeviceSize dstOffset)
+	{
+		std::unique_lock<std::mutex> lock{ mutex };
+		VkBufferCopy region{};
+		VkBuffer source = stage(lock, data, size, region.srcOffset);
+		region.dstOffset = dstOffset;
+		region.size = size;
+
+		// staging may have submitted the batch that was open before, the copy goes into the current one
+		openBatch.bufferCopies.push_back({ source, destination, region });
+		stats.copies++;
+		stats.bytesUploaded += size;
+		return openBatch.id;
+	}
+
+	uint64_t LdUploadQueue::enqueueImage(const void* data, VkDeviceSize size, VkImage destination,
+		uint32_t width, uint32_t height, uint32_t layerCount)
+	{
+		std::unique_lock<std::mutex> lock{ mutex };
+		VkBufferImageCopy region{};
+		VkBuffer source = stage(lock, data, size, region.bufferOffset);
+		region.bufferRowLength = 0;
+		region.bufferImageHeight = 0;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = 0;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = layerCount;
+		region.imageOffset = { 0, 0, 0 };
+		region.imageExtent = { width, height, 1 };
+
+		openBatch.imageCopies.push_back({ source, destination, region });
+		stats.copies++;
+		stats.bytesUploaded += size;
+		return openBatch.id;
+	}
+
+	void LdUploadQueue::update()
+	{
+		assert(std::this_thread::get_id() == ownerThread && "Only the owning thread submits uploads");
+		std::lock_guard<std::mutex> lock{ mutex };
+		retireBatches(0);
+		submitOpenBatch();
+	}
+
+	void LdUploadQueue::flush()
+	{
+		assert(std::this_thread::get_id() == ownerThread && "Only the owning thread submits uploads");
+		std::lock_guard<std::mutex> lock{ mutex };
+		submitOpenBatch();
+		retireBatches(inFlight.size());
+	}
+
+	LdUploadQueue::Stats LdUploadQueue::getStats() const
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		return stats;
+	}
+
+	VkBuffer LdUploadQueue::stage(std::unique_lock<std::mutex>& lock, const void* data, VkDeviceSize size, VkDeviceSize& stagingOffset)
+	{
+		if (size > settings.maxRingUpload)
+		{
+			auto buffer = std::make_unique<LdBuffer>(ldDevice, 1, static_cast<uint32_t>(size), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			buffer->map();
+			buffer->writeToBuffer(const_cast<void*>(data), size);
+			VkBuffer source = buffer->getBuffer();
+			openBatch.dedicatedStaging.push_back(std::move(buffer));
+			stats.dedicatedStagingBuffers++;
+			stagingOffset = 0;
+			return source;
+		}
+
+		if (!tryAllocateRing(size, stagingOffset))
+		{
+			stats.ringStalls++;
+			do
+			{
+				if (std::this_thread::get_id() == ownerThread)
+				{
+					// nobody else submits, so push out what is pending and wait for the oldest batch
+					submitOpenBatch();
+					retireBatches(1);
+				}
+				else
+				{
+					spaceFreed.wait(lock);
+				}
+			} while (!tryAllocateRing(size, stagingOffset));
+		}
+		std::memcpy(ringMemory + stagingOffset, data, static_cast<size_t>(size));
+		return stagingRing.getBuffer();
+	}
+
+	bool LdUploadQueue::tryAllocateRing(VkDeviceSize size, VkDeviceSize& offset)
+	{
+		if (ringHead == ringTail)
+		{
+			// nothing in use, start over at the front so large uploads do not have to wrap
+			ringHead = ringTail = (ringHead + settings.stagingSize - 1) / settings.stagingSize * settings.stagingSize;
+		}
+
+		uint64_t head = (ringHead + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+		uint64_t position = head % settings.stagingSize;
+		if (position + size > settings.stagingSize)
+		{
+			// copies never wrap, skip the rest of the ring
+			head += settings.stagingSize - position;
+			position = 0;
+		}
+		if (head + size - ringTail > settings.stagingSize)
+		{
+			return false;
+		}
+		offset = position;
+		ringHead = head + size;
+		return true;
+	}
+
+	void LdUploadQueue::submitOpenBatch()
+	{
+		if (openBatch.bufferCopies.empty() && openBatch.imageCopies.empty())
+		{
+			return;
+		}
+		acquireBatchResources(openBatch);
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(openBatch.commandBuffer, &beginInfo);
+		for (const auto& copy : openBatch.bufferCopies)
+		{
+			vkCmdCopyBuffer(openBatch.commandBuffer, copy.source, copy.destination, 1, &copy.region);
+		}
+		for (const auto& copy : openBatch.imageCopies)
+		{
+			vkCmdCopyBufferToImage(openBatch.commandBuffer, copy.source, copy.destination, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy.region);
+		}
+		vkEndCommandBuffer(openBatch.commandBuffer);
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &openBatch.commandBuffer;
+		if (vkQueueSubmit(queue, 1, &submitInfo, openBatch.fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to submit upload batch!");
+		}
+		stats.batches++;
+
+		// all ring space handed out so far belongs to this batch or an older one
+		openBatch.ringEnd = ringHead;
+		uint64_t nextId = openBatch.id + 1;
+		inFlight.push_back(std::move(openBatch));
+		openBatch = Batch{};
+		openBatch.id = nextId;
+	}
+
+	void LdUploadQueue::retireBatches(size_t waitCount)
+	{
+		bool retired = false;
+		for (size_t i = 0; !inFlight.empty(); i++)
+		{
+			Batch& batch = inFlight.front();
+			if (i < waitCount)
+			{
+				vkWaitForFences(ldDevice.device(), 1, &batch.fence, VK_TRUE, UINT64_MAX);
+			}
+			else if (vkGetFenceStatus(ldDevice.device(), batch.fence) != VK_SUCCESS)
+			{
+				break;
+			}
+
+			ringTail = batch.ringEnd;
+			completedBatch.store(batch.id, std::memory_order_release);
+			batch.bufferCopies.clear();
+			batch.imageCopies.clear();
+			batch.dedicatedStaging.clear();
+			vkResetFences(ldDevice.device(), 1, &batch.fence);
+			vkResetCommandBuffer(batch.commandBuffer, 0);
+			freeBatches.push_back(std::move(batch));
+			inFlight.pop_front();
+			retired = true;
+		}
+		if (retired)
+		{
+			spaceFreed.notify_all();
+		}
+	}
+
+	void LdUploadQueue::acquireBatchResources(Batch& batch)
+	{
+		if (batch.commandBuffer != VK_NULL_HANDLE)
+		{
+			return;
+		}
+		if (!freeBatches.empty())
+		{
+			batch.commandBuffer = freeBatches.back().commandBuffer;
+			batch.fence = freeBatches.back().fence;
+			freeBatches.pop_back();
+			return;
+		}
+
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandPool = commandPool;
+		allocInfo.commandBufferCount = 1;
+		if (vkAllocateCommandBuffers(ldDevice.device(), &allocInfo, &batch.commandBuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to allocate upload command buffer!");
+		}
+
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		if (vkCreateFence(ldDevice.device(), &fenceInfo, nullptr, &batch.fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create upload fence!");
+		}
+	}
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "ld_buffer.hpp"
+#include "ld_device.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ld {
+	// Batches buffer and image uploads into one command buffer per submit. enqueue copies the data into
+	// a persistently mapped staging ring at once, so callers can drop their copy right away. The owning
+	// thread submits everything pending once per frame in update(), or at once with flush(), and the
+	// staging space is reused once the batch's fence has signaled.
+	//
+	// Batches are numbered in submit order and complete in that order, so the number returned by an
+	// enqueue is all a caller needs to keep to know when its data has landed.
+	class LdUploadQueue {
+	public:
+		struct Settings {
+			VkDeviceSize stagingSize = 32ull * 1024 * 1024;
+			// uploads larger than this get a staging buffer of their own instead of blocking the ring
+			VkDeviceSize maxRingUpload = 8ull * 1024 * 1024;
+		};
+
+		struct Stats {
+			uint64_t copies = 0;
+			uint64_t batches = 0;
+			VkDeviceSize bytesUploaded = 0;
+			// uploads that bypassed the ring
+			uint32_t dedicatedStagingBuffers = 0;
+			// enqueues that had to wait for the gpu to free ring space
+			uint32_t ringStalls = 0;
+		};
+
+		// copies are recorded for queue, which must belong to queueFamily. The constructing thread owns
+		// the queue submissions, every other thread may only enqueue.
+		LdUploadQueue(LdDevice& device, VkQueue queue, uint32_t queueFamily) : LdUploadQueue(device, queue, queueFamily, Settings{}) {}
+		LdUploadQueue(LdDevice& device, VkQueue queue, uint32_t queueFamily, Settings settings);
+		~LdUploadQueue();
+
+		LdUploadQueue(const LdUploadQueue&) = delete;
+		LdUploadQueue& operator=(const LdUploadQueue&) = delete;
+
+	private:
+		struct BufferCopy {
+			VkBuffer source;
+			VkBuffer destination;
+			VkBufferCopy region;
+		};
+
+		struct ImageCopy {
+			VkBuffer source;
+			VkImage destination;
+			VkBufferImageCopy region;
+		};
+
+		struct Batch {
+			uint64_t id = 0;
+			VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+			VkFence fence = VK_NULL_HANDLE;
+			// ring position after the batch's data, everything before it is free once the batch completes
+			uint64_t ringEnd = 0;
+			std::vector<BufferCopy> bufferCopies{};
+			std::vector<ImageCopy> imageCopies{};
+			std::vector<std::unique_ptr<LdBuffer>> dedicatedStaging{};
+		};
+
+		LdDevice& ldDevice;
+		VkQueue queue;
+		Settings settings;
+		std::thread::id ownerThread;
+		VkCommandPool commandPool = VK_NULL_HANDLE;
+		LdBuffer stagingRing;
+		uint8_t* ringMemory = nullptr;
+
+		mutable std::mutex mutex{};
+		std::condition_variable spaceFreed{};
+		// byte counters that only grow, the ring position is head % stagingSize
+		uint64_t ringHead = 0;
+		uint64_t ringTail = 0;
+		Batch openBatch{};
+		std::deque<Batch> inFlight{};
+		std::vector<Batch> freeBatches{};
+		std::atomic<uint64_t> completedBatch{ 0 };
+		Stats stats{};
+
+	public:
+		// returns the batch that carries the copy
+		uint64_t enqueueBuffer(const void* data, VkDeviceSize size, VkBuffer destination, VkDeviceSize dstOffset = 0);
+		// tightly packed texels for the whole mip 0, the image must be in TRANSFER_DST_OPTIMAL when the batch runs
+		uint64_t enqueueImage(const void* data, VkDeviceSize size, VkImage destination,
+			uint32_t width, uint32_t height, uint32_t layerCount = 1);
+
+		// owner thread, once per frame: retires finished batches and submits the pending copies
+		void update();
+		// owner thread: submits the pending copies and waits for every batch
+		void flush();
+
+		bool isComplete(uint64_t batch) const { return batch <= completedBatch.load(std::memory_order_acquire); }
+		uint64_t getCompletedBatch() const { return completedBatch.load(std::memory_order_acquire); }
+		Stats getStats() const;
+
+	private:
+		// reserves size bytes of staging, from the ring or a dedicated buffer, and copies data into it
+		VkBuffer stage(std::unique_lock<std::mutex>& lock, const void* data, VkDeviceSize size, VkDeviceSize& stagingOffset);
+		bool tryAllocateRing(VkDeviceSize size, VkDeviceSize& offset);
+		void submitOpenBatch();
+		// retires finished batches from the front, waiting for the first waitCount of them
+		void retireBatches(size_t waitCount);
+		void acquireBatchResources(Batch& batch);
+	};
+}
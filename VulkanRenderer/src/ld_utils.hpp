@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+#include <cstring>
 #include <functional>
 
 namespace ld {
@@ -11,4 +13,22 @@ namespace ld {
 		(hashCombine(seed, rest), ...);
 	};
 
+	// 64-bit FNV-1a over whole words, good enough to detect changed asset files
+	inline uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0xcbf29ce484222325ull) {
+		constexpr uint64_t prime = 0x100000001b3ull;
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		uint64_t hash = seed;
+		size_t i = 0;
+		for (; i + 8 <= size; i += 8) {
+			uint64_t word;
+			std::memcpy(&word, bytes + i, sizeof(word));
+			hash = (hash ^ word) * prime;
+			hash ^= hash >> 32;
+		}
+		for (; i < size; i++) {
+			hash = (hash ^ bytes[i]) * prime;
+		}
+		return hash ^ size;
+	}
+
 }  // nam
\ No newline at end of file
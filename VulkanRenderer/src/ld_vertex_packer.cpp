@@ -0,0 +1,216 @@
+#include "ld_vertex_packer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace ld {
+	namespace {
+		inline float signNotZero(float value)
+		{
+			return value >= 0.f ? 1.f : -1.f;
+		}
+
+		inline float maxComponent(const glm::vec3& value)
+		{
+			return std::max(value.x, std::max(value.y, value.z));
+		}
+	}
+
+	LdVertexPacker::LdVertexPacker(LdModel::VertexFormat format) : format{ format }
+	{
+		assert(format == LdModel::VertexFormat::Quantized16 || format == LdModel::VertexFormat::Half16);
+	}
+
+	void LdVertexPacker::pack(const LdModel::Vertex* vertices, uint32_t vertexCount, std::vector<LdModel::PackedVertex>& packedVertices)
+	{
+		packedVertices.resize(vertexCount);
+		error = {};
+
+		glm::vec3 boundsMin{ std::numeric_limits<float>::max() };
+		glm::vec3 boundsMax{ std::numeric_limits<float>::lowest() };
+		for (uint32_t i = 0; i < vertexCount; i++)
+		{
+			boundsMin = glm::min(boundsMin, vertices[i].position);
+			boundsMax = glm::max(boundsMax, vertices[i].position);
+		}
+		if (vertexCount == 0)
+		{
+			boundsMin = boundsMax = glm::vec3{ 0.f };
+		}
+
+		// packed positions are decoded as offset + scale * stored, on the gpu through the model matrix
+		glm::vec3 offset{};
+		glm::vec3 scale{};
+		if (format == LdModel::VertexFormat::Quantized16)
+		{
+			offset = boundsMin;
+			scale = boundsMax - boundsMin;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if (scale[axis] <= 0.f) scale[axis] = 1.f;
+			}
+		}
+		else
+		{
+			// one uniform scale into [-1, 1], where half floats are most precise
+			offset = (boundsMin + boundsMax) * 0.5f;
+			float halfExtent = maxComponent(boundsMax - boundsMin) * 0.5f;
+			scale = glm::vec3{ halfExtent > 0.f ? halfExtent : 1.f };
+		}
+		positionTransform = glm::mat4{ 1.f };
+		positionTransform[0][0] = scale.x;
+		positionTransform[1][1] = scale.y;
+		positionTransform[2][2] = scale.z;
+		positionTransform[3] = glm::vec4{ offset, 1.f };
+
+		for (uint32_t i = 0; i < vertexCount; i++)
+		{
+			const LdModel::Vertex& vertex = vertices[i];
+			LdModel::PackedVertex& packed = packedVertices[i];
+
+			glm::vec3 normalized = (vertex.position - offset) / scale;
+			glm::vec3 decoded{};
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if (format == LdModel::VertexFormat::Quantized16)
+				{
+					float clamped = std::min(std::max(normalized[axis], 0.f), 1.f);
+					packed.position[axis] = static_cast<uint16_t>(std::lround(clamped * 65535.f));
+					decoded[axis] = packed.position[axis] / 65535.f;
+				}
+				else
+				{
+					packed.position[axis] = floatToHalf(normalized[axis]);
+					decoded[axis] = halfToFloat(packed.position[axis]);
+				}
+			}
+			packed.position[3] = 0;
+			decoded = offset + decoded * scale;
+			error.position = std::max(error.position, glm::length(decoded - vertex.position));
+
+			encodeOctahedral(vertex.normal, packed.normal);
+			float normalLength = glm::length(vertex.normal);
+			if (normalLength > 0.f)
+			{
+				float cosine = glm::dot(vertex.normal / normalLength, decodeOctahedral(packed.normal));
+				float degrees = std::acos(std::min(std::max(cosine, -1.f), 1.f)) * 57.2957795f;
+				error.normalDegrees = std::max(error.normalDegrees, degrees);
+			}
+
+			for (int channel = 0; channel < 3; channel++)
+			{
+				float clamped = std::min(std::max(vertex.color[channel], 0.f), 1.f);
+				packed.color[channel] = static_cast<uint8_t>(std::lround(clamped * 255.f));
+				error.color = std::max(error.color, std::abs(packed.color[channel] / 255.f - vertex.color[channel]));
+			}
+			packed.color[3] = 255;
+
+			for (int channel = 0; channel < 2; channel++)
+			{
+				packed.uv[channel] = floatToHalf(vertex.uv[channel]);
+				error.uv = std::max(error.uv, std::abs(halfToFloat(packed.uv[channel]) - vertex.uv[channel]));
+			}
+		}
+
+		float extent = maxComponent(boundsMax - boundsMin);
+		error.positionRelative = extent > 0.f ? error.position / extent : 0.f;
+	}
+
+	uint16_t LdVertexPacker::floatToHalf(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		uint32_t sign = (bits >> 16) & 0x8000u;
+		uint32_t exponent = (bits >> 23) & 0xffu;
+		uint32_t mantissa = bits & 0x7fffffu;
+
+		if (exponent == 0xffu)
+		{
+			return static_cast<uint16_t>(sign | 0x7c00u | (mantissa ? 0x200u : 0u));
+		}
+
+		int32_t halfExponent = static_cast<int32_t>(exponent) - 127 + 15;
+		if (halfExponent >= 31)
+		{
+			return static_cast<uint16_t>(sign | 0x7c00u);
+		}
+
+		// rounds to nearest even, a carry out of the mantissa correctly bumps the exponent
+		if (halfExponent <= 0)
+		{
+			if (halfExponent < -10)
+			{
+				return static_cast<uint16_t>(sign);
+			}
+			mantissa |= 0x800000u;
+			uint32_t shift = static_cast<uint32_t>(14 - halfExponent);
+			uint32_t half = mantissa >> shift;
+			uint32_t remainder = mantissa & ((1u << shift) - 1u);
+			uint32_t midpoint = 1u << (shift - 1u);
+			if (remainder > midpoint || (remainder == midpoint && (half & 1u))) half++;
+			return static_cast<uint16_t>(sign | half);
+		}
+
+		uint32_t half = (static_cast<uint32_t>(halfExponent) << 10) | (mantissa >> 13);
+		uint32_t remainder = mantissa & 0x1fffu;
+		if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u))) half++;
+		return static_cast<uint16_t>(sign | half);
+	}
+
+	float LdVertexPacker::halfToFloat(uint16_t value)
+	{
+		uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+		uint32_t exponent = (value >> 10) & 0x1fu;
+		uint32_t mantissa = value & 0x3ffu;
+
+		if (exponent == 0)
+		{
+			float magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+			return sign ? -magnitude : magnitude;
+		}
+
+		uint32_t bits = exponent == 0x1fu
+			? sign | 0x7f800000u | (mantissa << 13)
+			: sign | ((exponent + 112u) << 23) | (mantissa << 13);
+		float result;
+		std::memcpy(&result, &bits, sizeof(result));
+		return result;
+	}
+
+	void LdVertexPacker::encodeOctahedral(const glm::vec3& normal, int16_t out[2])
+	{
+		float l1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+		if (l1 <= 0.f)
+		{
+			out[0] = out[1] = 0;
+			return;
+		}
+
+		float x = normal.x / l1;
+		float y = normal.y / l1;
+		if (normal.z < 0.f)
+		{
+			float foldedX = (1.f - std::abs(y)) * signNotZero(x);
+			float foldedY = (1.f - std::abs(x)) * signNotZero(y);
+			x = foldedX;
+			y = foldedY;
+		}
+		out[0] = static_cast<int16_t>(std::lround(std::min(std::max(x, -1.f), 1.f) * 32767.f));
+		out[1] = static_cast<int16_t>(std::lround(std::min(std::max(y, -1.f), 1.f) * 32767.f));
+	}
+
+	glm::vec3 LdVertexPacker::decodeOctahedral(const int16_t encoded[2])
+	{
+		// same as octDecode in simple_shader_packed.vert
+		float x = std::max(encoded[0] / 32767.f, -1.f);
+		float y = std::max(encoded[1] / 32767.f, -1.f);
+		glm::vec3 normal{ x, y, 1.f - std::abs(x) - std::abs(y) };
+		float t = std::max(-normal.z, 0.f);
+		normal.x += normal.x >= 0.f ? -t : t;
+		normal.y += normal.y >= 0.f ? -t : t;
+		return glm::normalize(normal);
+	}
+}
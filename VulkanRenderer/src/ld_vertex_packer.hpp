@@ -0,0 +1,33 @@
+#pragma once
+
+#include "ld_model.hpp"
+
+#include <vector>
+
+namespace ld {
+	// Converts full precision vertices into one of the packed LdModel::VertexFormat layouts and
+	// measures how far the decoded attributes end up from the originals.
+	class LdVertexPacker {
+	public:
+		explicit LdVertexPacker(LdModel::VertexFormat format);
+
+		LdVertexPacker(const LdVertexPacker&) = delete;
+		LdVertexPacker& operator=(const LdVertexPacker&) = delete;
+
+	private:
+		LdModel::VertexFormat format;
+		glm::mat4 positionTransform{ 1.f };
+		LdModel::QuantizationError error{};
+
+	public:
+		void pack(const LdModel::Vertex* vertices, uint32_t vertexCount, std::vector<LdModel::PackedVertex>& packedVertices);
+
+		const glm::mat4& getPositionTransform() const { return positionTransform; }
+		const LdModel::QuantizationError& getError() const { return error; }
+
+		static uint16_t floatToHalf(float value);
+		static float halfToFloat(uint16_t value);
+		static void encodeOctahedral(const glm::vec3& normal, int16_t out[2]);
+		static glm::vec3 decodeOctahedral(const int16_t encoded[2]);
+	};
+}
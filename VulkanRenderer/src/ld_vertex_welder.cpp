@@ -0,0 +1,235 @@
+#include "ld_vertex_welder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace ld {
+	namespace {
+		inline uint64_t mix(uint64_t hash, uint64_t word)
+		{
+			hash ^= word * 0xff51afd7ed558ccdull;
+			hash = (hash << 31) | (hash >> 33);
+			return hash * 0x9e3779b97f4a7c15ull;
+		}
+
+		inline uint32_t finish(uint64_t hash)
+		{
+			hash ^= hash >> 33;
+			hash *= 0xc4ceb9fe1a85ec53ull;
+			hash ^= hash >> 29;
+			return static_cast<uint32_t>(hash ^ (hash >> 32));
+		}
+
+		// -0.0 and 0.0 compare equal, so they have to hash the same too
+		inline uint32_t floatBits(float value)
+		{
+			if (value == 0.f) return 0;
+			uint32_t bits;
+			std::memcpy(&bits, &value, sizeof(bits));
+			return bits;
+		}
+
+		uint32_t hashVertex(const LdModel::Vertex& vertex)
+		{
+			uint64_t hash = 0;
+			hash = mix(hash, (uint64_t(floatBits(vertex.position.x)) << 32) | floatBits(vertex.position.y));
+			hash = mix(hash, (uint64_t(floatBits(vertex.position.z)) << 32) | floatBits(vertex.color.x));
+			hash = mix(hash, (uint64_t(floatBits(vertex.color.y)) << 32) | floatBits(vertex.color.z));
+			hash = mix(hash, (uint64_t(floatBits(vertex.normal.x)) << 32) | floatBits(vertex.normal.y));
+			hash = mix(hash, (uint64_t(floatBits(vertex.normal.z)) << 32) | floatBits(vertex.uv.x));
+			hash = mix(hash, floatBits(vertex.uv.y));
+			return finish(hash);
+		}
+
+		uint32_t hashCell(int64_t x, int64_t y, int64_t z)
+		{
+			uint64_t hash = 0;
+			hash = mix(hash, static_cast<uint64_t>(x));
+			hash = mix(hash, static_cast<uint64_t>(y));
+			hash = mix(hash, static_cast<uint64_t>(z));
+			return finish(hash);
+		}
+
+		inline int64_t cellOf(float value, float cellSize)
+		{
+			return static_cast<int64_t>(std::floor(static_cast<double>(value) / cellSize));
+		}
+
+		inline bool withinEpsilon(const glm::vec3& a, const glm::vec3& b, float epsilon)
+		{
+			return std::abs(a.x - b.x) <= epsilon && std::abs(a.y - b.y) <= epsilon && std::abs(a.z - b.z) <= epsilon;
+		}
+	}
+
+	LdVertexWelder::LdVertexWelder(Settings settings, size_t expectedVertexCount) : settings{ settings }
+	{
+		reserve(expectedVertexCount);
+	}
+
+	void LdVertexWelder::reserve(size_t vertexCount)
+	{
+		// keep the table at most half full
+		size_t capacity = 16;
+		while (capacity < vertexCount * 2)
+		{
+			capacity *= 2;
+		}
+		vertices.reserve(vertexCount);
+		if (capacity <= slots.size())
+		{
+			return;
+		}
+
+		std::vector<Slot> old = std::move(slots);
+		slots.assign(capacity, Slot{ 0, EMPTY_SLOT });
+		slotMask = static_cast<uint32_t>(capacity - 1);
+		for (const auto& slot : old)
+		{
+			if (slot.index != EMPTY_SLOT)
+			{
+				insert(slot.hash, slot.index);
+			}
+		}
+	}
+
+	void LdVertexWelder::clear()
+	{
+		std::fill(slots.begin(), slots.end(), Slot{ 0, EMPTY_SLOT });
+		vertices.clear();
+	}
+
+	std::vector<LdModel::Vertex> LdVertexWelder::takeVertices()
+	{
+		std::vector<LdModel::Vertex> result = std::move(vertices);
+		vertices = {};
+		std::fill(slots.begin(), slots.end(), Slot{ 0, EMPTY_SLOT });
+		return result;
+	}
+
+	bool LdVertexWelder::matches(const LdModel::Vertex& a, const LdModel::Vertex& b) const
+	{
+		if (isExact())
+		{
+			return a == b;
+		}
+		return withinEpsilon(a.position, b.position, settings.positionEpsilon)
+			&& (settings.normalEpsilon > 0.f ? withinEpsilon(a.normal, b.normal, settings.normalEpsilon) : a.normal == b.normal)
+			&& a.color == b.color && a.uv == b.uv;
+	}
+
+	uint32_t LdVertexWelder::find(const LdModel::Vertex& vertex, uint32_t hash) const
+	{
+		for (uint32_t slot = hash & slotMask;; slot = (slot + 1) & slotMask)
+		{
+			const Slot& entry = slots[slot];
+			if (entry.index == EMPTY_SLOT)
+			{
+				return EMPTY_SLOT;
+			}
+			if (entry.hash == hash && matches(vertices[entry.index], vertex))
+			{
+				return entry.index;
+			}
+		}
+	}
+
+	void LdVertexWelder::insert(uint32_t hash, uint32_t index)
+	{
+		uint32_t slot = hash & slotMask;
+		while (slots[slot].index != EMPTY_SLOT)
+		{
+			slot = (slot + 1) & slotMask;
+		}
+		slots[slot] = { hash, index };
+	}
+
+	void LdVertexWelder::grow()
+	{
+		reserve(std::max<size_t>(vertices.size() * 2, 16));
+	}
+
+	uint32_t LdVertexWelder::weld(const LdModel::Vertex& vertex)
+	{
+		if (slots.empty())
+		{
+			grow();
+		}
+
+		uint32_t hash;
+		if (isExact())
+		{
+			hash = hashVertex(vertex);
+			uint32_t found = find(vertex, hash);
+			if (found != EMPTY_SLOT)
+			{
+				return found;
+			}
+		}
+		else
+		{
+			// cells are twice the epsilon wide, so every vertex within epsilon lives in one of
+			// at most two cells per axis around this one
+			float cellSize = settings.positionEpsilon * 2.f;
+			const glm::vec3& p = vertex.position;
+			int64_t own[3] = { cellOf(p.x, cellSize), cellOf(p.y, cellSize), cellOf(p.z, cellSize) };
+			int64_t low[3], high[3];
+			for (int axis = 0; axis < 3; axis++)
+			{
+				low[axis] = cellOf(p[axis] - settings.positionEpsilon, cellSize);
+				high[axis] = cellOf(p[axis] + settings.positionEpsilon, cellSize);
+			}
+
+			hash = hashCell(own[0], own[1], own[2]);
+			uint32_t found = find(vertex, hash);
+			for (int64_t x = low[0]; x <= high[0] && found == EMPTY_SLOT; x++)
+			{
+				for (int64_t y = low[1]; y <= high[1] && found == EMPTY_SLOT; y++)
+				{
+					for (int64_t z = low[2]; z <= high[2] && found == EMPTY_SLOT; z++)
+					{
+						if (x == own[0] && y == own[1] && z == own[2]) continue;
+						found = find(vertex, hashCell(x, y, z));
+					}
+				}
+			}
+			if (found != EMPTY_SLOT)
+			{
+				return found;
+			}
+		}
+
+		uint32_t index = static_cast<uint32_t>(vertices.size());
+		vertices.push_back(vertex);
+		if (vertices.size() * 2 > slots.size())
+		{
+			grow();
+		}
+		insert(hash, index);
+		return index;
+	}
+
+	void LdVertexWelder::weldMesh(std::vector<LdModel::Vertex>& vertices, std::vector<uint32_t>& indices, Settings settings)
+	{
+		if (indices.empty())
+		{
+			indices.resize(vertices.size());
+			for (size_t i = 0; i < indices.size(); i++)
+			{
+				indices[i] = static_cast<uint32_t>(i);
+			}
+		}
+
+		LdVertexWelder welder{ settings, vertices.size() };
+		std::vector<uint32_t> remap(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			remap[i] = welder.weld(vertices[i]);
+		}
+		for (auto& index : indices)
+		{
+			index = remap[index];
+		}
+		vertices = welder.takeVertices();
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "ld_model.hpp"
+
+#include <vector>
+
+namespace ld {
+	// Deduplicates vertices into a flat open addressing table.
+	// Each slot keeps the vertex hash next to its index so a lookup is a single linear probe
+	// that only compares vertices whose hashes already match. Unique vertices are appended in
+	// first-occurrence order, which keeps the output identical to the old unordered_map path.
+	// With a position epsilon, vertices within that distance (and normals within normalEpsilon)
+	// are welded together; colors and uvs still have to match exactly.
+	class LdVertexWelder {
+	public:
+		struct Settings {
+			float positionEpsilon = 0.f;
+			float normalEpsilon = 0.f;
+		};
+
+		LdVertexWelder() : LdVertexWelder(Settings{}) {}
+		explicit LdVertexWelder(Settings settings, size_t expectedVertexCount = 0);
+
+		LdVertexWelder(const LdVertexWelder&) = delete;
+		LdVertexWelder& operator=(const LdVertexWelder&) = delete;
+
+	private:
+		static constexpr uint32_t EMPTY_SLOT = ~0u;
+
+		struct Slot {
+			uint32_t hash;
+			uint32_t index;
+		};
+
+		Settings settings;
+		std::vector<Slot> slots{};
+		uint32_t slotMask = 0;
+		std::vector<LdModel::Vertex> vertices{};
+
+	public:
+		// returns the index of the matching welded vertex, adding the vertex if there is none
+		uint32_t weld(const LdModel::Vertex& vertex);
+		void reserve(size_t vertexCount);
+		void clear();
+
+		size_t size() const { return vertices.size(); }
+		const std::vector<LdModel::Vertex>& getVertices() const { return vertices; }
+		std::vector<LdModel::Vertex> takeVertices();
+
+		// welds an unindexed or indexed mesh in place, for importers that do not dedup themselves
+		static void weldMesh(std::vector<LdModel::Vertex>& vertices, std::vector<uint32_t>& indices, Settings settings);
+		static void weldMesh(std::vector<LdModel::Vertex>& vertices, std::vector<uint32_t>& indices) { weldMesh(vertices, indices, Settings{}); }
+
+	private:
+		bool isExact() const { return settings.positionEpsilon <= 0.f; }
+		bool matches(const LdModel::Vertex& a, const LdModel::Vertex& b) const;
+		uint32_t find(const LdModel::Vertex& vertex, uint32_t hash) const;
+		void insert(uint32_t hash, uint32_t index);
+		void grow();
+	};
+}
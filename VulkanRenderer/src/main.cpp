@@ -1,11 +1,79 @@
 #include "app.hpp"
+#include "ld_benchmarks.hpp"
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 
-int main() 
+int main(int argc, char** argv) 
 {
-	ld::App app{};
+	if (argc > 1 && std::strcmp(argv[1], "--bench") == 0)
+	{
+		try
+		{
+			return ld::runBenchmarks(std::vector<std::string>(argv + 2, argv + argc));
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << e.what() << '\n';
+			return EXIT_FAILURE;
+		}
+	}
+
+	ld::App::Options options{};
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--vases") == 0 && i + 1 < argc)
+		{
+			options.vaseCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(argv[i], "--gpu-driven") == 0)
+		{
+			options.gpuDriven = true;
+		}
+		else if (std::strcmp(argv[i], "--record-workers") == 0 && i + 1 < argc)
+		{
+			options.recordWorkers = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(argv[i], "--static-cache") == 0)
+		{
+			options.staticCaching = true;
+		}
+		else if (std::strcmp(argv[i], "--no-optimize") == 0)
+		{
+			options.optimizeMeshes = false;
+		}
+		else if (std::strcmp(argv[i], "--verbose-import") == 0)
+		{
+			options.verboseImport = true;
+		}
+		else if (std::strcmp(argv[i], "--stats") == 0)
+		{
+			options.frameStats = true;
+		}
+		else if (std::strcmp(argv[i], "--upload-policy") == 0 && i + 1 < argc)
+		{
+			const char* policy = argv[++i];
+			if (std::strcmp(policy, "staging") == 0)
+			{
+				options.uploadPolicy = ld::LdDevice::UploadPolicy::Staging;
+			}
+			else if (std::strcmp(policy, "direct") == 0)
+			{
+				options.uploadPolicy = ld::LdDevice::UploadPolicy::Direct;
+			}
+			else if (std::strcmp(policy, "auto") == 0)
+			{
+				options.uploadPolicy = ld::LdDevice::UploadPolicy::Auto;
+			}
+			else
+			{
+				std::cerr << "unknown upload policy " << policy << ", expected staging, direct or auto\n";
+				return EXIT_FAILURE;
+			}
+		}
+	}
+	ld::App app{ options };
 
 	try
 	{